@@ -0,0 +1,832 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "Bounds.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// bounding volume hierarchy over boxes or spheres, e.g. the world bounds of transformed objects (see t_aabb::getTransformed)
+// primitives are identified by their index in the input vector
+//
+// built top down with the binned surface area heuristic, nodes are stored depth first in one array:
+// an inner node's left child follows it, its right child is stored in the node.
+// refit() moves the primitives without changing the tree, O(n). as objects travel, the tree loosens,
+// rebuild once getSAHCost() has grown well past its value after the build.
+//
+// build: O(n log n)
+// refit: O(n)
+// overlap, ray & nearest queries: O(log n) for well separated primitives
+//
+// see the end of the file for ease-of-use typedefs.
+//
+// Source:
+// Wald, On fast Construction of SAH-based Bounding Volume Hierarchies
+// https://doi.org/10.1109/RT.2007.4342588
+//
+template <class T>
+class t_bvh
+{
+  public:
+    typedef t_vec3<T> tVec;
+    typedef t_aabb<T> tBox;
+    typedef t_sphere<T> tSphere;
+
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+    // upper bounds on BuildSettings
+    static constexpr uint32_t MaxLeafSize = 32;
+    static constexpr uint32_t MaxBins = 32;
+    // deepest node, below half of it subtrees are split at the median instead of by cost, which bounds the rest
+    static constexpr uint32_t MaxTreeDepth = 64;
+
+    struct BuildSettings
+    {
+        // ranges of up to this many primitives may become a leaf, [1, MaxLeafSize]
+        uint32_t maxLeafSize = 4;
+        // candidate split planes per axis + 1, [2, MaxBins]
+        uint32_t numBins = 16;
+        // cost of visiting a node, relative to testing one primitive
+        T traversalCost = 1;
+    };
+
+    t_bvh(const std::vector<tBox>& inBoxes);
+    t_bvh(const std::vector<tBox>& inBoxes, const BuildSettings& settings);
+    t_bvh(const std::vector<tSphere>& inSpheres);
+    t_bvh(const std::vector<tSphere>& inSpheres, const BuildSettings& settings);
+
+    // updates the primitives, same number & kind as built with, & the node bounds around them
+    void refit(const std::vector<tBox>& inBoxes);
+    void refit(const std::vector<tSphere>& inSpheres);
+
+    uint32_t getNumPrimitives() const;
+    uint32_t getNumNodes() const;
+    // expected cost of a query under the surface area heuristic, counting node visits & primitive tests alike
+    T getSAHCost() const;
+
+    // overlap query callback, invoked once per primitive found
+    typedef void (*fOverlapCallback)(uint32_t index, void* pUserData);
+
+    // primitives overlapping a box or sphere, touching counts
+    void findOverlaps(const tBox& box, fOverlapCallback callback, void* pUserData) const;
+    void findOverlaps(const tSphere& sphere, fOverlapCallback callback, void* pUserData) const;
+    // as above, outIndices is cleared first
+    void findOverlaps(const tBox& box, std::vector<uint32_t>& outIndices) const;
+    void findOverlaps(const tSphere& sphere, std::vector<uint32_t>& outIndices) const;
+
+    // every pair of overlapping primitives, (lower index, higher index), for broadphase collision
+    // outPairs is cleared first
+    void findOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>>& outPairs) const;
+
+    // distance: how far along the ray the primitive is entered, 0 if the ray starts inside it
+    struct RayHit
+    {
+        uint32_t index;
+        T distance;
+    };
+
+    // first primitive hit by the ray from origin along direction (any length), within maxDistance along it
+    // returns: false if nothing is hit
+    bool findFirstRayHit(const tVec& origin, const tVec& direction, T maxDistance, RayHit& outHit) const;
+    // every primitive hit within maxDistance, closest first
+    void findRayHits(const tVec& origin, const tVec& direction, T maxDistance, std::vector<RayHit>& outHits) const;
+
+    // primitive closest to point, 0 distance inside it
+    // outDistanceSqr (optional) receives the squared distance to it
+    // returns: InvalidIndex if the hierarchy is empty, or no distance is finite (e.g. a NaN point), outDistanceSqr untouched
+    uint32_t findNearestPrimitive(const tVec& point, T* outDistanceSqr = nullptr) const;
+
+  protected:
+    struct Node
+    {
+        tBox bounds;
+        // leaves: first primitive, inner nodes: right child
+        uint32_t offset;
+        // 0 for inner nodes
+        uint32_t numPrimitives;
+
+        bool isLeaf() const
+        {
+            return numPrimitives != 0;
+        }
+    };
+
+    // depth first
+    std::vector<Node> nodes;
+    // primitives in leaf order, spheres is empty for a hierarchy of boxes
+    std::vector<tBox> boxes;
+    std::vector<tSphere> spheres;
+    // input index of each primitive in leaf order
+    std::vector<uint32_t> primitiveIndices;
+
+    // a range of primitives waiting to become a node, parentIndex: InvalidIndex except for right children
+    struct BuildTask
+    {
+        uint32_t parentIndex;
+        uint32_t begin;
+        uint32_t end;
+        uint32_t depth;
+    };
+    // a primitive during the build, partitioned in place so each range stays contiguous
+    struct BuildPrimitive
+    {
+        tBox bounds;
+        tVec centroid;
+        uint32_t index;
+    };
+    struct Bin
+    {
+        tBox bounds;
+        uint32_t count;
+    };
+
+    // builds over inBoxes, in input order
+    void init(const std::vector<tBox>& inBoxes, const BuildSettings& settings);
+    // splits a range of primitives in two, by cost or at the median
+    // returns: the first index of the right half, end to make a leaf instead
+    static uint32_t splitRange(BuildPrimitive* pPrimitives, uint32_t begin, uint32_t end, uint32_t depth, const tBox& bounds, const tBox& centroidBounds, const BuildSettings& settings);
+    // recomputes node bounds from the primitives, children before parents
+    void refitNodes();
+
+    static T getAxis(const tVec& v, int axis);
+
+    // primitive tests, by leaf order slot
+    bool overlapsPrimitive(uint32_t slot, const tBox& box) const;
+    bool overlapsPrimitive(uint32_t slot, const tSphere& sphere) const;
+    bool overlapsPrimitives(uint32_t slotA, uint32_t slotB) const;
+    T getPrimitiveDistanceSqr(uint32_t slot, const tVec& point) const;
+
+    struct Ray
+    {
+        tVec origin;
+        // unit length
+        tVec direction;
+        tVec invDirection;
+    };
+    // returns: false if the direction has no length
+    static bool getRay(const tVec& origin, const tVec& direction, Ray& outRay);
+    // entry distance of the ray into a box or primitive within [0, maxDistance]
+    // returns: false if it misses
+    static bool intersectBox(const Ray& ray, const tBox& box, T maxDistance, T& outDistance);
+    bool intersectPrimitive(const Ray& ray, uint32_t slot, T maxDistance, T& outDistance) const;
+
+    template <class SHAPE>
+    void searchOverlaps(const SHAPE& shape, fOverlapCallback callback, void* pUserData) const;
+    // visits nodes front to back, hitFunc(slot, distance) returns the distance beyond which to stop searching
+    template <class HIT_FUNC>
+    void searchRay(const Ray& ray, T maxDistance, HIT_FUNC& hitFunc) const;
+};
+
+#pragma region Constructors
+template <class T>
+inline t_bvh<T>::t_bvh(const std::vector<tBox>& inBoxes) : t_bvh(inBoxes, BuildSettings())
+{
+}
+
+template <class T>
+inline t_bvh<T>::t_bvh(const std::vector<tBox>& inBoxes, const BuildSettings& settings)
+{
+    init(inBoxes, settings);
+}
+
+template <class T>
+inline t_bvh<T>::t_bvh(const std::vector<tSphere>& inSpheres) : t_bvh(inSpheres, BuildSettings())
+{
+}
+
+template <class T>
+inline t_bvh<T>::t_bvh(const std::vector<tSphere>& inSpheres, const BuildSettings& settings)
+{
+    std::vector<tBox> inBoxes;
+    inBoxes.reserve(inSpheres.size());
+    for (const tSphere& sphere : inSpheres)
+    {
+        inBoxes.push_back(sphere.getBounds());
+    }
+    init(inBoxes, settings);
+
+    spheres.resize(inSpheres.size());
+    for (size_t slot = 0; slot != inSpheres.size(); ++slot)
+    {
+        spheres[slot] = inSpheres[primitiveIndices[slot]];
+    }
+}
+#pragma endregion
+
+#pragma region Internal_Functions
+template <class T>
+inline void t_bvh<T>::init(const std::vector<tBox>& inBoxes, const BuildSettings& settings)
+{
+    const uint32_t numPrimitives = static_cast<uint32_t>(inBoxes.size());
+    if (numPrimitives == 0)
+        return;
+
+    BuildSettings clampedSettings = settings;
+    clampedSettings.maxLeafSize = std::min(std::max(settings.maxLeafSize, 1u), uint32_t(MaxLeafSize));
+    clampedSettings.numBins = std::min(std::max(settings.numBins, 2u), uint32_t(MaxBins));
+
+    std::vector<BuildPrimitive> buildPrimitives(numPrimitives);
+    for (uint32_t i = 0; i != numPrimitives; ++i)
+    {
+        buildPrimitives[i] = {inBoxes[i], inBoxes[i].getCenter(), i};
+    }
+
+    // depth first, the left child is built right after its parent so it lands next to it
+    nodes.reserve(2 * ((numPrimitives + clampedSettings.maxLeafSize - 1) / clampedSettings.maxLeafSize));
+    std::vector<BuildTask> tasks;
+    tasks.push_back({InvalidIndex, 0, numPrimitives, 0});
+    while (!tasks.empty())
+    {
+        const BuildTask task = tasks.back();
+        tasks.pop_back();
+
+        const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+        if (task.parentIndex != InvalidIndex)
+            nodes[task.parentIndex].offset = nodeIndex;
+
+        Node node;
+        node.bounds = tBox::getEmpty();
+        tBox centroidBounds = tBox::getEmpty();
+        for (uint32_t i = task.begin; i != task.end; ++i)
+        {
+            node.bounds.expand(buildPrimitives[i].bounds);
+            centroidBounds.expand(buildPrimitives[i].centroid);
+        }
+
+        const uint32_t middle = splitRange(buildPrimitives.data(), task.begin, task.end, task.depth, node.bounds, centroidBounds, clampedSettings);
+        if (middle == task.end)
+        {
+            node.offset = task.begin;
+            node.numPrimitives = task.end - task.begin;
+            nodes.push_back(node);
+            continue;
+        }
+
+        node.numPrimitives = 0;
+        nodes.push_back(node);
+        tasks.push_back({nodeIndex, middle, task.end, task.depth + 1});
+        tasks.push_back({InvalidIndex, task.begin, middle, task.depth + 1});
+    }
+
+    boxes.resize(numPrimitives);
+    primitiveIndices.resize(numPrimitives);
+    for (uint32_t slot = 0; slot != numPrimitives; ++slot)
+    {
+        boxes[slot] = buildPrimitives[slot].bounds;
+        primitiveIndices[slot] = buildPrimitives[slot].index;
+    }
+}
+
+template <class T>
+inline uint32_t t_bvh<T>::splitRange(BuildPrimitive* pPrimitives, uint32_t begin, uint32_t end, uint32_t depth, const tBox& bounds, const tBox& centroidBounds, const BuildSettings& settings)
+{
+    const uint32_t count = end - begin;
+    if (count == 1)
+        return end;
+
+    // binned SAH, cost of a split: traversalCost * area + left area * left count + right area * right count
+    // a leaf costs area * count, comparing unnormalized costs spares a division by the area
+    // small ranges near the leaves gain nothing from more bins than primitives
+    const uint32_t numBins = std::min(settings.numBins, std::max(count, 4u));
+    const T area = bounds.getSurfaceArea();
+    T bestCost = std::numeric_limits<T>::max();
+    int bestAxis = -1;
+    uint32_t bestBin = 0;
+    if (depth < MaxTreeDepth / 2)
+    {
+        // bin along all axes in one pass over the range
+        Bin bins[3][MaxBins];
+        T axisMins[3];
+        T binScales[3];
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            axisMins[axis] = getAxis(centroidBounds.min, axis);
+            const T axisExtent = getAxis(centroidBounds.max, axis) - axisMins[axis];
+            binScales[axis] = (axisExtent > 0) ? numBins / axisExtent : T(0);
+            for (uint32_t bin = 0; bin != numBins; ++bin)
+            {
+                bins[axis][bin].bounds = tBox::getEmpty();
+                bins[axis][bin].count = 0;
+            }
+        }
+        for (uint32_t i = begin; i != end; ++i)
+        {
+            const BuildPrimitive& primitive = pPrimitives[i];
+            for (int axis = 0; axis != 3; ++axis)
+            {
+                const uint32_t bin = std::min(static_cast<uint32_t>((getAxis(primitive.centroid, axis) - axisMins[axis]) * binScales[axis]), numBins - 1);
+                bins[axis][bin].bounds.expand(primitive.bounds);
+                ++bins[axis][bin].count;
+            }
+        }
+
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            if (binScales[axis] == 0)
+                continue;
+
+            // right sweep for the costs right of each plane, left sweep to combine them
+            T rightCosts[MaxBins];
+            tBox sideBounds = tBox::getEmpty();
+            uint32_t sideCount = 0;
+            for (uint32_t bin = numBins - 1; bin != 0; --bin)
+            {
+                sideBounds.expand(bins[axis][bin].bounds);
+                sideCount += bins[axis][bin].count;
+                rightCosts[bin] = sideBounds.getSurfaceArea() * sideCount;
+            }
+            sideBounds = tBox::getEmpty();
+            sideCount = 0;
+            for (uint32_t bin = 1; bin != numBins; ++bin)
+            {
+                sideBounds.expand(bins[axis][bin - 1].bounds);
+                sideCount += bins[axis][bin - 1].count;
+                const T cost = settings.traversalCost * area + sideBounds.getSurfaceArea() * sideCount + rightCosts[bin];
+                if (sideCount != 0 && sideCount != count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = bin;
+                }
+            }
+        }
+    }
+
+    if (bestAxis != -1 && (count > settings.maxLeafSize || bestCost < area * count))
+    {
+        const T axisMin = getAxis(centroidBounds.min, bestAxis);
+        const T binScale = numBins / (getAxis(centroidBounds.max, bestAxis) - axisMin);
+        BuildPrimitive* pMiddle = std::partition(pPrimitives + begin, pPrimitives + end, [&](const BuildPrimitive& primitive) {
+            return std::min(static_cast<uint32_t>((getAxis(primitive.centroid, bestAxis) - axisMin) * binScale), numBins - 1) < bestBin;
+        });
+        return static_cast<uint32_t>(pMiddle - pPrimitives);
+    }
+    if (count <= settings.maxLeafSize)
+        return end;
+
+    // too deep or no usable plane, e.g. coincident centroids: median split along the widest centroid axis
+    const tVec centroidExtent = centroidBounds.max - centroidBounds.min;
+    const int axis = (centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z) ? 0 : (centroidExtent.y >= centroidExtent.z) ? 1 : 2;
+    const uint32_t middle = begin + count / 2;
+    std::nth_element(pPrimitives + begin, pPrimitives + middle, pPrimitives + end, [axis](const BuildPrimitive& a, const BuildPrimitive& b) { return getAxis(a.centroid, axis) < getAxis(b.centroid, axis); });
+    return middle;
+}
+
+template <class T>
+inline void t_bvh<T>::refitNodes()
+{
+    for (size_t nodeIndex = nodes.size(); nodeIndex-- != 0;)
+    {
+        Node& node = nodes[nodeIndex];
+        if (node.isLeaf())
+        {
+            node.bounds = tBox::getEmpty();
+            for (uint32_t slot = node.offset; slot != node.offset + node.numPrimitives; ++slot)
+            {
+                node.bounds.expand(boxes[slot]);
+            }
+        }
+        else
+        {
+            node.bounds = nodes[nodeIndex + 1].bounds;
+            node.bounds.expand(nodes[node.offset].bounds);
+        }
+    }
+}
+
+template <class T>
+inline T t_bvh<T>::getAxis(const tVec& v, int axis)
+{
+    return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+}
+
+template <class T>
+inline bool t_bvh<T>::overlapsPrimitive(uint32_t slot, const tBox& box) const
+{
+    return spheres.empty() ? boxes[slot].overlaps(box) : spheres[slot].overlaps(box);
+}
+
+template <class T>
+inline bool t_bvh<T>::overlapsPrimitive(uint32_t slot, const tSphere& sphere) const
+{
+    return spheres.empty() ? sphere.overlaps(boxes[slot]) : sphere.overlaps(spheres[slot]);
+}
+
+template <class T>
+inline bool t_bvh<T>::overlapsPrimitives(uint32_t slotA, uint32_t slotB) const
+{
+    return spheres.empty() ? boxes[slotA].overlaps(boxes[slotB]) : spheres[slotA].overlaps(spheres[slotB]);
+}
+
+template <class T>
+inline T t_bvh<T>::getPrimitiveDistanceSqr(uint32_t slot, const tVec& point) const
+{
+    return spheres.empty() ? boxes[slot].getDistanceSqr(point) : spheres[slot].getDistanceSqr(point);
+}
+
+template <class T>
+inline bool t_bvh<T>::getRay(const tVec& origin, const tVec& direction, Ray& outRay)
+{
+    const T length = direction.getLength();
+    if (!(length > 0))
+        return false;
+
+    outRay.origin = origin;
+    outRay.direction = direction / length;
+    // axis parallel rays get infinite inverses, the slab test handles those
+    outRay.invDirection = tVec(T(1) / outRay.direction.x, T(1) / outRay.direction.y, T(1) / outRay.direction.z);
+    return true;
+}
+
+template <class T>
+inline bool t_bvh<T>::intersectBox(const Ray& ray, const tBox& box, T maxDistance, T& outDistance)
+{
+    T entry = 0;
+    T exit = maxDistance;
+    for (int axis = 0; axis != 3; ++axis)
+    {
+        const T origin = getAxis(ray.origin, axis);
+        const T invDirection = getAxis(ray.invDirection, axis);
+        T slabEntry = (getAxis(box.min, axis) - origin) * invDirection;
+        T slabExit = (getAxis(box.max, axis) - origin) * invDirection;
+        if (slabEntry > slabExit)
+            std::swap(slabEntry, slabExit);
+        // a ray along the slab's boundary gives NaN, which neither test below takes
+        entry = (slabEntry > entry) ? slabEntry : entry;
+        exit = (slabExit < exit) ? slabExit : exit;
+        if (entry > exit)
+            return false;
+    }
+    outDistance = entry;
+    return true;
+}
+
+template <class T>
+inline bool t_bvh<T>::intersectPrimitive(const Ray& ray, uint32_t slot, T maxDistance, T& outDistance) const
+{
+    if (spheres.empty())
+        return intersectBox(ray, boxes[slot], maxDistance, outDistance);
+
+    // |origin + t * direction - center| = radius, unit direction
+    const tSphere& sphere = spheres[slot];
+    const tVec offset = ray.origin - sphere.center;
+    const T radiusSqr = sphere.radius * sphere.radius;
+    if (offset.getLengthSquared() <= radiusSqr)
+    {
+        outDistance = 0;
+        return true;
+    }
+    const T b = offset.dot(ray.direction);
+    if (b > 0)
+        return false;
+    // discriminant from the offset at closest approach, b * b - c cancels out for small, distant spheres
+    const tVec closestOffset(offset.x - ray.direction.x * b, offset.y - ray.direction.y * b, offset.z - ray.direction.z * b);
+    const T discriminant = radiusSqr - closestOffset.getLengthSquared();
+    if (discriminant < 0)
+        return false;
+    outDistance = -b - MathT::sqrt<T>(discriminant);
+    return outDistance <= maxDistance;
+}
+
+template <class T>
+template <class SHAPE>
+inline void t_bvh<T>::searchOverlaps(const SHAPE& shape, fOverlapCallback callback, void* pUserData) const
+{
+    if (nodes.empty())
+        return;
+
+    uint32_t stack[MaxTreeDepth + 1];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0)
+    {
+        uint32_t nodeIndex = stack[--stackSize];
+        for (;;)
+        {
+            const Node& node = nodes[nodeIndex];
+            if (!shape.overlaps(node.bounds))
+                break;
+            if (node.isLeaf())
+            {
+                for (uint32_t slot = node.offset; slot != node.offset + node.numPrimitives; ++slot)
+                {
+                    if (overlapsPrimitive(slot, shape))
+                        callback(primitiveIndices[slot], pUserData);
+                }
+                break;
+            }
+            stack[stackSize++] = node.offset;
+            nodeIndex = nodeIndex + 1;
+        }
+    }
+}
+
+template <class T>
+template <class HIT_FUNC>
+inline void t_bvh<T>::searchRay(const Ray& ray, T maxDistance, HIT_FUNC& hitFunc) const
+{
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        T distance;
+    };
+
+    T rootDistance;
+    if (nodes.empty() || !intersectBox(ray, nodes[0].bounds, maxDistance, rootDistance))
+        return;
+
+    StackEntry stack[MaxTreeDepth + 1];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = {0, rootDistance};
+    while (stackSize != 0)
+    {
+        const StackEntry entry = stack[--stackSize];
+        // a closer hit since this node was queued
+        if (entry.distance > maxDistance)
+            continue;
+
+        const Node& node = nodes[entry.nodeIndex];
+        if (node.isLeaf())
+        {
+            for (uint32_t slot = node.offset; slot != node.offset + node.numPrimitives; ++slot)
+            {
+                T distance;
+                if (intersectPrimitive(ray, slot, maxDistance, distance))
+                    maxDistance = hitFunc(slot, distance);
+            }
+            continue;
+        }
+
+        // queue the farther child first so the nearer one is visited first
+        StackEntry children[2] = {{entry.nodeIndex + 1, 0}, {node.offset, 0}};
+        const bool isLeftHit = intersectBox(ray, nodes[children[0].nodeIndex].bounds, maxDistance, children[0].distance);
+        const bool isRightHit = intersectBox(ray, nodes[children[1].nodeIndex].bounds, maxDistance, children[1].distance);
+        if (isLeftHit && isRightHit)
+        {
+            const int nearChild = (children[1].distance < children[0].distance) ? 1 : 0;
+            stack[stackSize++] = children[1 - nearChild];
+            stack[stackSize++] = children[nearChild];
+        }
+        else if (isLeftHit)
+        {
+            stack[stackSize++] = children[0];
+        }
+        else if (isRightHit)
+        {
+            stack[stackSize++] = children[1];
+        }
+    }
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class T>
+inline void t_bvh<T>::refit(const std::vector<tBox>& inBoxes)
+{
+    for (size_t slot = 0; slot != boxes.size(); ++slot)
+    {
+        boxes[slot] = inBoxes[primitiveIndices[slot]];
+    }
+    refitNodes();
+}
+
+template <class T>
+inline void t_bvh<T>::refit(const std::vector<tSphere>& inSpheres)
+{
+    for (size_t slot = 0; slot != spheres.size(); ++slot)
+    {
+        spheres[slot] = inSpheres[primitiveIndices[slot]];
+        boxes[slot] = spheres[slot].getBounds();
+    }
+    refitNodes();
+}
+
+template <class T>
+inline uint32_t t_bvh<T>::getNumPrimitives() const
+{
+    return static_cast<uint32_t>(primitiveIndices.size());
+}
+
+template <class T>
+inline uint32_t t_bvh<T>::getNumNodes() const
+{
+    return static_cast<uint32_t>(nodes.size());
+}
+
+template <class T>
+inline T t_bvh<T>::getSAHCost() const
+{
+    if (nodes.empty())
+        return 0;
+
+    // probability of visiting a node: its area relative to the root's
+    const T rootArea = nodes[0].bounds.getSurfaceArea();
+    if (!(rootArea > 0))
+        return static_cast<T>(getNumPrimitives());
+    T cost = 0;
+    for (const Node& node : nodes)
+    {
+        const T nodeCost = node.isLeaf() ? static_cast<T>(node.numPrimitives) : T(1);
+        cost += nodeCost * node.bounds.getSurfaceArea() / rootArea;
+    }
+    return cost;
+}
+
+template <class T>
+inline void t_bvh<T>::findOverlaps(const tBox& box, fOverlapCallback callback, void* pUserData) const
+{
+    searchOverlaps(box, callback, pUserData);
+}
+
+template <class T>
+inline void t_bvh<T>::findOverlaps(const tSphere& sphere, fOverlapCallback callback, void* pUserData) const
+{
+    searchOverlaps(sphere, callback, pUserData);
+}
+
+template <class T>
+inline void t_bvh<T>::findOverlaps(const tBox& box, std::vector<uint32_t>& outIndices) const
+{
+    outIndices.clear();
+    searchOverlaps(box, [](uint32_t index, void* pUserData) { static_cast<std::vector<uint32_t>*>(pUserData)->push_back(index); }, &outIndices);
+}
+
+template <class T>
+inline void t_bvh<T>::findOverlaps(const tSphere& sphere, std::vector<uint32_t>& outIndices) const
+{
+    outIndices.clear();
+    searchOverlaps(sphere, [](uint32_t index, void* pUserData) { static_cast<std::vector<uint32_t>*>(pUserData)->push_back(index); }, &outIndices);
+}
+
+template <class T>
+inline void t_bvh<T>::findOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>>& outPairs) const
+{
+    outPairs.clear();
+    if (nodes.empty())
+        return;
+
+    // pairs of subtrees whose primitives may overlap, a subtree paired with itself stands for the pairs within it
+    auto addPair = [&](uint32_t slotA, uint32_t slotB) {
+        if (overlapsPrimitives(slotA, slotB))
+            outPairs.push_back(std::minmax(primitiveIndices[slotA], primitiveIndices[slotB]));
+    };
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.push_back({0, 0});
+    while (!stack.empty())
+    {
+        const std::pair<uint32_t, uint32_t> nodePair = stack.back();
+        stack.pop_back();
+        const Node& nodeA = nodes[nodePair.first];
+        const Node& nodeB = nodes[nodePair.second];
+
+        if (nodePair.first == nodePair.second)
+        {
+            if (nodeA.isLeaf())
+            {
+                for (uint32_t slotA = nodeA.offset; slotA != nodeA.offset + nodeA.numPrimitives; ++slotA)
+                {
+                    for (uint32_t slotB = slotA + 1; slotB != nodeA.offset + nodeA.numPrimitives; ++slotB)
+                    {
+                        addPair(slotA, slotB);
+                    }
+                }
+            }
+            else
+            {
+                const uint32_t leftChild = nodePair.first + 1;
+                stack.push_back({leftChild, leftChild});
+                stack.push_back({nodeA.offset, nodeA.offset});
+                stack.push_back({leftChild, nodeA.offset});
+            }
+            continue;
+        }
+
+        if (!nodeA.bounds.overlaps(nodeB.bounds))
+            continue;
+        if (nodeA.isLeaf() && nodeB.isLeaf())
+        {
+            for (uint32_t slotA = nodeA.offset; slotA != nodeA.offset + nodeA.numPrimitives; ++slotA)
+            {
+                for (uint32_t slotB = nodeB.offset; slotB != nodeB.offset + nodeB.numPrimitives; ++slotB)
+                {
+                    addPair(slotA, slotB);
+                }
+            }
+            continue;
+        }
+
+        // descend into the inner node with the larger box
+        const bool isDescendingA = !nodeA.isLeaf() && (nodeB.isLeaf() || nodeA.bounds.getSurfaceArea() >= nodeB.bounds.getSurfaceArea());
+        const uint32_t parent = isDescendingA ? nodePair.first : nodePair.second;
+        const uint32_t other = isDescendingA ? nodePair.second : nodePair.first;
+        stack.push_back({parent + 1, other});
+        stack.push_back({nodes[parent].offset, other});
+    }
+}
+
+template <class T>
+inline bool t_bvh<T>::findFirstRayHit(const tVec& origin, const tVec& direction, T maxDistance, RayHit& outHit) const
+{
+    Ray ray;
+    if (!getRay(origin, direction, ray))
+        return false;
+
+    uint32_t hitSlot = InvalidIndex;
+    T hitDistance = maxDistance;
+    auto onHit = [&](uint32_t slot, T distance) {
+        if (hitSlot == InvalidIndex || distance < hitDistance)
+        {
+            hitSlot = slot;
+            hitDistance = distance;
+        }
+        return hitDistance;
+    };
+    searchRay(ray, maxDistance, onHit);
+    if (hitSlot == InvalidIndex)
+        return false;
+
+    outHit.index = primitiveIndices[hitSlot];
+    outHit.distance = hitDistance;
+    return true;
+}
+
+template <class T>
+inline void t_bvh<T>::findRayHits(const tVec& origin, const tVec& direction, T maxDistance, std::vector<RayHit>& outHits) const
+{
+    outHits.clear();
+    Ray ray;
+    if (!getRay(origin, direction, ray))
+        return;
+
+    auto onHit = [&](uint32_t slot, T distance) {
+        outHits.push_back({primitiveIndices[slot], distance});
+        return maxDistance;
+    };
+    searchRay(ray, maxDistance, onHit);
+    std::sort(outHits.begin(), outHits.end(), [](const RayHit& a, const RayHit& b) { return a.distance < b.distance; });
+}
+
+template <class T>
+inline uint32_t t_bvh<T>::findNearestPrimitive(const tVec& point, T* outDistanceSqr) const
+{
+    if (nodes.empty())
+        return InvalidIndex;
+
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        T distanceSqr;
+    };
+
+    uint32_t bestSlot = InvalidIndex;
+    T bestDistanceSqr = std::numeric_limits<T>::max();
+    StackEntry stack[MaxTreeDepth + 1];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = {0, nodes[0].bounds.getDistanceSqr(point)};
+    while (stackSize != 0)
+    {
+        const StackEntry entry = stack[--stackSize];
+        if (entry.distanceSqr >= bestDistanceSqr)
+            continue;
+
+        const Node& node = nodes[entry.nodeIndex];
+        if (node.isLeaf())
+        {
+            for (uint32_t slot = node.offset; slot != node.offset + node.numPrimitives; ++slot)
+            {
+                const T distanceSqr = getPrimitiveDistanceSqr(slot, point);
+                if (distanceSqr < bestDistanceSqr)
+                {
+                    bestSlot = slot;
+                    bestDistanceSqr = distanceSqr;
+                }
+            }
+            continue;
+        }
+
+        // closer child on top of the stack
+        StackEntry children[2] = {{entry.nodeIndex + 1, 0}, {node.offset, 0}};
+        children[0].distanceSqr = nodes[children[0].nodeIndex].bounds.getDistanceSqr(point);
+        children[1].distanceSqr = nodes[children[1].nodeIndex].bounds.getDistanceSqr(point);
+        const int nearChild = (children[1].distanceSqr < children[0].distanceSqr) ? 1 : 0;
+        stack[stackSize++] = children[1 - nearChild];
+        stack[stackSize++] = children[nearChild];
+    }
+
+    // no finite distance, e.g. a NaN query point
+    if (bestSlot == InvalidIndex)
+        return InvalidIndex;
+
+    if (outDistanceSqr)
+        *outDistanceSqr = bestDistanceSqr;
+    return primitiveIndices[bestSlot];
+}
+#pragma endregion
+
+typedef t_bvh<float> bvh_32;
+typedef t_bvh<double> bvh_64;
+
+// bounding volume hierarchy over boxes or spheres
+typedef bvh_32 bvh;
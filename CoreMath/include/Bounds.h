@@ -0,0 +1,229 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+//
+// Sources:
+// Arvo, Transforming Axis-Aligned Bounding Boxes, Graphics Gems (1990)
+
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include <algorithm>
+#include <limits>
+
+// disabling 'loss of precision' warnings as literals will be typed w/ double precision
+#pragma warning(push)
+#pragma warning(disable : 4244)
+
+// 3d axis aligned bounding box
+//
+// float & double precision currently supported.
+//
+// see the end of the file for ease-of-use typedefs.
+// in general, use 'aabb' as the type around your code.
+//
+template <class T>
+class t_aabb
+{
+  public:
+    t_aabb() {}
+    t_aabb(const t_vec3<T>& inMin, const t_vec3<T>& inMax) : min(inMin), max(inMax) {}
+
+    // inverted box, expanding it by anything yields that thing's bounds
+    static t_aabb<T> getEmpty();
+
+    t_vec3<T> min;
+    t_vec3<T> max;
+
+    inline bool isEmpty() const;
+    inline t_vec3<T> getCenter() const;
+    inline T getSurfaceArea() const;
+
+    inline void expand(const t_vec3<T>& point);
+    inline void expand(const t_aabb<T>& box);
+
+    inline bool contains(const t_vec3<T>& point) const;
+    // touching boxes overlap
+    inline bool overlaps(const t_aabb<T>& box) const;
+    // 0 inside the box
+    inline T getDistanceSqr(const t_vec3<T>& point) const;
+
+    // bounds of the box after transforming it by m
+    inline t_aabb<T> getTransformed(const t_mat4<T>& m) const;
+};
+
+// 3d sphere
+//
+// float & double precision currently supported.
+//
+// see the end of the file for ease-of-use typedefs.
+// in general, use 'sphere' as the type around your code.
+//
+template <class T>
+class t_sphere
+{
+  public:
+    t_sphere() {}
+    t_sphere(const t_vec3<T>& inCenter, T inRadius) : center(inCenter), radius(inRadius) {}
+
+    t_vec3<T> center;
+    T radius;
+
+    inline t_aabb<T> getBounds() const;
+
+    // touching shapes overlap
+    inline bool overlaps(const t_sphere<T>& sphere) const;
+    inline bool overlaps(const t_aabb<T>& box) const;
+    // 0 inside the sphere
+    inline T getDistanceSqr(const t_vec3<T>& point) const;
+
+    // bounding sphere after transforming by m, the radius grows by (at most a bound on) m's largest stretch
+    inline t_sphere<T> getTransformed(const t_mat4<T>& m) const;
+};
+
+#pragma region Static_Definitions
+template <class T>
+inline t_aabb<T> t_aabb<T>::getEmpty()
+{
+    return t_aabb<T>(t_vec3<T>(std::numeric_limits<T>::max()), t_vec3<T>(std::numeric_limits<T>::lowest()));
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class T>
+inline bool t_aabb<T>::isEmpty() const
+{
+    return (min.x > max.x) || (min.y > max.y) || (min.z > max.z);
+}
+
+template <class T>
+inline t_vec3<T> t_aabb<T>::getCenter() const
+{
+    return t_vec3<T>((min.x + max.x) * 0.5, (min.y + max.y) * 0.5, (min.z + max.z) * 0.5);
+}
+
+template <class T>
+inline T t_aabb<T>::getSurfaceArea() const
+{
+    if (isEmpty())
+        return 0;
+    const t_vec3<T> extent = max - min;
+    return 2 * ((extent.x * extent.y) + (extent.y * extent.z) + (extent.z * extent.x));
+}
+
+template <class T>
+inline void t_aabb<T>::expand(const t_vec3<T>& point)
+{
+    min = t_vec3<T>(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+    max = t_vec3<T>(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+}
+
+template <class T>
+inline void t_aabb<T>::expand(const t_aabb<T>& box)
+{
+    min = t_vec3<T>(std::min(min.x, box.min.x), std::min(min.y, box.min.y), std::min(min.z, box.min.z));
+    max = t_vec3<T>(std::max(max.x, box.max.x), std::max(max.y, box.max.y), std::max(max.z, box.max.z));
+}
+
+template <class T>
+inline bool t_aabb<T>::contains(const t_vec3<T>& point) const
+{
+    return (point.x >= min.x) && (point.x <= max.x) && (point.y >= min.y) && (point.y <= max.y) && (point.z >= min.z) && (point.z <= max.z);
+}
+
+template <class T>
+inline bool t_aabb<T>::overlaps(const t_aabb<T>& box) const
+{
+    return (box.min.x <= max.x) && (box.max.x >= min.x) && (box.min.y <= max.y) && (box.max.y >= min.y) && (box.min.z <= max.z) && (box.max.z >= min.z);
+}
+
+template <class T>
+inline T t_aabb<T>::getDistanceSqr(const t_vec3<T>& point) const
+{
+    const t_vec3<T> closest(std::min(std::max(point.x, min.x), max.x), std::min(std::max(point.y, min.y), max.y), std::min(std::max(point.z, min.z), max.z));
+    return (closest - point).getLengthSquared();
+}
+
+template <class T>
+inline t_aabb<T> t_aabb<T>::getTransformed(const t_mat4<T>& m) const
+{
+    // each output axis is the translation plus the smaller & larger product of every matrix entry with the input extents
+    const T inMin[3] = {min.x, min.y, min.z};
+    const T inMax[3] = {max.x, max.y, max.z};
+    T outMin[3];
+    T outMax[3];
+    for (int row = 0; row != 3; ++row)
+    {
+        outMin[row] = outMax[row] = m.data[row][3];
+        for (int column = 0; column != 3; ++column)
+        {
+            const T a = m.data[row][column] * inMin[column];
+            const T b = m.data[row][column] * inMax[column];
+            outMin[row] += std::min(a, b);
+            outMax[row] += std::max(a, b);
+        }
+    }
+    return t_aabb<T>(t_vec3<T>(outMin[0], outMin[1], outMin[2]), t_vec3<T>(outMax[0], outMax[1], outMax[2]));
+}
+
+template <class T>
+inline t_aabb<T> t_sphere<T>::getBounds() const
+{
+    const t_vec3<T> extent(radius);
+    return t_aabb<T>(center - extent, center + extent);
+}
+
+template <class T>
+inline bool t_sphere<T>::overlaps(const t_sphere<T>& sphere) const
+{
+    const T radiusSum = radius + sphere.radius;
+    return (sphere.center - center).getLengthSquared() <= radiusSum * radiusSum;
+}
+
+template <class T>
+inline bool t_sphere<T>::overlaps(const t_aabb<T>& box) const
+{
+    return box.getDistanceSqr(center) <= radius * radius;
+}
+
+template <class T>
+inline T t_sphere<T>::getDistanceSqr(const t_vec3<T>& point) const
+{
+    const T distance = std::max((point - center).getLength() - radius, T(0));
+    return distance * distance;
+}
+
+template <class T>
+inline t_sphere<T> t_sphere<T>::getTransformed(const t_mat4<T>& m) const
+{
+    // the largest stretch of m is at most the largest row sum of |columns^T * columns| (Gershgorin)
+    // exact for rotation & scale, whose columns are orthogonal
+    t_vec3<T> columns[3];
+    for (int column = 0; column != 3; ++column)
+    {
+        columns[column] = t_vec3<T>(m.data[0][column], m.data[1][column], m.data[2][column]);
+    }
+    T maxScaleSqr = 0;
+    for (int i = 0; i != 3; ++i)
+    {
+        T rowSum = 0;
+        for (int j = 0; j != 3; ++j)
+        {
+            rowSum += MathT::abs<T>(columns[i].dot(columns[j]));
+        }
+        maxScaleSqr = std::max(maxScaleSqr, rowSum);
+    }
+    return t_sphere<T>(m * center, radius * MathT::sqrt<T>(maxScaleSqr));
+}
+#pragma endregion
+
+typedef t_aabb<float> aabb_32;
+typedef t_aabb<double> aabb_64;
+typedef t_sphere<float> sphere_32;
+typedef t_sphere<double> sphere_64;
+
+// 3d axis aligned bounding box
+typedef aabb_32 aabb;
+// 3d sphere
+typedef sphere_32 sphere;
+
+#pragma warning(pop)
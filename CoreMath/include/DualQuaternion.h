@@ -0,0 +1,104 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+// Sources:
+// https://en.wikipedia.org/wiki/Dual_quaternion
+// https://users.cs.utah.edu/~ladislav/kavan07skinning/kavan07skinning.pdf
+
+#pragma once
+#include "Quaternion.h"
+#include "Transform.h"
+#include "Vector3.h"
+
+// disabling 'loss of precision' warnings as literals will be typed w/ double precision
+#pragma warning(push)
+#pragma warning(disable : 4244)
+
+// rigid transform (rotation & translation) as a unit dual quaternion
+// real is the rotation, dual is half the translation quaternion times the rotation.
+// weighted sums of dual quaternions stay rigid once normalized, which dual quaternion skinning relies on.
+//
+// float & double precision currently supported. 32bit fixed point in the future, hopefully.
+//
+// see the end of the file for ease-of-use typedefs.
+// in general, use 'dual_quat' as the type around your code.
+//
+template <class T>
+class t_dual_quat
+{
+  public:
+    t_dual_quat() {}
+    t_dual_quat(const t_quat<T>& inReal, const t_quat<T>& inDual) : real(inReal), dual(inDual) {}
+    // rotates, then translates
+    t_dual_quat(const t_quat<T>& inRotation, const t_vec3<T>& inTranslation);
+    // moves points as inTransform.transformPoint does, minus the scaling
+    t_dual_quat(const t_transform<T>& inTransform);
+
+    static const t_dual_quat<T>& getIdentity();
+
+    inline t_vec3<T> getTranslation() const;
+
+    // divides both parts by the length of the real part
+    inline void normalize();
+
+    inline t_vec3<T> transformPoint(const t_vec3<T>& point) const;
+    inline t_vec3<T> transformVector(const t_vec3<T>& vector) const;
+
+    t_quat<T> real;
+    t_quat<T> dual;
+};
+
+template <class T>
+inline t_dual_quat<T>::t_dual_quat(const t_quat<T>& inRotation, const t_vec3<T>& inTranslation) : real(inRotation)
+{
+    const t_quat<T> product = t_quat<T>(0.0, inTranslation.x, inTranslation.y, inTranslation.z) * inRotation;
+    dual = t_quat<T>(0.5 * product.w, 0.5 * product.x, 0.5 * product.y, 0.5 * product.z);
+}
+
+template <class T>
+inline t_dual_quat<T>::t_dual_quat(const t_transform<T>& inTransform) : t_dual_quat<T>(inTransform.rotation, inTransform.rotation.rotateVector(inTransform.position))
+{
+}
+
+template <class T>
+inline const t_dual_quat<T>& t_dual_quat<T>::getIdentity()
+{
+    static const t_dual_quat<T> identity(t_quat<T>::getIdentity(), t_quat<T>(0.0, 0.0, 0.0, 0.0));
+    return identity;
+}
+
+template <class T>
+inline t_vec3<T> t_dual_quat<T>::getTranslation() const
+{
+    // vector part of 2 * dual * conjugate(real)
+    const t_vec3<T> cross = t_vec3<T>::cross(t_vec3<T>(real.x, real.y, real.z), t_vec3<T>(dual.x, dual.y, dual.z));
+    return t_vec3<T>(2.0 * (dual.x * real.w - real.x * dual.w + cross.x), 2.0 * (dual.y * real.w - real.y * dual.w + cross.y), 2.0 * (dual.z * real.w - real.z * dual.w + cross.z));
+}
+
+template <class T>
+inline void t_dual_quat<T>::normalize()
+{
+    const T length = real.getLength();
+    real = t_quat<T>(real.w / length, real.x / length, real.y / length, real.z / length);
+    dual = t_quat<T>(dual.w / length, dual.x / length, dual.y / length, dual.z / length);
+}
+
+template <class T>
+inline t_vec3<T> t_dual_quat<T>::transformPoint(const t_vec3<T>& point) const
+{
+    return real.rotateVector(point) + getTranslation();
+}
+
+template <class T>
+inline t_vec3<T> t_dual_quat<T>::transformVector(const t_vec3<T>& vector) const
+{
+    return real.rotateVector(vector);
+}
+
+typedef t_dual_quat<float> dual_quat_32;
+typedef t_dual_quat<double> dual_quat_64;
+
+// rigid transform as a unit dual quaternion
+typedef dual_quat_32 dual_quat;
+
+#pragma warning(pop)
@@ -0,0 +1,120 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "KDTree.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// k-d tree of 3D points supporting insertion, removal & movement
+// owns its points, each identified by a stable id
+//
+// points live in a small, linearly scanned insert buffer & a set of static KDTrees of doubling capacity.
+// a full insert buffer is merged with the smallest trees into the first tree big enough to hold them all,
+// so each point is rebuilt O(log n) times over its lifetime instead of the whole set being rebuilt per change.
+// removal tombstones a point in place, a tree is rebuilt on its own once half of it is tombstones.
+// queries are valid between any two operations.
+//
+// insert / remove / update: amortized O(log^2 n)
+// nearest neighbor search: O(log^2 n)
+//
+// Source:
+// Bentley & Saxe, Decomposable searching problems I: Static-to-dynamic transformation
+// https://doi.org/10.1016/0196-6774(80)90015-2
+//
+class DynamicKDTree
+{
+  public:
+    typedef uint32_t tPointId;
+    static constexpr tPointId InvalidId = UINT32_MAX;
+
+    struct Neighbor
+    {
+        tPointId id;
+        float distanceSqr;
+    };
+
+    // range query callback, invoked once per point found
+    typedef void (*fPointCallback)(tPointId id, const vec3& point, void* pUserData);
+
+    DynamicKDTree();
+    // ids are assigned in input order, 0 to n - 1
+    DynamicKDTree(const std::vector<vec3>& inPoints);
+
+    // returns: id of the new point
+    tPointId insert(const vec3& point);
+    // returns: false if id isn't a live point
+    bool remove(tPointId id);
+    // moves a point, keeping its id
+    // returns: false if id isn't a live point
+    bool updatePosition(tPointId id, const vec3& point);
+
+    bool isValid(tPointId id) const;
+    const vec3& getPosition(tPointId id) const;
+    uint32_t getNumPoints() const;
+
+    // returns: InvalidId if the tree is empty
+    tPointId findNearestNeighbor(const vec3& inVec) const;
+
+    // writes up to k nearest points to outNeighbors (capacity of at least k), closest first
+    // returns: number of neighbors found, min(k, number of points)
+    uint32_t findKNearestNeighbors(const vec3& inVec, uint32_t k, Neighbor* outNeighbors) const;
+
+    // invokes callback for every point closer than radius
+    void findPointsInRadius(const vec3& inVec, float radius, fPointCallback callback, void* pUserData) const;
+
+  protected:
+    // capacity of the insert buffer & of the smallest tree
+    static constexpr uint32_t BaseCapacity = 64;
+    // tree i holds up to BaseCapacity << i points
+    static constexpr uint32_t MaxLevels = 26;
+    // PointLocation::level markers
+    static constexpr uint32_t InsertBufferLevel = UINT32_MAX - 1;
+    static constexpr uint32_t FreeLevel = UINT32_MAX;
+
+    // a static tree over its own copy of the points
+    // removed points keep their slot with an InvalidId tombstone until the level is rebuilt
+    struct Level
+    {
+        std::vector<vec3> points;
+        std::vector<tPointId> ids;
+        uint32_t numRemoved = 0;
+        std::unique_ptr<KDTree> pTree;
+
+        uint32_t getNumLive() const
+        {
+            return static_cast<uint32_t>(ids.size()) - numRemoved;
+        }
+    };
+
+    // where a point currently lives
+    struct PointLocation
+    {
+        uint32_t level;
+        uint32_t slot;
+    };
+
+    // unsorted recent insertions, no tombstones
+    std::vector<vec3> insertBufferPoints;
+    std::vector<tPointId> insertBufferIds;
+
+    Level levels[MaxLevels];
+
+    // indexed by id
+    std::vector<PointLocation> locations;
+    std::vector<tPointId> freeIds;
+    uint32_t numPoints = 0;
+
+    tPointId allocateId();
+    void addToInsertBuffer(tPointId id, const vec3& point);
+    // takes a point out of wherever it lives, without freeing its id
+    void detach(tPointId id);
+
+    // merges the insert buffer & the smallest levels into one new level
+    void flushInsertBuffer();
+    // rebuilds a level from its live points
+    void rebuildLevel(uint32_t levelIndex, std::vector<vec3>& inPoints, std::vector<tPointId>& inIds);
+
+    static bool isLivePoint(const vec3* pPoint, void* pUserData);
+};
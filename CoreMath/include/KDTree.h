@@ -2,37 +2,2352 @@
 // https://github.com/rshemaka/CoreMath
 
 #pragma once
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Vector2.h"
 #include "Vector3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-// k-d tree of 3D points
+// coordinate access for k-d tree points
+// T: coordinate type, get<AXIS>(point): coordinate along an axis
+//
+// supports t_vec2, t_vec3 & anything indexable with operator[] (e.g. std::array<float, K>)
+// specialize for other point types
+//
+template <class VEC>
+struct t_kdtree_point
+{
+    typedef typename std::decay<decltype(std::declval<const VEC&>()[0])>::type T;
+
+    template <int AXIS>
+    static T get(const VEC& v)
+    {
+        return v[AXIS];
+    }
+};
+
+template <class T_>
+struct t_kdtree_point<t_vec2<T_>>
+{
+    typedef T_ T;
+
+    template <int AXIS>
+    static T get(const t_vec2<T>& v)
+    {
+        static_assert(AXIS >= 0 && AXIS < 2, "t_vec2 has 2 axes");
+        return (AXIS == 0) ? v.x : v.y;
+    }
+};
+
+template <class T_>
+struct t_kdtree_point<t_vec3<T_>>
+{
+    typedef T_ T;
+
+    template <int AXIS>
+    static T get(const t_vec3<T>& v)
+    {
+        static_assert(AXIS >= 0 && AXIS < 3, "t_vec3 has 3 axes");
+        return (AXIS == 0) ? v.x : (AXIS == 1) ? v.y : v.z;
+    }
+};
+
+// non-template k-d tree helpers
+namespace KDTreeUtil
+{
+    // number of nodes in a subtree built over numPoints points
+    uint32_t getSubtreeNodeCount(uint32_t numPoints, uint32_t leafSize);
+
+    // copies the coordinates of point along AXES
+    template <class VEC, int... AXES>
+    void getCoordinates(const VEC& point, typename t_kdtree_point<VEC>::T* outCoords, std::integer_sequence<int, AXES...>)
+    {
+        typedef t_kdtree_point<VEC> tPoint;
+        const typename tPoint::T coords[] = {tPoint::template get<AXES>(point)...};
+        for (size_t axis = 0; axis != sizeof...(AXES); ++axis)
+        {
+            outCoords[axis] = coords[axis];
+        }
+    }
+
+    // copies the first K coordinates of a point
+    template <int K, class VEC>
+    void getCoordinates(const VEC& point, typename t_kdtree_point<VEC>::T* outCoords)
+    {
+        getCoordinates(point, outCoords, std::make_integer_sequence<int, K>());
+    }
+
+    // squared distances from query to count points stored as structure of arrays, one coordinate array per axis
+    template <class T, int K>
+    void computeDistancesSqr(const T* const* pCoords, uint32_t count, const T* query, T* outDistancesSqr)
+    {
+        // same operation order as t_vec3::getLengthSquared
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            T distanceSqr = 0;
+            for (int axis = 0; axis != K; ++axis)
+            {
+                const T delta = pCoords[axis][i] - query[axis];
+                distanceSqr += delta * delta;
+            }
+            outDistancesSqr[i] = distanceSqr;
+        }
+    }
+
+    // vectorized under COREMATH_SIMD, see KDTree.cpp
+    template <>
+    void computeDistancesSqr<float, 2>(const float* const* pCoords, uint32_t count, const float* query, float* outDistancesSqr);
+    template <>
+    void computeDistancesSqr<float, 3>(const float* const* pCoords, uint32_t count, const float* query, float* outDistancesSqr);
+} // namespace KDTreeUtil
+
+// counters of one or more k-d tree queries
+struct KDTreeQueryStats
+{
+    uint64_t numQueries = 0;
+    uint64_t numNodesVisited = 0;
+    uint64_t numLeavesScanned = 0;
+    // points measured against the query, by distance or box containment
+    uint64_t numDistanceEvaluations = 0;
+    // queued far side subtrees the search came back to & visited
+    uint64_t numBacktracks = 0;
+    // deepest node visited, the root is at depth 0
+    uint32_t maxDepth = 0;
+
+    KDTreeQueryStats& operator+=(const KDTreeQueryStats& other)
+    {
+        numQueries += other.numQueries;
+        numNodesVisited += other.numNodesVisited;
+        numLeavesScanned += other.numLeavesScanned;
+        numDistanceEvaluations += other.numDistanceEvaluations;
+        numBacktracks += other.numBacktracks;
+        maxDepth = std::max(maxDepth, other.maxDepth);
+        return *this;
+    }
+};
+
+// per-thread k-d tree query counters
+// define COREMATH_KDTREE_STATS project-wide to record them. otherwise queries contain no counting code at all
+// & every getter reports zeros.
+namespace KDTreeStats
+{
+#if defined(COREMATH_KDTREE_STATS)
+    constexpr bool Enabled = true;
+#else
+    constexpr bool Enabled = false;
+#endif
+
+    // last query made on the calling thread
+    KDTreeQueryStats getLastQuery();
+    // queries made on the calling thread since the last reset
+    KDTreeQueryStats getThreadTotals();
+    // queries made on every thread since the last reset, finished threads (e.g. batch query workers) included
+    KDTreeQueryStats getTotals();
+    // zeroes the totals of every thread, while no queries are running
+    void reset();
+
+    // adds a finished query to the calling thread's counters
+    void recordQuery(const KDTreeQueryStats& queryStats);
+
+    // counters of a single query, recorded when it goes out of scope
+    // empty no-ops unless ENABLED, MAX_DEPTH: capacity of the query's node stack
+    template <bool ENABLED, uint32_t MAX_DEPTH>
+    struct t_query_counters
+    {
+        void visitNode() {}
+        void scanLeaf(uint32_t) {}
+        void evaluateDistance() {}
+        void evaluateDistances(uint32_t) {}
+        void descend() {}
+        void pushNode(uint32_t) {}
+        void popNode(uint32_t) {}
+    };
+
+    template <uint32_t MAX_DEPTH>
+    struct t_query_counters<true, MAX_DEPTH>
+    {
+        KDTreeQueryStats stats;
+        uint32_t depth = 0;
+        // depth of every node on the query's stack
+        uint32_t stackDepths[MAX_DEPTH];
+        bool backtracking = false;
+
+        t_query_counters()
+        {
+            stats.numQueries = 1;
+        }
+        ~t_query_counters()
+        {
+            recordQuery(stats);
+        }
+
+        void visitNode()
+        {
+            ++stats.numNodesVisited;
+            stats.numBacktracks += backtracking ? 1 : 0;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+            backtracking = false;
+        }
+        void scanLeaf(uint32_t numPoints)
+        {
+            ++stats.numLeavesScanned;
+            stats.numDistanceEvaluations += numPoints;
+        }
+        void evaluateDistance()
+        {
+            ++stats.numDistanceEvaluations;
+        }
+        void evaluateDistances(uint32_t numPoints)
+        {
+            stats.numDistanceEvaluations += numPoints;
+        }
+        // moving on to a child of the current node
+        void descend()
+        {
+            ++depth;
+        }
+        // a child of the current node queued at stackIndex, & taken back out
+        void pushNode(uint32_t stackIndex)
+        {
+            stackDepths[stackIndex] = depth + 1;
+        }
+        void popNode(uint32_t stackIndex)
+        {
+            depth = stackDepths[stackIndex];
+            backtracking = true;
+        }
+    };
+} // namespace KDTreeStats
+
+// k-d tree of K dimensional points
+// construction: O(n log n)
 // nearest neighbor search: O(log n)
-// maintains pointers to the contents of an input std::vector<vec3>
+// k-nearest neighbor search: O(k log n)
+// radius & box search: O(log n + m), m points found
+// references the contents of an input std::vector<VEC>, or keeps its own copy in tree order (BuildSettings::copyPoints)
+// results identify points by pointer or by index in the input vector
+// nodes are stored in a single flat array in depth-first build order, linked by index
+// relocatable: save() writes the tree & its points to a file, load() maps it back for queries without a rebuild
+// split axes are chosen per node by a BuildSettings::splitPolicy
+// optional per-node bounding boxes (BuildSettings::nodeBounds) prune subtrees by their distance to the query
+// small subranges are stored as leaf buckets, scanned with a vectorized distance kernel
+// optional multi-threaded construction & batched queries
+// queries are const & safe to run concurrently from any number of threads
+// queries are iterative with a small fixed size stack, for threads with little stack space
+// optional per-thread query counters, see KDTreeStats
+//
+// VEC needs at least K axes, see t_kdtree_point. only the first K are indexed, e.g. t_kdtree<vec3, 2> ignores z.
+// see the end of the file for ease-of-use typedefs.
 //
 // Source:
 // http://web.stanford.edu/class/cs106l/handouts/assignment-3-kdtree.pdf
 // https://en.wikipedia.org/wiki/K-d_tree
 //
-class KDTree
+template <class VEC, int K>
+class t_kdtree
 {
+    static_assert(K >= 1, "k-d trees need at least one axis");
+
   public:
-    KDTree(const std::vector<vec3>& inPoints);
-    virtual ~KDTree();
+    typedef t_kdtree_point<VEC> tPoint;
+    typedef typename tPoint::T T;
+
+    // upper bound on BuildSettings::leafSize
+    static constexpr uint32_t MaxLeafSize = 64;
+
+    // query results identify points either by pointer or by their index in the input vector
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    // how inner nodes pick the axis to split on
+    enum class SplitPolicy
+    {
+        // x, y, z, x... by depth, no analysis
+        Cycle,
+        // axis of the widest bounding box extent of the node's points, for anisotropic data
+        WidestExtent,
+        // axis of the highest coordinate variance of the node's points, ignores sparse outliers
+        MaxVariance
+    };
+
+    // per-node bounding boxes of the points below each node
+    // searches skip nodes whose box is out of range, tighter than the splitting planes in clustered data
+    enum class NodeBounds
+    {
+        None,
+        // 2 * K coordinates per node
+        Full,
+        // 2 * K 16 bit steps per node, conservatively rounded in the frame of the root box
+        // floating point coordinates only, others store Full bounds
+        Quantized
+    };
+
+    struct BuildSettings
+    {
+        // subtrees above this depth are built on worker threads, 0 builds serially
+        // the resulting tree is identical for any value
+        int parallelDepth = 0;
+        // subranges of up to this many points are stored as one leaf & scanned linearly, [1, MaxLeafSize]
+        uint32_t leafSize = 16;
+        SplitPolicy splitPolicy = SplitPolicy::Cycle;
+        NodeBounds nodeBounds = NodeBounds::None;
+        // store a copy of the points in tree order instead of pointing into the input vector
+        // the input may then change or be freed, pointer results point into the copy & neighboring results share cache lines
+        bool copyPoints = false;
+    };
+
+    t_kdtree(const std::vector<VEC>& inPoints);
+    t_kdtree(const std::vector<VEC>& inPoints, const BuildSettings& settings);
+
+    // queries read through views into owned or mapped storage
+    t_kdtree(const t_kdtree&) = delete;
+    t_kdtree& operator=(const t_kdtree&) = delete;
+    t_kdtree(t_kdtree&&) = default;
+    t_kdtree& operator=(t_kdtree&&) = default;
+
+    // writes the tree & a copy of its points in tree order
+    // returns: false if the file couldn't be written
+    bool save(const char* path) const;
+    // maps a file written by save() for the same VEC & K, queries read straight from the mapping
+    // mapped pages are shared between processes loading the same file, pointer results point into them
+    // returns: nullptr if the file is missing, truncated or of another format
+    static std::unique_ptr<t_kdtree> load(const char* path);
+
+    uint32_t getNumPoints() const;
 
-    const vec3* findNearestNeighbor(const vec3& inVec);
+    struct Neighbor
+    {
+        const VEC* pPoint;
+        T distanceSqr;
+    };
+    struct IndexNeighbor
+    {
+        uint32_t index;
+        T distanceSqr;
+    };
+
+    // range query callbacks, invoked once per point found
+    typedef void (*fPointCallback)(const VEC* pPoint, void* pUserData);
+    typedef void (*fIndexCallback)(uint32_t index, void* pUserData);
+
+    // search filter, return false to skip a point
+    typedef bool (*fPointFilter)(const VEC* pPoint, void* pUserData);
+
+    struct BatchSettings
+    {
+        // worker threads, 0 uses every hardware thread
+        uint32_t numThreads = 0;
+        // visit queries in Morton (z-curve) order, so consecutive queries share the upper levels of the tree in cache
+        bool sortQueries = false;
+    };
+
+    const VEC* findNearestNeighbor(const VEC& inVec) const;
+    // nearest point accepted by filter, nullptr if there is none
+    const VEC* findNearestNeighbor(const VEC& inVec, fPointFilter filter, void* pUserData) const;
+    // returns: input index of the nearest point, InvalidIndex if the tree is empty
+    uint32_t findNearestNeighborIndex(const VEC& inVec) const;
+
+    struct ApproximateSettings
+    {
+        // the result is at most (1 + epsilon) times further away than the true nearest neighbor
+        float epsilon = 0.f;
+        // stop after visiting this many nodes & return the best point so far, 0 for no limit
+        // bounds worst case latency, but voids the epsilon guarantee when hit
+        uint32_t maxVisitedNodes = 0;
+    };
+
+    // approximate nearest neighbor, trades accuracy for fewer node visits
+    // outVisitedNodes (optional) receives the number of nodes visited
+    const VEC* findApproximateNearestNeighbor(const VEC& inVec, const ApproximateSettings& settings, uint32_t* outVisitedNodes = nullptr) const;
+
+    // nearest neighbor of each query point, outResults[i] for inQueries[i]
+    // spreads the work across threads
+    void findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, const VEC** outResults) const;
+    void findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, const VEC** outResults, const BatchSettings& settings) const;
+    // as above, writing input indices
+    void findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, uint32_t* outIndices) const;
+    void findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, uint32_t* outIndices, const BatchSettings& settings) const;
+
+    // writes up to k nearest points to outNeighbors (capacity of at least k), closest first
+    // returns: number of neighbors found, min(k, number of points)
+    // no allocation, outNeighbors is used as the candidate heap during the search
+    uint32_t findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors) const;
+    uint32_t findKNearestNeighbors(const VEC& inVec, uint32_t k, IndexNeighbor* outNeighbors) const;
+    // as above, outNeighbors is resized to the number of neighbors found
+    void findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<Neighbor>& outNeighbors) const;
+    void findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<IndexNeighbor>& outNeighbors) const;
+    // as above, only considering points accepted by filter
+    uint32_t findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors, fPointFilter filter, void* pUserData) const;
+
+    // writes points closer than radius to outPoints, up to maxPoints
+    // returns: total number of points found, may exceed maxPoints
+    uint32_t findPointsInRadius(const VEC& inVec, T radius, const VEC** outPoints, uint32_t maxPoints) const;
+    uint32_t findPointsInRadius(const VEC& inVec, T radius, uint32_t* outIndices, uint32_t maxPoints) const;
+    // invokes callback for every point closer than radius
+    void findPointsInRadius(const VEC& inVec, T radius, fPointCallback callback, void* pUserData) const;
+    void findPointsInRadius(const VEC& inVec, T radius, fIndexCallback callback, void* pUserData) const;
+
+    // writes points inside the axis aligned box [boxMin, boxMax] to outPoints, up to maxPoints
+    // returns: total number of points found, may exceed maxPoints
+    uint32_t findPointsInBox(const VEC& boxMin, const VEC& boxMax, const VEC** outPoints, uint32_t maxPoints) const;
+    uint32_t findPointsInBox(const VEC& boxMin, const VEC& boxMax, uint32_t* outIndices, uint32_t maxPoints) const;
+    // invokes callback for every point inside the axis aligned box [boxMin, boxMax]
+    void findPointsInBox(const VEC& boxMin, const VEC& boxMax, fPointCallback callback, void* pUserData) const;
+    void findPointsInBox(const VEC& boxMin, const VEC& boxMax, fIndexCallback callback, void* pUserData) const;
+
+    // thick ray & segment queries, for picking & visibility
+    // a point is hit when it's closer than radius to the ray, rayDistance: how far along the ray its closest ray point lies
+    // cells are visited front to back, only where the thick ray passes through them
+    struct RayHit
+    {
+        const VEC* pPoint;
+        T rayDistance;
+        T distanceSqr;
+    };
+    struct IndexRayHit
+    {
+        uint32_t index;
+        T rayDistance;
+        T distanceSqr;
+    };
+
+    // first point hit by the ray from origin along direction (any length), within maxDistance along it
+    // returns: false if no point is hit
+    bool findFirstRayHit(const VEC& origin, const VEC& direction, T radius, T maxDistance, RayHit& outHit) const;
+    bool findFirstRayHit(const VEC& origin, const VEC& direction, T radius, T maxDistance, IndexRayHit& outHit) const;
+    // writes the first maxHits points hit to outHits, in order along the ray, the search stops once no closer hit is possible
+    // returns: number of hits written
+    uint32_t findRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, RayHit* outHits, uint32_t maxHits) const;
+    uint32_t findRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, IndexRayHit* outHits, uint32_t maxHits) const;
+    // every point closer than radius to the segment [start, end], in order from start
+    void findPointsNearSegment(const VEC& start, const VEC& end, T radius, std::vector<RayHit>& outHits) const;
+    void findPointsNearSegment(const VEC& start, const VEC& end, T radius, std::vector<IndexRayHit>& outHits) const;
+
+    // k nearest neighbor graph over the tree's own points, in compressed sparse row form
+    // neighbors of input point i: neighbors[offsets[i]] to neighbors[offsets[i + 1]], closest first, input indices
+    struct NeighborGraph
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> neighbors;
+        std::vector<T> distancesSqr;
+    };
+
+    // k nearest other points of every point, min(k, number of points - 1) each
+    // the points of a leaf are searched together, sharing one traversal, & leaves are spread across threads
+    // KDTreeStats count each shared traversal as one query
+    void findAllKNearestNeighbors(uint32_t k, NeighborGraph& outGraph) const;
+    void findAllKNearestNeighbors(uint32_t k, NeighborGraph& outGraph, const BatchSettings& settings) const;
 
   protected:
-    typedef std::vector<const vec3*> tConstPointRefs;
+    // indices into the input points, partitioned in place during the build, in tree order after
+    typedef std::vector<uint32_t> tPointIndices;
+    typedef tPointIndices::iterator tPointIndexIter;
+
+    static constexpr uint32_t InvalidNode = UINT32_MAX;
+    static constexpr uint32_t InvalidPoint = UINT32_MAX;
 
-    // protected recursive constructor
-    KDTree(tConstPointRefs& inPoints, int depth);
-    void init(tConstPointRefs& inPoints, int depth);
+    // file format, bump FileVersion on any layout change
+    static constexpr uint32_t FileMagic = 0x5444544b; // "KTDT"
+    static constexpr uint32_t FileVersion = 4;
+    static constexpr uint64_t FileAlignment = 64;
+
+    // below this many points a subtree isn't worth a worker thread
+    static constexpr uint32_t MinParallelBuildPoints = 1 << 12;
+    // queries handed to a batch worker at a time
+    static constexpr uint32_t BatchQueryBlockSize = 256;
+    // nodes handed to an all k nearest neighbors worker at a time
+    static constexpr uint32_t AllKNearestBlockSize = 64;
+    // median splits halve every range, so no tree over 32 bit point indices is deeper than this
+    // bounds init recursion & the fixed size search stacks, which hold at most one pending node per level
+    static constexpr uint32_t MaxTreeDepth = 32;
+    // largest NodeBounds::Quantized step
+    static constexpr uint32_t MaxQuantizedStep = UINT16_MAX;
 
     // tree node structure
-    const vec3* pData;
-    KDTree* pLeftChild;
-    KDTree* pRightChild;
+    // inner nodes split on a median point, leaves (splitPoint == InvalidPoint) own a range of the tree ordered points
+    // inner nodes always have a left child, stored right after them
+    // plain indices only, so nodes can be written to & mapped from a file as is
+    struct Node
+    {
+        // tree order index of the median point
+        uint32_t splitPoint;
+        union
+        {
+            uint32_t splitAxis;
+            uint32_t firstPoint;
+        };
+        union
+        {
+            uint32_t rightChild;
+            uint32_t numPoints;
+        };
+
+        bool isLeaf() const
+        {
+            return splitPoint == InvalidPoint;
+        }
+    };
+
+    // box of the points in a subtree
+    struct Bounds
+    {
+        T min[K];
+        T max[K];
+    };
+    // as above, in steps of a QuantizationFrame
+    struct QuantizedBounds
+    {
+        uint16_t min[K];
+        uint16_t max[K];
+    };
+    // quantized coordinate = origin + step * quantized value
+    struct QuantizationFrame
+    {
+        T origin[K];
+        T step[K];
+    };
+
+    // leading block of a saved tree, followed by sections at the given offsets
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t numAxes;
+        uint32_t coordinateSize;
+        uint32_t pointSize;
+        uint32_t numPoints;
+        uint32_t numNodes;
+        uint32_t nodeBounds;
+        uint64_t nodesOffset;
+        uint64_t coordsOffset[K];
+        uint64_t pointIndicesOffset;
+        uint64_t pointsOffset;
+        // NodeBounds::Full: Bounds per node, NodeBounds::Quantized: QuantizationFrame & QuantizedBounds per node
+        uint64_t boundsOffset;
+        uint64_t fileSize;
+    };
+
+    // storage views, all queries go through these
+    // they point into the owned vectors below for built trees & into the mapping for loaded trees
+    const Node* pNodes = nullptr;
+    uint32_t numNodes = 0;
+    // every point in tree order, structure of arrays for vectorized leaf scans
+    const T* pCoords[K] = {};
+    // input index of every point in tree order
+    const uint32_t* pPointIndices = nullptr;
+    // the input points, or a copy in tree order
+    const VEC* pPoints = nullptr;
+    bool pointsInTreeOrder = false;
+    uint32_t numPoints = 0;
+    // indexed by node, set by nodeBounds
+    NodeBounds nodeBounds = NodeBounds::None;
+    const Bounds* pBounds = nullptr;
+    const QuantizedBounds* pQuantizedBounds = nullptr;
+    QuantizationFrame quantizationFrame = {};
+
+    // owned storage, all nodes, root first
+    std::vector<Node> nodes;
+    std::vector<T> pointCoords[K];
+    tPointIndices pointIndices;
+    // BuildSettings::copyPoints only
+    std::vector<VEC> points;
+    // BuildSettings::nodeBounds only
+    std::vector<Bounds> bounds;
+    std::vector<QuantizedBounds> quantizedBounds;
+
+    // mapped storage
+    std::unique_ptr<MappedFile> pMapping;
+
+    t_kdtree() {}
+
+    const VEC* getPoint(uint32_t treeIndex) const
+    {
+        return pointsInTreeOrder ? (pPoints + treeIndex) : (pPoints + pPointIndices[treeIndex]);
+    }
+
+    // converts a tree order index to a query result
+    void getResult(uint32_t treeIndex, const VEC*& outPoint) const
+    {
+        outPoint = getPoint(treeIndex);
+    }
+    void getResult(uint32_t treeIndex, uint32_t& outIndex) const
+    {
+        outIndex = pPointIndices[treeIndex];
+    }
+    void getResult(uint32_t treeIndex, T distanceSqr, Neighbor& outNeighbor) const
+    {
+        outNeighbor = {getPoint(treeIndex), distanceSqr};
+    }
+    void getResult(uint32_t treeIndex, T distanceSqr, IndexNeighbor& outNeighbor) const
+    {
+        outNeighbor = {pPointIndices[treeIndex], distanceSqr};
+    }
+    void getResult(uint32_t treeIndex, T rayDistance, T distanceSqr, RayHit& outHit) const
+    {
+        outHit = {getPoint(treeIndex), rayDistance, distanceSqr};
+    }
+    void getResult(uint32_t treeIndex, T rayDistance, T distanceSqr, IndexRayHit& outHit) const
+    {
+        outHit = {pPointIndices[treeIndex], rayDistance, distanceSqr};
+    }
+    static void getEmptyResult(const VEC*& outPoint)
+    {
+        outPoint = nullptr;
+    }
+    static void getEmptyResult(uint32_t& outIndex)
+    {
+        outIndex = InvalidIndex;
+    }
+
+    static uint64_t alignFileOffset(uint64_t offset)
+    {
+        return (offset + FileAlignment - 1) & ~(FileAlignment - 1);
+    }
+    // section layout of a tree, everything but magic & version
+    static FileHeader getFileLayout(uint32_t inNumPoints, uint32_t inNumNodes, NodeBounds inNodeBounds);
+
+    // search collectors, fed points by tree order index
+    // exhaustive searches visit every node that can't be pruned
+    struct UnboundedSearch
+    {
+        bool visitNode()
+        {
+            return true;
+        }
+    };
+
+    // single nearest point
+    struct NearestCollector : UnboundedSearch
+    {
+        uint32_t result = InvalidPoint;
+        T minDistSqr = std::numeric_limits<T>::max();
+
+        T getMaxDistSqr() const
+        {
+            return minDistSqr;
+        }
+        void add(uint32_t treeIndex, T distanceSqr)
+        {
+            if (distanceSqr < minDistSqr)
+            {
+                // new winner!
+                minDistSqr = distanceSqr;
+                result = treeIndex;
+            }
+        }
+    };
+
+    // single approximately nearest point
+    // prunes subtrees that can't be closer than the best point by a factor of (1 + epsilon), within a node budget
+    struct ApproximateNearestCollector : NearestCollector
+    {
+        T pruneScaleSqr;
+        uint32_t maxVisitedNodes;
+        uint32_t numVisitedNodes = 0;
+
+        ApproximateNearestCollector(float epsilon, uint32_t inMaxVisitedNodes) : pruneScaleSqr(T(1) / ((T(1) + epsilon) * (T(1) + epsilon))), maxVisitedNodes(inMaxVisitedNodes) {}
+
+        T getMaxDistSqr() const
+        {
+            return this->minDistSqr * pruneScaleSqr;
+        }
+        bool visitNode()
+        {
+            if (maxVisitedNodes != 0 && numVisitedNodes == maxVisitedNodes)
+                return false;
+            ++numVisitedNodes;
+            return true;
+        }
+    };
+
+    // k nearest points, bounded max-heap over a caller provided buffer of Neighbor or IndexNeighbor
+    template <class NEIGHBOR>
+    struct KNearestCollector : UnboundedSearch
+    {
+        const t_kdtree& tree;
+        NEIGHBOR* pHeap;
+        uint32_t capacity;
+        uint32_t count = 0;
+
+        KNearestCollector(const t_kdtree& inTree, NEIGHBOR* inHeap, uint32_t inCapacity) : tree(inTree), pHeap(inHeap), capacity(inCapacity) {}
+
+        static bool compareDistance(const NEIGHBOR& l, const NEIGHBOR& r)
+        {
+            return l.distanceSqr < r.distanceSqr;
+        }
+
+        T getMaxDistSqr() const
+        {
+            // until full, anything is a candidate
+            return (count == capacity) ? pHeap[0].distanceSqr : std::numeric_limits<T>::max();
+        }
+        void add(uint32_t treeIndex, T distanceSqr)
+        {
+            if (count < capacity)
+            {
+                tree.getResult(treeIndex, distanceSqr, pHeap[count++]);
+                std::push_heap(pHeap, pHeap + count, compareDistance);
+            }
+            else if (distanceSqr < pHeap[0].distanceSqr)
+            {
+                // evict the furthest candidate
+                std::pop_heap(pHeap, pHeap + count, compareDistance);
+                tree.getResult(treeIndex, distanceSqr, pHeap[count - 1]);
+                std::push_heap(pHeap, pHeap + count, compareDistance);
+            }
+        }
+        void sort()
+        {
+            std::sort_heap(pHeap, pHeap + count, compareDistance);
+        }
+    };
+
+    // every point within a fixed radius, forwarded to a sink
+    template <class SINK>
+    struct RadiusCollector : UnboundedSearch
+    {
+        T radiusSqr;
+        SINK& sink;
+
+        RadiusCollector(T radius, SINK& inSink) : radiusSqr(radius * radius), sink(inSink) {}
+
+        T getMaxDistSqr() const
+        {
+            return radiusSqr;
+        }
+        void add(uint32_t treeIndex, T distanceSqr)
+        {
+            if (distanceSqr < radiusSqr)
+                sink(treeIndex);
+        }
+    };
+
+    // forwards to another collector, skipping points rejected by a filter
+    template <class COLLECTOR>
+    struct FilteredCollector
+    {
+        const t_kdtree& tree;
+        COLLECTOR& collector;
+        fPointFilter filter;
+        void* pUserData;
+
+        bool visitNode()
+        {
+            return collector.visitNode();
+        }
+        T getMaxDistSqr() const
+        {
+            return collector.getMaxDistSqr();
+        }
+        void add(uint32_t treeIndex, T distanceSqr)
+        {
+            if (distanceSqr < collector.getMaxDistSqr() && filter(tree.getPoint(treeIndex), pUserData))
+                collector.add(treeIndex, distanceSqr);
+        }
+    };
+
+    // range query sinks, RESULT is const VEC* or an input index
+    // caller provided buffer, counts past its capacity
+    template <class RESULT>
+    struct BufferSink
+    {
+        const t_kdtree& tree;
+        RESULT* pOut;
+        uint32_t capacity;
+        uint32_t count = 0;
+
+        BufferSink(const t_kdtree& inTree, RESULT* inOut, uint32_t inCapacity) : tree(inTree), pOut(inOut), capacity(inCapacity) {}
+
+        void operator()(uint32_t treeIndex)
+        {
+            if (count < capacity)
+                tree.getResult(treeIndex, pOut[count]);
+            ++count;
+        }
+    };
+
+    // caller provided callback
+    template <class RESULT>
+    struct CallbackSink
+    {
+        const t_kdtree& tree;
+        void (*callback)(RESULT result, void* pUserData);
+        void* pUserData;
+
+        void operator()(uint32_t treeIndex)
+        {
+            RESULT result;
+            tree.getResult(treeIndex, result);
+            callback(result, pUserData);
+        }
+    };
+
+    // first hits along a ray, bounded max-heap over a caller provided buffer of RayHit or IndexRayHit
+    template <class HIT>
+    struct RayHitCollector
+    {
+        const t_kdtree& tree;
+        HIT* pHeap;
+        uint32_t capacity;
+        uint32_t count = 0;
+
+        RayHitCollector(const t_kdtree& inTree, HIT* inHeap, uint32_t inCapacity) : tree(inTree), pHeap(inHeap), capacity(inCapacity) {}
+
+        static bool compareRayDistance(const HIT& l, const HIT& r)
+        {
+            return l.rayDistance < r.rayDistance;
+        }
+
+        T getMaxRayDistance() const
+        {
+            // until full, anything is a candidate
+            return (count == capacity) ? pHeap[0].rayDistance : std::numeric_limits<T>::max();
+        }
+        void add(uint32_t treeIndex, T rayDistance, T distanceSqr)
+        {
+            if (count < capacity)
+            {
+                tree.getResult(treeIndex, rayDistance, distanceSqr, pHeap[count++]);
+                std::push_heap(pHeap, pHeap + count, compareRayDistance);
+            }
+            else if (rayDistance < pHeap[0].rayDistance)
+            {
+                // evict the last hit
+                std::pop_heap(pHeap, pHeap + count, compareRayDistance);
+                tree.getResult(treeIndex, rayDistance, distanceSqr, pHeap[count - 1]);
+                std::push_heap(pHeap, pHeap + count, compareRayDistance);
+            }
+        }
+        void sort()
+        {
+            std::sort_heap(pHeap, pHeap + count, compareRayDistance);
+        }
+    };
+
+    // every hit along a ray, unordered
+    template <class HIT>
+    struct RayHitVectorCollector
+    {
+        const t_kdtree& tree;
+        std::vector<HIT>& hits;
+
+        T getMaxRayDistance() const
+        {
+            return std::numeric_limits<T>::max();
+        }
+        void add(uint32_t treeIndex, T rayDistance, T distanceSqr)
+        {
+            hits.emplace_back();
+            tree.getResult(treeIndex, rayDistance, distanceSqr, hits.back());
+        }
+    };
+
+    // thick ray in coordinate arrays, unit direction (or zero for a point)
+    struct Ray
+    {
+        T origin[K];
+        T direction[K];
+        T radius;
+        T radiusSqr;
+        T maxDistance;
+    };
+    // normalizes direction, maxDistance defaults to its length
+    static Ray getRay(const T* origin, const T* direction, T radius);
+
+    // pending subtree of a ray search, with the part of the ray inside its cell grown by the radius
+    struct RayStackEntry
+    {
+        uint32_t nodeIndex;
+        T rayMin;
+        T rayMax;
+    };
+
+    // copies the first K coordinates of a point
+    static void getCoordinates(const VEC& point, T* outCoords);
+
+    // squared distance from query to a point in tree order
+    T getDistanceSqr(uint32_t treeIndex, const T* query) const;
+
+    // query order along a z-curve through the query bounds
+    static std::vector<uint32_t> getMortonOrder(const VEC* inQueries, uint32_t numQueries);
+
+    // split axis of the points in pointIndices[rangeBegin, rangeEnd)
+    uint32_t getSplitAxis(const T* const* pInputCoords, uint32_t rangeBegin, uint32_t rangeEnd, int depth, SplitPolicy policy) const;
+
+    // internal recursive build, fills the preallocated subtree rooted at nodeIndex from pointIndices[rangeBegin, rangeEnd)
+    // at most MaxTreeDepth levels deep, duplicate or collinear points included
+    // pInputCoords: coordinate arrays in input order
+    void init(const T* const* pInputCoords, uint32_t rangeBegin, uint32_t rangeEnd, uint32_t nodeIndex, int depth, const BuildSettings& settings);
+    // fills bounds or quantizedBounds from the built tree
+    void initBounds(NodeBounds inNodeBounds);
+
+    T getQuantizedCoordinate(uint16_t step, int axis) const
+    {
+        return quantizationFrame.origin[axis] + T(step) * quantizationFrame.step[axis];
+    }
+    // box of a node, from either bounds storage
+    void getBounds(uint32_t nodeIndex, T* outMin, T* outMax) const;
+    // squared distance from query to the box of a node, 0 inside or without bounds
+    T getBoundsDistanceSqr(uint32_t nodeIndex, const T* query) const;
+    // as above, from the closest point of [boxMin, boxMax]
+    T getBoundsDistanceSqr(uint32_t nodeIndex, const T* boxMin, const T* boxMax) const;
+    // false if the box of a node misses [boxMin, boxMax], true without bounds
+    bool overlapsBounds(uint32_t nodeIndex, const T* boxMin, const T* boxMax) const;
+
+    // feeds every point of a leaf to a search collector
+    template <class COLLECTOR>
+    void scanLeaf(const Node& node, const T* query, COLLECTOR& collector) const;
+
+    // compiled out unless COREMATH_KDTREE_STATS
+    typedef KDTreeStats::t_query_counters<KDTreeStats::Enabled, MaxTreeDepth> tQueryCounters;
+
+    // pending subtree of an iterative search
+    struct SearchStackEntry
+    {
+        uint32_t nodeIndex;
+        // lower bound on the distance from the query to any point in the subtree
+        T distanceSqr;
+    };
+
+    // internal iterative search from the root, near children first
+    // COLLECTOR gathers candidates, reports the current pruning distance & may cut the search short
+    template <class COLLECTOR>
+    void searchNearestNeighbor(const T* query, COLLECTOR& collector) const;
+
+    // internal iterative search from the root
+    // SINK is invoked for every point inside the box
+    template <class SINK>
+    void searchBox(const T* boxMin, const T* boxMax, SINK& sink) const;
+
+    // internal iterative ray search from the root, front to back
+    // COLLECTOR gathers hits & reports the ray distance past which none is wanted
+    template <class COLLECTOR>
+    void searchRay(const Ray& ray, COLLECTOR& collector) const;
+
+    // shared query implementations, for pointer & index results
+    // tree order index of the nearest point, InvalidPoint if the tree is empty
+    uint32_t findNearestTreeIndex(const VEC& inVec) const;
+    template <class RESULT>
+    void searchNearestNeighbors(const VEC* inQueries, uint32_t numQueries, RESULT* outResults, const BatchSettings& settings) const;
+    template <class NEIGHBOR>
+    uint32_t searchKNearestNeighbors(const VEC& inVec, uint32_t k, NEIGHBOR* outNeighbors) const;
+    template <class SINK>
+    void searchRadius(const VEC& inVec, T radius, SINK& sink) const;
+    template <class SINK>
+    void searchBox(const VEC& boxMin, const VEC& boxMax, SINK& sink) const;
+    template <class HIT>
+    uint32_t searchRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, HIT* outHits, uint32_t maxHits) const;
+    template <class HIT>
+    void searchSegment(const VEC& start, const VEC& end, T radius, std::vector<HIT>& outHits) const;
+
+    // k nearest other points of the points stored in a node, written to outGraph
+    // a single traversal, pruned by the distance between the box around the queries & the furthest of their candidates
+    // heaps & collectors: scratch space, reused across calls
+    void searchAllKNearestNeighbors(uint32_t queryNode, uint32_t k, NeighborGraph& outGraph, std::vector<IndexNeighbor>& heaps, std::vector<KNearestCollector<IndexNeighbor>>& collectors) const;
+};
+
+#pragma region Constructors
+template <class VEC, int K>
+inline t_kdtree<VEC, K>::t_kdtree(const std::vector<VEC>& inPoints) : t_kdtree(inPoints, BuildSettings())
+{
+}
+
+template <class VEC, int K>
+inline t_kdtree<VEC, K>::t_kdtree(const std::vector<VEC>& inPoints, const BuildSettings& settings)
+{
+    if (inPoints.empty())
+        return;
+
+    BuildSettings buildSettings = settings;
+    buildSettings.leafSize = std::min(std::max(buildSettings.leafSize, 1u), MaxLeafSize);
+
+    // one shared index buffer handles subdivision for the whole build
+    numPoints = static_cast<uint32_t>(inPoints.size());
+    pointIndices.resize(numPoints);
+    for (uint32_t i = 0; i != numPoints; ++i)
+    {
+        pointIndices[i] = i;
+    }
+
+    // coordinates in input order, so the build can compare on any axis
+    std::vector<T> inputCoords[K];
+    const T* pInputCoords[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        inputCoords[axis].resize(numPoints);
+        pInputCoords[axis] = inputCoords[axis].data();
+    }
+    for (uint32_t i = 0; i != numPoints; ++i)
+    {
+        T coords[K];
+        getCoordinates(inPoints[i], coords);
+        for (int axis = 0; axis != K; ++axis)
+        {
+            inputCoords[axis][i] = coords[axis];
+        }
+    }
+
+    // every subtree's position is known up front
+    nodes.resize(KDTreeUtil::getSubtreeNodeCount(numPoints, buildSettings.leafSize));
+    init(pInputCoords, 0, numPoints, 0, 0, buildSettings);
+
+    // gather the points in their final order
+    for (int axis = 0; axis != K; ++axis)
+    {
+        pointCoords[axis].resize(numPoints);
+        for (uint32_t i = 0; i != numPoints; ++i)
+        {
+            pointCoords[axis][i] = inputCoords[axis][pointIndices[i]];
+        }
+    }
+    if (buildSettings.copyPoints)
+    {
+        points.resize(numPoints);
+        for (uint32_t i = 0; i != numPoints; ++i)
+        {
+            points[i] = inPoints[pointIndices[i]];
+        }
+    }
+
+    pNodes = nodes.data();
+    numNodes = static_cast<uint32_t>(nodes.size());
+    for (int axis = 0; axis != K; ++axis)
+    {
+        pCoords[axis] = pointCoords[axis].data();
+    }
+    pPointIndices = pointIndices.data();
+    pPoints = buildSettings.copyPoints ? points.data() : inPoints.data();
+    pointsInTreeOrder = buildSettings.copyPoints;
+
+    if (buildSettings.nodeBounds != NodeBounds::None)
+        initBounds(buildSettings.nodeBounds);
+}
+#pragma endregion
+
+#pragma region Serialization
+template <class VEC, int K>
+inline bool t_kdtree<VEC, K>::save(const char* path) const
+{
+    static_assert(std::is_trivially_copyable<VEC>::value && std::is_trivially_copyable<T>::value, "saved points are copied bytewise");
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    FileHeader header = getFileLayout(numPoints, numNodes, nodeBounds);
+    header.magic = FileMagic;
+    header.version = FileVersion;
+
+    // sections in file order, zero padded up to their aligned offsets
+    uint64_t fileOffset = 0;
+    auto writeSection = [&](uint64_t sectionOffset, const void* pData, uint64_t dataSize) {
+        static const char padding[FileAlignment] = {};
+        file.write(padding, static_cast<std::streamsize>(sectionOffset - fileOffset));
+        file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(dataSize));
+        fileOffset = sectionOffset + dataSize;
+    };
+    writeSection(0, &header, sizeof(FileHeader));
+    writeSection(header.nodesOffset, pNodes, uint64_t(numNodes) * sizeof(Node));
+    for (int axis = 0; axis != K; ++axis)
+    {
+        writeSection(header.coordsOffset[axis], pCoords[axis], uint64_t(numPoints) * sizeof(T));
+    }
+    writeSection(header.pointIndicesOffset, pPointIndices, uint64_t(numPoints) * sizeof(uint32_t));
+    if (pointsInTreeOrder)
+    {
+        writeSection(header.pointsOffset, pPoints, uint64_t(numPoints) * sizeof(VEC));
+    }
+    else
+    {
+        // gathered into tree order on the way out
+        writeSection(header.pointsOffset, nullptr, 0);
+        for (uint32_t i = 0; i != numPoints; ++i)
+        {
+            file.write(reinterpret_cast<const char*>(getPoint(i)), sizeof(VEC));
+        }
+        fileOffset += uint64_t(numPoints) * sizeof(VEC);
+    }
+    if (nodeBounds == NodeBounds::Full)
+    {
+        writeSection(header.boundsOffset, pBounds, uint64_t(numNodes) * sizeof(Bounds));
+    }
+    else if (nodeBounds == NodeBounds::Quantized)
+    {
+        writeSection(header.boundsOffset, &quantizationFrame, sizeof(QuantizationFrame));
+        writeSection(fileOffset, pQuantizedBounds, uint64_t(numNodes) * sizeof(QuantizedBounds));
+    }
+
+    file.flush();
+    return file.good();
+}
+
+template <class VEC, int K>
+inline std::unique_ptr<t_kdtree<VEC, K>> t_kdtree<VEC, K>::load(const char* path)
+{
+    std::unique_ptr<MappedFile> pMapping(new MappedFile());
+    if (!pMapping->open(path) || pMapping->getSize() < sizeof(FileHeader))
+        return nullptr;
+
+    // a file of this exact type & size has exactly this header
+    FileHeader header;
+    memcpy(&header, pMapping->getData(), sizeof(FileHeader));
+    if (header.nodeBounds > uint32_t(NodeBounds::Quantized))
+        return nullptr;
+    FileHeader expectedHeader = getFileLayout(header.numPoints, header.numNodes, NodeBounds(header.nodeBounds));
+    expectedHeader.magic = FileMagic;
+    expectedHeader.version = FileVersion;
+    if (memcmp(&header, &expectedHeader, sizeof(FileHeader)) != 0 || pMapping->getSize() < header.fileSize)
+        return nullptr;
+
+    // queries read straight from the mapping
+    const uint8_t* pData = pMapping->getData();
+    std::unique_ptr<t_kdtree> pTree(new t_kdtree());
+    pTree->pNodes = reinterpret_cast<const Node*>(pData + header.nodesOffset);
+    pTree->numNodes = header.numNodes;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        pTree->pCoords[axis] = reinterpret_cast<const T*>(pData + header.coordsOffset[axis]);
+    }
+    pTree->pPointIndices = reinterpret_cast<const uint32_t*>(pData + header.pointIndicesOffset);
+    pTree->pPoints = reinterpret_cast<const VEC*>(pData + header.pointsOffset);
+    pTree->pointsInTreeOrder = true;
+    pTree->numPoints = header.numPoints;
+    pTree->nodeBounds = NodeBounds(header.nodeBounds);
+    if (pTree->nodeBounds == NodeBounds::Full)
+    {
+        pTree->pBounds = reinterpret_cast<const Bounds*>(pData + header.boundsOffset);
+    }
+    else if (pTree->nodeBounds == NodeBounds::Quantized)
+    {
+        memcpy(&pTree->quantizationFrame, pData + header.boundsOffset, sizeof(QuantizationFrame));
+        pTree->pQuantizedBounds = reinterpret_cast<const QuantizedBounds*>(pData + header.boundsOffset + sizeof(QuantizationFrame));
+    }
+    pTree->pMapping = std::move(pMapping);
+    return pTree;
+}
+
+template <class VEC, int K>
+inline typename t_kdtree<VEC, K>::FileHeader t_kdtree<VEC, K>::getFileLayout(uint32_t inNumPoints, uint32_t inNumNodes, NodeBounds inNodeBounds)
+{
+    FileHeader header = {};
+    header.numAxes = K;
+    header.coordinateSize = sizeof(T);
+    header.pointSize = sizeof(VEC);
+    header.numPoints = inNumPoints;
+    header.numNodes = inNumNodes;
+    header.nodeBounds = uint32_t(inNodeBounds);
+
+    // every section starts on a cache line
+    uint64_t offset = alignFileOffset(sizeof(FileHeader));
+    header.nodesOffset = offset;
+    offset = alignFileOffset(offset + uint64_t(inNumNodes) * sizeof(Node));
+    for (int axis = 0; axis != K; ++axis)
+    {
+        header.coordsOffset[axis] = offset;
+        offset = alignFileOffset(offset + uint64_t(inNumPoints) * sizeof(T));
+    }
+    header.pointIndicesOffset = offset;
+    offset = alignFileOffset(offset + uint64_t(inNumPoints) * sizeof(uint32_t));
+    header.pointsOffset = offset;
+    offset += uint64_t(inNumPoints) * sizeof(VEC);
+    if (inNodeBounds == NodeBounds::Full)
+    {
+        header.boundsOffset = alignFileOffset(offset);
+        offset = header.boundsOffset + uint64_t(inNumNodes) * sizeof(Bounds);
+    }
+    else if (inNodeBounds == NodeBounds::Quantized)
+    {
+        header.boundsOffset = alignFileOffset(offset);
+        offset = header.boundsOffset + sizeof(QuantizationFrame) + uint64_t(inNumNodes) * sizeof(QuantizedBounds);
+    }
+    header.fileSize = offset;
+    return header;
+}
+#pragma endregion
+
+#pragma region Internal_Functions
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::getCoordinates(const VEC& point, T* outCoords)
+{
+    KDTreeUtil::getCoordinates<K>(point, outCoords);
+}
+
+template <class VEC, int K>
+inline typename t_kdtree<VEC, K>::T t_kdtree<VEC, K>::getDistanceSqr(uint32_t treeIndex, const T* query) const
+{
+    // same operation order as t_vec3::getLengthSquared
+    T distanceSqr = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T delta = pCoords[axis][treeIndex] - query[axis];
+        distanceSqr += delta * delta;
+    }
+    return distanceSqr;
+}
+
+template <class VEC, int K>
+inline std::vector<uint32_t> t_kdtree<VEC, K>::getMortonOrder(const VEC* inQueries, uint32_t numQueries)
+{
+    // as many bits per axis as fit a 64 bit code, at most 16
+    constexpr int bitsPerAxis = std::max(1, std::min(16, 64 / K));
+
+    T boundsMin[K];
+    T boundsMax[K];
+    std::fill(boundsMin, boundsMin + K, std::numeric_limits<T>::max());
+    std::fill(boundsMax, boundsMax + K, std::numeric_limits<T>::lowest());
+    for (uint32_t i = 0; i != numQueries; ++i)
+    {
+        T coords[K];
+        getCoordinates(inQueries[i], coords);
+        for (int axis = 0; axis != K; ++axis)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], coords[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], coords[axis]);
+        }
+    }
+    double boundsScale[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const double extent = double(boundsMax[axis]) - double(boundsMin[axis]);
+        boundsScale[axis] = (extent > 0.0) ? (1 << bitsPerAxis) / extent : 0.0;
+    }
+
+    // interleaved code in the first member, query index in the second
+    std::vector<std::pair<uint64_t, uint32_t>> keys(numQueries);
+    for (uint32_t i = 0; i != numQueries; ++i)
+    {
+        T coords[K];
+        getCoordinates(inQueries[i], coords);
+
+        uint64_t code = 0;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            const double scaled = (double(coords[axis]) - double(boundsMin[axis])) * boundsScale[axis];
+            const uint32_t quantized = static_cast<uint32_t>(std::min(std::max(scaled, 0.0), double((1 << bitsPerAxis) - 1)));
+            for (int bit = 0; bit != bitsPerAxis && bit * K + axis < 64; ++bit)
+            {
+                code |= uint64_t((quantized >> bit) & 1) << (bit * K + axis);
+            }
+        }
+        keys[i] = {code, i};
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint32_t> order(numQueries);
+    for (uint32_t i = 0; i != numQueries; ++i)
+    {
+        order[i] = keys[i].second;
+    }
+    return order;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::getSplitAxis(const T* const* pInputCoords, uint32_t rangeBegin, uint32_t rangeEnd, int depth, SplitPolicy policy) const
+{
+    if (policy == SplitPolicy::Cycle)
+        return depth % K;
+
+    // spread of the range along each axis, extent or variance
+    double spread[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T* pAxisCoords = pInputCoords[axis];
+        if (policy == SplitPolicy::WidestExtent)
+        {
+            T axisMin = pAxisCoords[pointIndices[rangeBegin]];
+            T axisMax = axisMin;
+            for (uint32_t i = rangeBegin + 1; i != rangeEnd; ++i)
+            {
+                const T coord = pAxisCoords[pointIndices[i]];
+                axisMin = std::min(axisMin, coord);
+                axisMax = std::max(axisMax, coord);
+            }
+            spread[axis] = double(axisMax) - double(axisMin);
+        }
+        else
+        {
+            // two passes, stays accurate far from the origin
+            double mean = 0.0;
+            for (uint32_t i = rangeBegin; i != rangeEnd; ++i)
+            {
+                mean += pAxisCoords[pointIndices[i]];
+            }
+            mean /= (rangeEnd - rangeBegin);
+            double sumSqr = 0.0;
+            for (uint32_t i = rangeBegin; i != rangeEnd; ++i)
+            {
+                const double delta = pAxisCoords[pointIndices[i]] - mean;
+                sumSqr += delta * delta;
+            }
+            spread[axis] = sumSqr;
+        }
+    }
+    return static_cast<uint32_t>(std::max_element(spread, spread + K) - spread);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::init(const T* const* pInputCoords, uint32_t rangeBegin, uint32_t rangeEnd, uint32_t nodeIndex, int depth, const BuildSettings& settings)
+{
+    Node& node = nodes[nodeIndex];
+
+    if (rangeEnd - rangeBegin <= settings.leafSize)
+    {
+        node.splitPoint = InvalidPoint;
+        node.firstPoint = rangeBegin;
+        node.numPoints = rangeEnd - rangeBegin;
+        return;
+    }
+
+    // linear time median selection, partitions the range around it
+    const uint32_t splitAxis = getSplitAxis(pInputCoords, rangeBegin, rangeEnd, depth, settings.splitPolicy);
+    const T* pAxisCoords = pInputCoords[splitAxis];
+    tPointIndexIter begin = pointIndices.begin() + rangeBegin;
+    tPointIndexIter end = pointIndices.begin() + rangeEnd;
+    const uint32_t medianIndex = rangeBegin + (rangeEnd - rangeBegin) / 2;
+    std::nth_element(begin, pointIndices.begin() + medianIndex, end, [pAxisCoords](uint32_t l, uint32_t r) { return pAxisCoords[l] < pAxisCoords[r]; });
+    node.splitPoint = medianIndex;
+    node.splitAxis = splitAxis;
+
+    // depth-first layout: left subtree follows its parent, right subtree follows the left
+    // more points than a leaf holds always leaves some left of the median
+    const uint32_t leftChild = nodeIndex + 1;
+    const uint32_t leftSize = medianIndex - rangeBegin;
+    node.rightChild = (medianIndex + 1 != rangeEnd) ? leftChild + KDTreeUtil::getSubtreeNodeCount(leftSize, settings.leafSize) : InvalidNode;
+
+    // subtrees write disjoint index & node ranges, so they can be built concurrently
+    const bool buildParallel = (depth < settings.parallelDepth) && (rangeEnd - rangeBegin >= MinParallelBuildPoints);
+    if (buildParallel)
+    {
+        std::future<void> leftBuild = std::async(std::launch::async, [this, pInputCoords, rangeBegin, medianIndex, leftChild, depth, &settings]() { init(pInputCoords, rangeBegin, medianIndex, leftChild, depth + 1, settings); });
+        if (node.rightChild != InvalidNode)
+            init(pInputCoords, medianIndex + 1, rangeEnd, node.rightChild, depth + 1, settings);
+        leftBuild.get();
+        return;
+    }
+
+    // recurse on the remaining points, in place
+    init(pInputCoords, rangeBegin, medianIndex, leftChild, depth + 1, settings);
+    if (node.rightChild != InvalidNode)
+        init(pInputCoords, medianIndex + 1, rangeEnd, node.rightChild, depth + 1, settings);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::initBounds(NodeBounds inNodeBounds)
+{
+    // children follow their parents, so a reverse pass sees every subtree before its root
+    bounds.resize(numNodes);
+    for (uint32_t nodeIndex = numNodes; nodeIndex-- != 0;)
+    {
+        const Node& node = nodes[nodeIndex];
+        Bounds& nodeBox = bounds[nodeIndex];
+        const uint32_t firstPoint = node.isLeaf() ? node.firstPoint : node.splitPoint;
+        const uint32_t endPoint = node.isLeaf() ? node.firstPoint + node.numPoints : node.splitPoint + 1;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            nodeBox.min[axis] = pointCoords[axis][firstPoint];
+            nodeBox.max[axis] = nodeBox.min[axis];
+            for (uint32_t i = firstPoint + 1; i < endPoint; ++i)
+            {
+                nodeBox.min[axis] = std::min(nodeBox.min[axis], pointCoords[axis][i]);
+                nodeBox.max[axis] = std::max(nodeBox.max[axis], pointCoords[axis][i]);
+            }
+        }
+        if (node.isLeaf())
+            continue;
+
+        for (uint32_t childIndex : {nodeIndex + 1, node.rightChild})
+        {
+            if (childIndex == InvalidNode)
+                continue;
+            for (int axis = 0; axis != K; ++axis)
+            {
+                nodeBox.min[axis] = std::min(nodeBox.min[axis], bounds[childIndex].min[axis]);
+                nodeBox.max[axis] = std::max(nodeBox.max[axis], bounds[childIndex].max[axis]);
+            }
+        }
+    }
+
+    nodeBounds = NodeBounds::Full;
+    pBounds = bounds.data();
+    if (inNodeBounds != NodeBounds::Quantized || !std::is_floating_point<T>::value)
+        return;
+
+    // frame spanning the root box, widened until its last step reaches the root max
+    const Bounds& rootBox = bounds[0];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        T& step = quantizationFrame.step[axis];
+        quantizationFrame.origin[axis] = rootBox.min[axis];
+        step = (rootBox.max[axis] - rootBox.min[axis]) / T(MaxQuantizedStep);
+        while (getQuantizedCoordinate(MaxQuantizedStep, axis) < rootBox.max[axis])
+        {
+            step = std::nextafter(step, std::numeric_limits<T>::max());
+        }
+    }
+
+    // round outwards, checked against the exact dequantization queries use
+    quantizedBounds.resize(numNodes);
+    for (uint32_t nodeIndex = 0; nodeIndex != numNodes; ++nodeIndex)
+    {
+        for (int axis = 0; axis != K; ++axis)
+        {
+            const T step = quantizationFrame.step[axis];
+            auto getStep = [&](T coord, bool roundUp) {
+                if (step <= T(0))
+                    return 0.0;
+                const double steps = (double(coord) - double(quantizationFrame.origin[axis])) / double(step);
+                return std::min(std::max(roundUp ? std::ceil(steps) : std::floor(steps), 0.0), double(MaxQuantizedStep));
+            };
+            uint16_t minStep = static_cast<uint16_t>(getStep(bounds[nodeIndex].min[axis], false));
+            uint16_t maxStep = static_cast<uint16_t>(getStep(bounds[nodeIndex].max[axis], true));
+            while (minStep != 0 && getQuantizedCoordinate(minStep, axis) > bounds[nodeIndex].min[axis])
+            {
+                --minStep;
+            }
+            while (maxStep != MaxQuantizedStep && getQuantizedCoordinate(maxStep, axis) < bounds[nodeIndex].max[axis])
+            {
+                ++maxStep;
+            }
+            quantizedBounds[nodeIndex].min[axis] = minStep;
+            quantizedBounds[nodeIndex].max[axis] = maxStep;
+        }
+    }
+
+    nodeBounds = NodeBounds::Quantized;
+    pBounds = nullptr;
+    pQuantizedBounds = quantizedBounds.data();
+    std::vector<Bounds>().swap(bounds);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::getBounds(uint32_t nodeIndex, T* outMin, T* outMax) const
+{
+    if (nodeBounds == NodeBounds::Full)
+    {
+        for (int axis = 0; axis != K; ++axis)
+        {
+            outMin[axis] = pBounds[nodeIndex].min[axis];
+            outMax[axis] = pBounds[nodeIndex].max[axis];
+        }
+        return;
+    }
+    for (int axis = 0; axis != K; ++axis)
+    {
+        outMin[axis] = getQuantizedCoordinate(pQuantizedBounds[nodeIndex].min[axis], axis);
+        outMax[axis] = getQuantizedCoordinate(pQuantizedBounds[nodeIndex].max[axis], axis);
+    }
+}
+
+template <class VEC, int K>
+inline typename t_kdtree<VEC, K>::T t_kdtree<VEC, K>::getBoundsDistanceSqr(uint32_t nodeIndex, const T* query) const
+{
+    if (nodeBounds == NodeBounds::None)
+        return 0;
+
+    T boxMin[K];
+    T boxMax[K];
+    getBounds(nodeIndex, boxMin, boxMax);
+
+    // per axis & summed in getDistanceSqr order, so never more than the distance to a point inside
+    T distanceSqr = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T delta = std::max(std::max(boxMin[axis] - query[axis], query[axis] - boxMax[axis]), T(0));
+        distanceSqr += delta * delta;
+    }
+    return distanceSqr;
+}
+
+template <class VEC, int K>
+inline typename t_kdtree<VEC, K>::T t_kdtree<VEC, K>::getBoundsDistanceSqr(uint32_t nodeIndex, const T* boxMin, const T* boxMax) const
+{
+    if (nodeBounds == NodeBounds::None)
+        return 0;
+
+    T nodeMin[K];
+    T nodeMax[K];
+    getBounds(nodeIndex, nodeMin, nodeMax);
+
+    T distanceSqr = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T delta = std::max(std::max(nodeMin[axis] - boxMax[axis], boxMin[axis] - nodeMax[axis]), T(0));
+        distanceSqr += delta * delta;
+    }
+    return distanceSqr;
+}
+
+template <class VEC, int K>
+inline bool t_kdtree<VEC, K>::overlapsBounds(uint32_t nodeIndex, const T* boxMin, const T* boxMax) const
+{
+    if (nodeBounds == NodeBounds::None)
+        return true;
+
+    T nodeMin[K];
+    T nodeMax[K];
+    getBounds(nodeIndex, nodeMin, nodeMax);
+
+    bool overlaps = true;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        overlaps &= (nodeMin[axis] <= boxMax[axis]) && (nodeMax[axis] >= boxMin[axis]);
+    }
+    return overlaps;
+}
+
+template <class VEC, int K>
+template <class COLLECTOR>
+inline void t_kdtree<VEC, K>::scanLeaf(const Node& node, const T* query, COLLECTOR& collector) const
+{
+    const T* pLeafCoords[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        pLeafCoords[axis] = pCoords[axis] + node.firstPoint;
+    }
+
+    T distancesSqr[MaxLeafSize];
+    KDTreeUtil::computeDistancesSqr<T, K>(pLeafCoords, node.numPoints, query, distancesSqr);
+    for (uint32_t i = 0; i != node.numPoints; ++i)
+    {
+        collector.add(node.firstPoint + i, distancesSqr[i]);
+    }
+}
+
+template <class VEC, int K>
+template <class COLLECTOR>
+inline void t_kdtree<VEC, K>::searchNearestNeighbor(const T* query, COLLECTOR& collector) const
+{
+    // far children, queued with their distance so they can be dropped unvisited once the best distance shrinks past it
+    SearchStackEntry stack[MaxTreeDepth];
+    uint32_t stackSize = 0;
+    tQueryCounters counters;
+
+    uint32_t nodeIndex = 0;
+    T nodeDistanceSqr = 0;
+    for (;;)
+    {
+        // whole subtree out of range?
+        if (nodeBounds != NodeBounds::None)
+            nodeDistanceSqr = std::max(nodeDistanceSqr, getBoundsDistanceSqr(nodeIndex, query));
+        if (nodeDistanceSqr < collector.getMaxDistSqr())
+        {
+            if (!collector.visitNode())
+                return;
+            counters.visitNode();
+
+            const Node& node = pNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                scanLeaf(node, query, collector);
+                counters.scanLeaf(node.numPoints);
+            }
+            else
+            {
+                collector.add(node.splitPoint, getDistanceSqr(node.splitPoint, query));
+                counters.evaluateDistance();
+
+                // queue the far side, its points are at least as far as the separation plane
+                const T split = pCoords[node.splitAxis][node.splitPoint];
+                const bool goLeft = query[node.splitAxis] < split;
+                const uint32_t nearChild = goLeft ? nodeIndex + 1 : node.rightChild;
+                const uint32_t farChild = goLeft ? node.rightChild : nodeIndex + 1;
+                const T distToSeperation = split - query[node.splitAxis];
+                if (farChild != InvalidNode)
+                {
+                    counters.pushNode(stackSize);
+                    stack[stackSize++] = {farChild, std::max(nodeDistanceSqr, distToSeperation * distToSeperation)};
+                }
+
+                // and descend the near side
+                if (nearChild != InvalidNode)
+                {
+                    counters.descend();
+                    nodeIndex = nearChild;
+                    continue;
+                }
+            }
+        }
+
+        // backtrack, candidate hypersphere (awesome name) still crossing the queued separation planes?
+        if (stackSize == 0)
+            return;
+        --stackSize;
+        counters.popNode(stackSize);
+        nodeIndex = stack[stackSize].nodeIndex;
+        nodeDistanceSqr = stack[stackSize].distanceSqr;
+    }
+}
+
+template <class VEC, int K>
+template <class SINK>
+inline void t_kdtree<VEC, K>::searchBox(const T* boxMin, const T* boxMax, SINK& sink) const
+{
+    auto isInside = [&](uint32_t treeIndex) {
+        bool isInBox = true;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            isInBox &= (pCoords[axis][treeIndex] >= boxMin[axis]) && (pCoords[axis][treeIndex] <= boxMax[axis]);
+        }
+        return isInBox;
+    };
+
+    // right children waiting on their left siblings
+    uint32_t stack[MaxTreeDepth];
+    uint32_t stackSize = 0;
+    tQueryCounters counters;
+
+    uint32_t nodeIndex = 0;
+    for (;;)
+    {
+        if (overlapsBounds(nodeIndex, boxMin, boxMax))
+        {
+            counters.visitNode();
+            const Node& node = pNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPoint, n = node.firstPoint + node.numPoints; i != n; ++i)
+                {
+                    if (isInside(i))
+                        sink(i);
+                }
+                counters.scanLeaf(node.numPoints);
+            }
+            else
+            {
+                if (isInside(node.splitPoint))
+                    sink(node.splitPoint);
+                counters.evaluateDistance();
+
+                // left holds points at or below the separation plane, right at or above it
+                const T split = pCoords[node.splitAxis][node.splitPoint];
+                if (node.rightChild != InvalidNode && boxMax[node.splitAxis] >= split)
+                {
+                    counters.pushNode(stackSize);
+                    stack[stackSize++] = node.rightChild;
+                }
+                if (split >= boxMin[node.splitAxis])
+                {
+                    counters.descend();
+                    nodeIndex = nodeIndex + 1;
+                    continue;
+                }
+            }
+        }
+
+        if (stackSize == 0)
+            return;
+        --stackSize;
+        counters.popNode(stackSize);
+        nodeIndex = stack[stackSize];
+    }
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findNearestTreeIndex(const VEC& inVec) const
+{
+    // uninitialized?
+    if (numNodes == 0)
+        return InvalidPoint;
+
+    T query[K];
+    getCoordinates(inVec, query);
+
+    NearestCollector collector;
+    searchNearestNeighbor(query, collector);
+    return collector.result;
+}
+
+template <class VEC, int K>
+template <class RESULT>
+inline void t_kdtree<VEC, K>::searchNearestNeighbors(const VEC* inQueries, uint32_t numQueries, RESULT* outResults, const BatchSettings& settings) const
+{
+    auto findResult = [this](const VEC& query, RESULT& outResult) {
+        const uint32_t treeIndex = findNearestTreeIndex(query);
+        if (treeIndex != InvalidPoint)
+            getResult(treeIndex, outResult);
+        else
+            getEmptyResult(outResult);
+    };
+
+    if (settings.sortQueries)
+    {
+        const std::vector<uint32_t> order = getMortonOrder(inQueries, numQueries);
+        Parallel::forRange(numQueries, BatchQueryBlockSize, settings.numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            for (uint32_t i = rangeBegin; i != rangeEnd; ++i)
+            {
+                const uint32_t queryIndex = order[i];
+                findResult(inQueries[queryIndex], outResults[queryIndex]);
+            }
+        });
+        return;
+    }
+
+    Parallel::forRange(numQueries, BatchQueryBlockSize, settings.numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+        for (uint32_t i = rangeBegin; i != rangeEnd; ++i)
+        {
+            findResult(inQueries[i], outResults[i]);
+        }
+    });
+}
+
+template <class VEC, int K>
+template <class NEIGHBOR>
+inline uint32_t t_kdtree<VEC, K>::searchKNearestNeighbors(const VEC& inVec, uint32_t k, NEIGHBOR* outNeighbors) const
+{
+    // uninitialized?
+    if (numNodes == 0 || k == 0)
+        return 0;
+
+    T query[K];
+    getCoordinates(inVec, query);
+
+    KNearestCollector<NEIGHBOR> collector(*this, outNeighbors, k);
+    searchNearestNeighbor(query, collector);
+    collector.sort();
+    return collector.count;
+}
+
+template <class VEC, int K>
+template <class SINK>
+inline void t_kdtree<VEC, K>::searchRadius(const VEC& inVec, T radius, SINK& sink) const
+{
+    if (numNodes == 0)
+        return;
+
+    T query[K];
+    getCoordinates(inVec, query);
+
+    RadiusCollector<SINK> collector(radius, sink);
+    searchNearestNeighbor(query, collector);
+}
+
+template <class VEC, int K>
+template <class SINK>
+inline void t_kdtree<VEC, K>::searchBox(const VEC& boxMin, const VEC& boxMax, SINK& sink) const
+{
+    if (numNodes == 0)
+        return;
+
+    T minCoords[K];
+    T maxCoords[K];
+    getCoordinates(boxMin, minCoords);
+    getCoordinates(boxMax, maxCoords);
+    searchBox(minCoords, maxCoords, sink);
+}
+
+template <class VEC, int K>
+inline typename t_kdtree<VEC, K>::Ray t_kdtree<VEC, K>::getRay(const T* origin, const T* direction, T radius)
+{
+    T lengthSqr = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        lengthSqr += direction[axis] * direction[axis];
+    }
+    const T length = std::sqrt(lengthSqr);
+
+    Ray ray;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        ray.origin[axis] = origin[axis];
+        ray.direction[axis] = (length > T(0)) ? direction[axis] / length : T(0);
+    }
+    ray.radius = radius;
+    ray.radiusSqr = radius * radius;
+    ray.maxDistance = length;
+    return ray;
+}
+
+template <class VEC, int K>
+template <class COLLECTOR>
+inline void t_kdtree<VEC, K>::searchRay(const Ray& ray, COLLECTOR& collector) const
+{
+    // distance along the ray to its closest point to a point, & the squared distance between the two
+    auto addPoint = [&](uint32_t treeIndex) {
+        T offset[K];
+        T projection = 0;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            offset[axis] = pCoords[axis][treeIndex] - ray.origin[axis];
+            projection += offset[axis] * ray.direction[axis];
+        }
+        const T rayDistance = std::min(std::max(projection, T(0)), ray.maxDistance);
+        T distanceSqr = 0;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            const T delta = offset[axis] - rayDistance * ray.direction[axis];
+            distanceSqr += delta * delta;
+        }
+        if (distanceSqr < ray.radiusSqr)
+            collector.add(treeIndex, rayDistance, distanceSqr);
+    };
+
+    // narrows [rayMin, rayMax] to where the ray is below (or above) a plane across axis
+    // a hit's closest ray point is within radius of its cell, so cells grown by the radius bound the ray distance of their hits
+    auto clipBelow = [&](int axis, T limit, T& rayMin, T& rayMax) {
+        const T originCoord = ray.origin[axis];
+        const T directionCoord = ray.direction[axis];
+        if (directionCoord > T(0))
+            rayMax = std::min(rayMax, (limit - originCoord) / directionCoord);
+        else if (directionCoord < T(0))
+            rayMin = std::max(rayMin, (limit - originCoord) / directionCoord);
+        else if (originCoord > limit)
+            rayMax = std::numeric_limits<T>::lowest();
+    };
+    auto clipAbove = [&](int axis, T limit, T& rayMin, T& rayMax) {
+        const T originCoord = ray.origin[axis];
+        const T directionCoord = ray.direction[axis];
+        if (directionCoord > T(0))
+            rayMin = std::max(rayMin, (limit - originCoord) / directionCoord);
+        else if (directionCoord < T(0))
+            rayMax = std::min(rayMax, (limit - originCoord) / directionCoord);
+        else if (originCoord < limit)
+            rayMax = std::numeric_limits<T>::lowest();
+    };
+
+    RayStackEntry stack[MaxTreeDepth];
+    uint32_t stackSize = 0;
+    tQueryCounters counters;
+
+    uint32_t nodeIndex = 0;
+    T rayMin = 0;
+    T rayMax = ray.maxDistance;
+    for (;;)
+    {
+        if (nodeBounds != NodeBounds::None)
+        {
+            T boxMin[K];
+            T boxMax[K];
+            getBounds(nodeIndex, boxMin, boxMax);
+            for (int axis = 0; axis != K; ++axis)
+            {
+                clipAbove(axis, boxMin[axis] - ray.radius, rayMin, rayMax);
+                clipBelow(axis, boxMax[axis] + ray.radius, rayMin, rayMax);
+            }
+        }
+
+        // missed, or behind enough hits already?
+        if (rayMin <= rayMax && rayMin < collector.getMaxRayDistance())
+        {
+            counters.visitNode();
+            const Node& node = pNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.firstPoint, n = node.firstPoint + node.numPoints; i != n; ++i)
+                {
+                    addPoint(i);
+                }
+                counters.scanLeaf(node.numPoints);
+            }
+            else
+            {
+                addPoint(node.splitPoint);
+                counters.evaluateDistance();
+
+                // left holds points at or below the separation plane, right at or above it
+                const int axis = node.splitAxis;
+                const T split = pCoords[axis][node.splitPoint];
+                T leftMin = rayMin;
+                T leftMax = rayMax;
+                T rightMin = rayMin;
+                T rightMax = rayMax;
+                clipBelow(axis, split + ray.radius, leftMin, leftMax);
+                clipAbove(axis, split - ray.radius, rightMin, rightMax);
+
+                // the child the ray enters first goes first
+                const bool rightFirst = (node.rightChild != InvalidNode) && (rightMin < leftMin);
+                const uint32_t nearChild = rightFirst ? node.rightChild : nodeIndex + 1;
+                const uint32_t farChild = rightFirst ? nodeIndex + 1 : node.rightChild;
+                if (farChild != InvalidNode)
+                {
+                    counters.pushNode(stackSize);
+                    stack[stackSize++] = rightFirst ? RayStackEntry{farChild, leftMin, leftMax} : RayStackEntry{farChild, rightMin, rightMax};
+                }
+
+                counters.descend();
+                nodeIndex = nearChild;
+                rayMin = rightFirst ? rightMin : leftMin;
+                rayMax = rightFirst ? rightMax : leftMax;
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            return;
+        --stackSize;
+        counters.popNode(stackSize);
+        nodeIndex = stack[stackSize].nodeIndex;
+        rayMin = stack[stackSize].rayMin;
+        rayMax = stack[stackSize].rayMax;
+    }
+}
+
+template <class VEC, int K>
+template <class HIT>
+inline uint32_t t_kdtree<VEC, K>::searchRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, HIT* outHits, uint32_t maxHits) const
+{
+    // uninitialized?
+    if (numNodes == 0 || maxHits == 0)
+        return 0;
+
+    T originCoords[K];
+    T directionCoords[K];
+    getCoordinates(origin, originCoords);
+    getCoordinates(direction, directionCoords);
+    Ray ray = getRay(originCoords, directionCoords, radius);
+    ray.maxDistance = maxDistance;
+
+    RayHitCollector<HIT> collector(*this, outHits, maxHits);
+    searchRay(ray, collector);
+    collector.sort();
+    return collector.count;
+}
+
+template <class VEC, int K>
+template <class HIT>
+inline void t_kdtree<VEC, K>::searchSegment(const VEC& start, const VEC& end, T radius, std::vector<HIT>& outHits) const
+{
+    outHits.clear();
+    if (numNodes == 0)
+        return;
+
+    // a ray from start, as long as the segment
+    T startCoords[K];
+    T endCoords[K];
+    getCoordinates(start, startCoords);
+    getCoordinates(end, endCoords);
+    T directionCoords[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        directionCoords[axis] = endCoords[axis] - startCoords[axis];
+    }
+    const Ray ray = getRay(startCoords, directionCoords, radius);
+
+    RayHitVectorCollector<HIT> collector{*this, outHits};
+    searchRay(ray, collector);
+    std::sort(outHits.begin(), outHits.end(), RayHitCollector<HIT>::compareRayDistance);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::searchAllKNearestNeighbors(uint32_t queryNode, uint32_t k, NeighborGraph& outGraph, std::vector<IndexNeighbor>& heaps,
+                                                          std::vector<KNearestCollector<IndexNeighbor>>& collectors) const
+{
+    // a leaf queries its points, an inner node its split point
+    const Node& queryNodeData = pNodes[queryNode];
+    const uint32_t firstQuery = queryNodeData.isLeaf() ? queryNodeData.firstPoint : queryNodeData.splitPoint;
+    const uint32_t numQueries = queryNodeData.isLeaf() ? queryNodeData.numPoints : 1;
+
+    heaps.resize(size_t(numQueries) * k);
+    collectors.clear();
+    for (uint32_t i = 0; i != numQueries; ++i)
+    {
+        collectors.emplace_back(*this, heaps.data() + size_t(i) * k, k);
+    }
+
+    // box around the queries
+    T boxMin[K];
+    T boxMax[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        boxMin[axis] = *std::min_element(pCoords[axis] + firstQuery, pCoords[axis] + firstQuery + numQueries);
+        boxMax[axis] = *std::max_element(pCoords[axis] + firstQuery, pCoords[axis] + firstQuery + numQueries);
+    }
+
+    // no query prunes past its own furthest candidate, so neither does the batch
+    auto getMaxDistSqr = [&]() {
+        T maxDistSqr = 0;
+        for (const KNearestCollector<IndexNeighbor>& collector : collectors)
+        {
+            maxDistSqr = std::max(maxDistSqr, collector.getMaxDistSqr());
+        }
+        return maxDistSqr;
+    };
+
+    // offers the tree order points [firstCandidate, firstCandidate + numCandidates) to every query but themselves
+    // queries whose furthest candidate is closer than the box around the points skip them
+    // returns the number of distances computed
+    auto addCandidates = [&](uint32_t firstCandidate, uint32_t numCandidates) {
+        uint32_t numDistances = 0;
+        const T* pCandidateCoords[K];
+        T candidateMin[K];
+        T candidateMax[K];
+        for (int axis = 0; axis != K; ++axis)
+        {
+            pCandidateCoords[axis] = pCoords[axis] + firstCandidate;
+            candidateMin[axis] = *std::min_element(pCandidateCoords[axis], pCandidateCoords[axis] + numCandidates);
+            candidateMax[axis] = *std::max_element(pCandidateCoords[axis], pCandidateCoords[axis] + numCandidates);
+        }
+        for (uint32_t i = 0; i != numQueries; ++i)
+        {
+            T query[K];
+            T boxDistanceSqr = 0;
+            for (int axis = 0; axis != K; ++axis)
+            {
+                query[axis] = pCoords[axis][firstQuery + i];
+                const T delta = std::max(std::max(candidateMin[axis] - query[axis], query[axis] - candidateMax[axis]), T(0));
+                boxDistanceSqr += delta * delta;
+            }
+            if (boxDistanceSqr >= collectors[i].getMaxDistSqr())
+                continue;
+
+            T distancesSqr[MaxLeafSize];
+            KDTreeUtil::computeDistancesSqr<T, K>(pCandidateCoords, numCandidates, query, distancesSqr);
+            numDistances += numCandidates;
+            for (uint32_t c = 0; c != numCandidates; ++c)
+            {
+                if (firstCandidate + c != firstQuery + i)
+                    collectors[i].add(firstCandidate + c, distancesSqr[c]);
+            }
+        }
+        return numDistances;
+    };
+
+    // counts the whole batch as one query
+    tQueryCounters counters;
+
+    // the queries' own leaf first, the neighbors within it bound the search from the start
+    if (queryNodeData.isLeaf())
+        counters.scanLeaf(addCandidates(firstQuery, numQueries));
+
+    // same traversal as searchNearestNeighbor, distances taken from the query box
+    SearchStackEntry stack[MaxTreeDepth];
+    uint32_t stackSize = 0;
+
+    uint32_t nodeIndex = 0;
+    T nodeDistanceSqr = 0;
+    T maxDistSqr = getMaxDistSqr();
+    for (;;)
+    {
+        if (nodeBounds != NodeBounds::None)
+            nodeDistanceSqr = std::max(nodeDistanceSqr, getBoundsDistanceSqr(nodeIndex, boxMin, boxMax));
+        if (nodeDistanceSqr < maxDistSqr)
+        {
+            counters.visitNode();
+            const Node& node = pNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                if (nodeIndex != queryNode)
+                {
+                    counters.scanLeaf(addCandidates(node.firstPoint, node.numPoints));
+                    maxDistSqr = getMaxDistSqr();
+                }
+            }
+            else
+            {
+                counters.evaluateDistances(addCandidates(node.splitPoint, 1));
+                maxDistSqr = getMaxDistSqr();
+
+                // left holds points at or below the separation plane, right at or above it
+                const T split = pCoords[node.splitAxis][node.splitPoint];
+                const T distToLeft = std::max(boxMin[node.splitAxis] - split, T(0));
+                const T distToRight = std::max(split - boxMax[node.splitAxis], T(0));
+                const bool goLeft = distToLeft <= distToRight || node.rightChild == InvalidNode;
+                const uint32_t nearChild = goLeft ? nodeIndex + 1 : node.rightChild;
+                const uint32_t farChild = goLeft ? node.rightChild : nodeIndex + 1;
+                const T distToNear = goLeft ? distToLeft : distToRight;
+                const T distToFar = goLeft ? distToRight : distToLeft;
+                if (farChild != InvalidNode)
+                {
+                    counters.pushNode(stackSize);
+                    stack[stackSize++] = {farChild, std::max(nodeDistanceSqr, distToFar * distToFar)};
+                }
+
+                counters.descend();
+                nodeIndex = nearChild;
+                nodeDistanceSqr = std::max(nodeDistanceSqr, distToNear * distToNear);
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+        --stackSize;
+        counters.popNode(stackSize);
+        nodeIndex = stack[stackSize].nodeIndex;
+        nodeDistanceSqr = stack[stackSize].distanceSqr;
+    }
+
+    // closest first, into each query's row
+    for (uint32_t i = 0; i != numQueries; ++i)
+    {
+        KNearestCollector<IndexNeighbor>& collector = collectors[i];
+        collector.sort();
+        const uint32_t row = outGraph.offsets[pPointIndices[firstQuery + i]];
+        for (uint32_t n = 0; n != collector.count; ++n)
+        {
+            outGraph.neighbors[row + n] = collector.pHeap[n].index;
+            outGraph.distancesSqr[row + n] = collector.pHeap[n].distanceSqr;
+        }
+    }
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::getNumPoints() const
+{
+    return numPoints;
+}
+
+template <class VEC, int K>
+inline const VEC* t_kdtree<VEC, K>::findNearestNeighbor(const VEC& inVec) const
+{
+    const uint32_t treeIndex = findNearestTreeIndex(inVec);
+    return (treeIndex != InvalidPoint) ? getPoint(treeIndex) : nullptr;
+}
+
+template <class VEC, int K>
+inline const VEC* t_kdtree<VEC, K>::findNearestNeighbor(const VEC& inVec, fPointFilter filter, void* pUserData) const
+{
+    // uninitialized?
+    if (numNodes == 0)
+        return nullptr;
+
+    T query[K];
+    getCoordinates(inVec, query);
+
+    NearestCollector collector;
+    FilteredCollector<NearestCollector> filteredCollector{*this, collector, filter, pUserData};
+    searchNearestNeighbor(query, filteredCollector);
+    return (collector.result != InvalidPoint) ? getPoint(collector.result) : nullptr;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findNearestNeighborIndex(const VEC& inVec) const
+{
+    const uint32_t treeIndex = findNearestTreeIndex(inVec);
+    return (treeIndex != InvalidPoint) ? pPointIndices[treeIndex] : InvalidIndex;
+}
+
+template <class VEC, int K>
+inline const VEC* t_kdtree<VEC, K>::findApproximateNearestNeighbor(const VEC& inVec, const ApproximateSettings& settings, uint32_t* outVisitedNodes) const
+{
+    ApproximateNearestCollector collector(settings.epsilon, settings.maxVisitedNodes);
+    if (numNodes != 0)
+    {
+        T query[K];
+        getCoordinates(inVec, query);
+        searchNearestNeighbor(query, collector);
+    }
+
+    if (outVisitedNodes)
+        *outVisitedNodes = collector.numVisitedNodes;
+    return (collector.result != InvalidPoint) ? getPoint(collector.result) : nullptr;
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, const VEC** outResults) const
+{
+    searchNearestNeighbors(inQueries, numQueries, outResults, BatchSettings());
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, const VEC** outResults, const BatchSettings& settings) const
+{
+    searchNearestNeighbors(inQueries, numQueries, outResults, settings);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, uint32_t* outIndices) const
+{
+    searchNearestNeighbors(inQueries, numQueries, outIndices, BatchSettings());
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findNearestNeighbors(const VEC* inQueries, uint32_t numQueries, uint32_t* outIndices, const BatchSettings& settings) const
+{
+    searchNearestNeighbors(inQueries, numQueries, outIndices, settings);
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors) const
+{
+    return searchKNearestNeighbors(inVec, k, outNeighbors);
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, IndexNeighbor* outNeighbors) const
+{
+    return searchKNearestNeighbors(inVec, k, outNeighbors);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<Neighbor>& outNeighbors) const
+{
+    outNeighbors.resize(k);
+    const uint32_t numFound = searchKNearestNeighbors(inVec, k, outNeighbors.data());
+    outNeighbors.resize(numFound);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<IndexNeighbor>& outNeighbors) const
+{
+    outNeighbors.resize(k);
+    const uint32_t numFound = searchKNearestNeighbors(inVec, k, outNeighbors.data());
+    outNeighbors.resize(numFound);
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors, fPointFilter filter, void* pUserData) const
+{
+    // uninitialized?
+    if (numNodes == 0 || k == 0)
+        return 0;
+
+    T query[K];
+    getCoordinates(inVec, query);
+
+    KNearestCollector<Neighbor> collector(*this, outNeighbors, k);
+    FilteredCollector<KNearestCollector<Neighbor>> filteredCollector{*this, collector, filter, pUserData};
+    searchNearestNeighbor(query, filteredCollector);
+    collector.sort();
+    return collector.count;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, const VEC** outPoints, uint32_t maxPoints) const
+{
+    BufferSink<const VEC*> sink(*this, outPoints, maxPoints);
+    searchRadius(inVec, radius, sink);
+    return sink.count;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, uint32_t* outIndices, uint32_t maxPoints) const
+{
+    BufferSink<uint32_t> sink(*this, outIndices, maxPoints);
+    searchRadius(inVec, radius, sink);
+    return sink.count;
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, fPointCallback callback, void* pUserData) const
+{
+    CallbackSink<const VEC*> sink{*this, callback, pUserData};
+    searchRadius(inVec, radius, sink);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, fIndexCallback callback, void* pUserData) const
+{
+    CallbackSink<uint32_t> sink{*this, callback, pUserData};
+    searchRadius(inVec, radius, sink);
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findPointsInBox(const VEC& boxMin, const VEC& boxMax, const VEC** outPoints, uint32_t maxPoints) const
+{
+    BufferSink<const VEC*> sink(*this, outPoints, maxPoints);
+    searchBox(boxMin, boxMax, sink);
+    return sink.count;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findPointsInBox(const VEC& boxMin, const VEC& boxMax, uint32_t* outIndices, uint32_t maxPoints) const
+{
+    BufferSink<uint32_t> sink(*this, outIndices, maxPoints);
+    searchBox(boxMin, boxMax, sink);
+    return sink.count;
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsInBox(const VEC& boxMin, const VEC& boxMax, fPointCallback callback, void* pUserData) const
+{
+    CallbackSink<const VEC*> sink{*this, callback, pUserData};
+    searchBox(boxMin, boxMax, sink);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsInBox(const VEC& boxMin, const VEC& boxMax, fIndexCallback callback, void* pUserData) const
+{
+    CallbackSink<uint32_t> sink{*this, callback, pUserData};
+    searchBox(boxMin, boxMax, sink);
+}
+
+template <class VEC, int K>
+inline bool t_kdtree<VEC, K>::findFirstRayHit(const VEC& origin, const VEC& direction, T radius, T maxDistance, RayHit& outHit) const
+{
+    return searchRayHits(origin, direction, radius, maxDistance, &outHit, 1) != 0;
+}
+
+template <class VEC, int K>
+inline bool t_kdtree<VEC, K>::findFirstRayHit(const VEC& origin, const VEC& direction, T radius, T maxDistance, IndexRayHit& outHit) const
+{
+    return searchRayHits(origin, direction, radius, maxDistance, &outHit, 1) != 0;
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, RayHit* outHits, uint32_t maxHits) const
+{
+    return searchRayHits(origin, direction, radius, maxDistance, outHits, maxHits);
+}
+
+template <class VEC, int K>
+inline uint32_t t_kdtree<VEC, K>::findRayHits(const VEC& origin, const VEC& direction, T radius, T maxDistance, IndexRayHit* outHits, uint32_t maxHits) const
+{
+    return searchRayHits(origin, direction, radius, maxDistance, outHits, maxHits);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsNearSegment(const VEC& start, const VEC& end, T radius, std::vector<RayHit>& outHits) const
+{
+    searchSegment(start, end, radius, outHits);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findPointsNearSegment(const VEC& start, const VEC& end, T radius, std::vector<IndexRayHit>& outHits) const
+{
+    searchSegment(start, end, radius, outHits);
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findAllKNearestNeighbors(uint32_t k, NeighborGraph& outGraph) const
+{
+    findAllKNearestNeighbors(k, outGraph, BatchSettings());
+}
+
+template <class VEC, int K>
+inline void t_kdtree<VEC, K>::findAllKNearestNeighbors(uint32_t k, NeighborGraph& outGraph, const BatchSettings& settings) const
+{
+    // every point but itself is a candidate, so every row has the same length
+    const uint32_t rowSize = std::min(k, std::max(numPoints, 1u) - 1);
+    outGraph.offsets.resize(size_t(numPoints) + 1);
+    for (uint32_t i = 0; i <= numPoints; ++i)
+    {
+        outGraph.offsets[i] = i * rowSize;
+    }
+    outGraph.neighbors.resize(size_t(numPoints) * rowSize);
+    outGraph.distancesSqr.resize(size_t(numPoints) * rowSize);
+    if (rowSize == 0)
+        return;
+
+    // leaves query their points together, inner nodes their split point
+    Parallel::forRange(numNodes, AllKNearestBlockSize, settings.numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+        std::vector<IndexNeighbor> heaps;
+        std::vector<KNearestCollector<IndexNeighbor>> collectors;
+        for (uint32_t nodeIndex = rangeBegin; nodeIndex != rangeEnd; ++nodeIndex)
+        {
+            searchAllKNearestNeighbors(nodeIndex, rowSize, outGraph, heaps, collectors);
+        }
+    });
+}
+#pragma endregion
+
+typedef t_kdtree<vec2_32, 2> kdtree2_32;
+typedef t_kdtree<vec2_64, 2> kdtree2_64;
+typedef t_kdtree<vec3_32, 3> kdtree3_32;
+typedef t_kdtree<vec3_64, 3> kdtree3_64;
 
-    // internal recursive function
-    void searchNearestNeighbor(const vec3& inVec, int depth, const vec3*& pResult, float& flMinDistSqr);
-};
\ No newline at end of file
+// k-d tree of 2d points
+typedef kdtree2_32 kdtree2;
+// k-d tree of 3d points
+typedef kdtree3_32 kdtree3;
+typedef kdtree3 KDTree;
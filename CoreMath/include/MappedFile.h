@@ -0,0 +1,40 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// read-only memory mapping of a whole file
+// pages are loaded on first access & shared with every other process mapping the same file
+// uses mmap on POSIX systems, CreateFileMapping on Windows
+class MappedFile
+{
+  public:
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // returns: false if the file is missing, empty or can't be mapped
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const
+    {
+        return pData != nullptr;
+    }
+    const uint8_t* getData() const
+    {
+        return pData;
+    }
+    size_t getSize() const
+    {
+        return size;
+    }
+
+  protected:
+    const uint8_t* pData = nullptr;
+    size_t size = 0;
+};
@@ -34,6 +34,20 @@ namespace MathHelpers
     {
         return isNearlyEqual(float(x), y, epsilon);
     }
+
+    // x & y within maxULPs units in the last place of magnitude
+    // for sums, pass the sum of the terms' magnitudes: cancellation makes the result itself a poor scale
+    inline bool isWithinULPs(float x, float y, float magnitude, int maxULPs)
+    {
+        magnitude = std::fabs(magnitude);
+        return (std::fabs(x - y) <= maxULPs * (std::nextafter(magnitude, FLT_MAX) - magnitude));
+    }
+
+    inline bool isWithinULPs(double x, double y, double magnitude, int maxULPs)
+    {
+        magnitude = std::fabs(magnitude);
+        return (std::fabs(x - y) <= maxULPs * (std::nextafter(magnitude, DBL_MAX) - magnitude));
+    }
 } // namespace MathHelpers
 
 // templatized versions of std math functions to aid w/ templatized precision types
@@ -6,6 +6,7 @@
 
 #pragma once
 #include "Pose.h"
+#include "SIMD.h"
 #include "Transform.h"
 
 // disabling 'loss of precision' warnings as literals will be typed w/ double precision
@@ -62,6 +63,61 @@ inline t_mat4<T> operator*(const t_mat4<T>& m1, const t_mat4<T>& m2)
     }
     return out;
 }
+
+#if defined(COREMATH_SSE2)
+// one row per register. rows of the product are sums of m2's rows scaled by m1's entries, summed in the template's order
+inline t_mat4<float> operator*(const t_mat4<float>& m1, const t_mat4<float>& m2)
+{
+    const __m128 m2Rows[4] = {_mm_loadu_ps(m2.data[0]), _mm_loadu_ps(m2.data[1]), _mm_loadu_ps(m2.data[2]), _mm_loadu_ps(m2.data[3])};
+    t_mat4<float> out;
+    for (int row = 0; row != 4; ++row)
+    {
+        __m128 outRow = _mm_mul_ps(_mm_set1_ps(m1.data[row][0]), m2Rows[0]);
+        for (int n = 1; n != 4; ++n)
+        {
+            outRow = _mm_add_ps(outRow, _mm_mul_ps(_mm_set1_ps(m1.data[row][n]), m2Rows[n]));
+        }
+        _mm_storeu_ps(out.data[row], outRow);
+    }
+    return out;
+}
+// transposed to columns, so each lane sums one row
+inline t_vec3<float> operator*(const t_mat4<float>& m, const t_vec3<float>& v)
+{
+    __m128 column0 = _mm_loadu_ps(m.data[0]);
+    __m128 column1 = _mm_loadu_ps(m.data[1]);
+    __m128 column2 = _mm_loadu_ps(m.data[2]);
+    __m128 column3 = _mm_loadu_ps(m.data[3]);
+    _MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+    __m128 result = _mm_mul_ps(column0, _mm_set1_ps(v.x));
+    result = _mm_add_ps(result, _mm_mul_ps(column1, _mm_set1_ps(v.y)));
+    result = _mm_add_ps(result, _mm_mul_ps(column2, _mm_set1_ps(v.z)));
+    result = _mm_add_ps(result, column3);
+    float out[4];
+    _mm_storeu_ps(out, result);
+    return t_vec3<float>(out[0], out[1], out[2]);
+}
+#endif
+
+#if defined(COREMATH_AVX)
+// double rows fill a 256 bit register, otherwise as the float version
+inline t_mat4<double> operator*(const t_mat4<double>& m1, const t_mat4<double>& m2)
+{
+    const __m256d m2Rows[4] = {_mm256_loadu_pd(m2.data[0]), _mm256_loadu_pd(m2.data[1]), _mm256_loadu_pd(m2.data[2]), _mm256_loadu_pd(m2.data[3])};
+    t_mat4<double> out;
+    for (int row = 0; row != 4; ++row)
+    {
+        __m256d outRow = _mm256_mul_pd(_mm256_set1_pd(m1.data[row][0]), m2Rows[0]);
+        for (int n = 1; n != 4; ++n)
+        {
+            outRow = _mm256_add_pd(outRow, _mm256_mul_pd(_mm256_set1_pd(m1.data[row][n]), m2Rows[n]));
+        }
+        _mm256_storeu_pd(out.data[row], outRow);
+    }
+    return out;
+}
+#endif
+
 template <class T>
 inline std::ostream& operator<<(std::ostream& os, const t_mat4<T>& m)
 {
@@ -108,28 +164,25 @@ inline t_mat4<T>::t_mat4(const t_quat<T>& q) : t_mat4<T>()
     data[2][2] = (2.0 * q.w * q.w) - 1.0 + (2.0 * q.z * q.z);
 }
 
+// applies transformPoint: translates, rotates, then scales
+// rows of the rotation scaled per axis, the translation is the position rotated & scaled the same way
 template <class T>
 inline t_mat4<T>::t_mat4(const t_transform<T>& inTransform) : t_mat4<T>(inTransform.rotation)
 {
-    data[0][3] = inTransform.position.x;
-    data[1][3] = inTransform.position.y;
-    data[2][3] = inTransform.position.z;
-
-    data[0][0] *= inTransform.scale.x;
-    data[1][1] *= inTransform.scale.y;
-    data[2][2] *= inTransform.scale.z;
+    const T scale[3] = {inTransform.scale.x, inTransform.scale.y, inTransform.scale.z};
+    const t_vec3<T>& position = inTransform.position;
+    for (int row = 0; row != 3; ++row)
+    {
+        data[row][0] *= scale[row];
+        data[row][1] *= scale[row];
+        data[row][2] *= scale[row];
+        data[row][3] = (data[row][0] * position.x) + (data[row][1] * position.y) + (data[row][2] * position.z);
+    }
 }
 
 template <class T>
-inline t_mat4<T>::t_mat4(const t_pose<T>& inPose) : t_mat4<T>(inTransform.rotation)
+inline t_mat4<T>::t_mat4(const t_pose<T>& inPose) : t_mat4<T>(t_transform<T>(inPose.position, inPose.rotation, t_vec3<T>(inPose.scale)))
 {
-    data[0][3] = inPose.position.x;
-    data[1][3] = inPose.position.y;
-    data[2][3] = inPose.position.z;
-
-    data[0][0] *= inPose.scale;
-    data[1][1] *= inPose.scale;
-    data[2][2] *= inPose.scale;
 }
 
 template <class T>
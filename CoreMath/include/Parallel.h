@@ -0,0 +1,59 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// minimal fork-join helpers for bulk work over index ranges
+// no persistent pool: workers are spawned per call, so only use these for batches large enough to amortize that
+namespace Parallel
+{
+    // worker count used when none is specified
+    inline uint32_t getDefaultThreadCount()
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return (hardwareThreads == 0) ? 1 : hardwareThreads;
+    }
+
+    // invokes func(rangeBegin, rangeEnd) over [0, count) in blocks of up to blockSize
+    // blocks are handed out on demand to numThreads threads (0: hardware concurrency), the calling thread included
+    // returns once every block has been processed
+    template <class FUNC>
+    void forRange(uint32_t count, uint32_t blockSize, uint32_t numThreads, const FUNC& func)
+    {
+        if (count == 0)
+            return;
+
+        blockSize = std::max(blockSize, 1u);
+        const uint32_t numBlocks = (count + blockSize - 1) / blockSize;
+        if (numThreads == 0)
+            numThreads = getDefaultThreadCount();
+        numThreads = std::min(numThreads, numBlocks);
+
+        std::atomic<uint32_t> nextBlock(0);
+        auto worker = [&]() {
+            for (uint32_t block = nextBlock++; block < numBlocks; block = nextBlock++)
+            {
+                const uint32_t rangeBegin = block * blockSize;
+                const uint32_t rangeEnd = std::min(rangeBegin + blockSize, count);
+                func(rangeBegin, rangeEnd);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+        for (uint32_t i = 1; i < numThreads; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+} // namespace Parallel
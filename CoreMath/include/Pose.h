@@ -19,7 +19,7 @@ class t_pose
 {
   public:
     t_pose() {}
-    t_pose(const t_vec3<T>& inPosition, const t_quat<T>& inRotation, const t_vec3<T>& inScale) : position(inPosition), rotation(inRotation), scale(inScale) {}
+    t_pose(const t_vec3<T>& inPosition, const t_quat<T>& inRotation, T inScale) : position(inPosition), rotation(inRotation), scale(inScale) {}
 
     t_vec3<T> position;
     t_quat<T> rotation;
@@ -29,16 +29,21 @@ class t_pose
     inline t_vec3<T> transformVector(const t_vec3<T>& vector) const;
 };
 
+// same order as t_transform: translate, rotate, then scale
 template <class T>
 inline t_vec3<T> t_pose<T>::transformPoint(const t_vec3<T>& point) const
 {
-    return t_vec3<T>();
+    t_vec3<T> outPoint = rotation.rotateVector(position + point);
+    outPoint *= scale;
+    return outPoint;
 }
 
 template <class T>
 inline t_vec3<T> t_pose<T>::transformVector(const t_vec3<T>& vector) const
 {
-    return t_vec3<T>();
+    t_vec3<T> outVector = rotation.rotateVector(vector);
+    outVector *= scale;
+    return outVector;
 }
 
 typedef t_pose<float> pose_32;
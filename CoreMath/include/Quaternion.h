@@ -9,7 +9,9 @@
 
 #pragma once
 #include "MathHelpers.h"
+#include "SIMD.h"
 #include "Vector3.h"
+#include <cstddef>
 
 // disabling 'loss of precision' warnings as literals will be typed w/ double precision
 #pragma warning(push)
@@ -54,6 +56,44 @@ class t_quat
     T z;
 };
 
+// SIMD paths load w, x, y, z as one register
+static_assert(sizeof(t_quat<float>) == 4 * sizeof(float), "w, x, y, z must be contiguous");
+static_assert(offsetof(t_quat<float>, x) == offsetof(t_quat<float>, w) + sizeof(float), "w, x, y, z must be in order");
+static_assert(offsetof(t_quat<float>, y) == offsetof(t_quat<float>, x) + sizeof(float), "w, x, y, z must be in order");
+static_assert(offsetof(t_quat<float>, z) == offsetof(t_quat<float>, y) + sizeof(float), "w, x, y, z must be in order");
+
+#pragma region Global_Operators
+// hamilton product: rotating by q1 * q2 rotates by q2, then by q1
+template <class T>
+inline t_quat<T> operator*(const t_quat<T>& q1, const t_quat<T>& q2)
+{
+    const T w = (q1.w * q2.w) - (q1.x * q2.x) - (q1.y * q2.y) - (q1.z * q2.z);
+    const T x = (q1.w * q2.x) + (q1.x * q2.w) + (q1.y * q2.z) - (q1.z * q2.y);
+    const T y = (q1.w * q2.y) - (q1.x * q2.z) + (q1.y * q2.w) + (q1.z * q2.x);
+    const T z = (q1.w * q2.z) + (q1.x * q2.y) - (q1.y * q2.x) + (q1.z * q2.w);
+    return t_quat<T>(w, x, y, z);
+}
+
+#if defined(COREMATH_SSE2)
+// w, x, y, z in one register, q1's components broadcast against signed shuffles of q2
+// same products & sums in the same order as the template, subtractions as additions of negated products
+inline t_quat<float> operator*(const t_quat<float>& q1, const t_quat<float>& q2)
+{
+    const __m128 b = _mm_loadu_ps(&q2.w);
+    const __m128 bXWZY = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(1.f, -1.f, 1.f, -1.f));
+    const __m128 bYZWX = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set_ps(-1.f, 1.f, 1.f, -1.f));
+    const __m128 bZYXW = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)), _mm_set_ps(1.f, 1.f, -1.f, -1.f));
+    __m128 result = _mm_mul_ps(_mm_set1_ps(q1.w), b);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q1.x), bXWZY));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q1.y), bYZWX));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(q1.z), bZYXW));
+    t_quat<float> out;
+    _mm_storeu_ps(&out.w, result);
+    return out;
+}
+#endif
+#pragma endregion
+
 template <class T>
 t_quat<T>::t_quat(T inRoll, T inPitch, T inYaw)
 {
@@ -0,0 +1,74 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include <cstdint>
+
+// opt-in SIMD code paths
+//
+// CoreMath is portable scalar code by default. define COREMATH_SIMD project-wide to let hot loops use
+// intrinsics for whichever instruction sets the compiler targets (e.g. /arch:AVX2, -mavx2).
+// every SIMD path has a scalar fallback producing the same results.
+//
+// covered so far: k-d tree leaf distances, VectorSoA batch kernels, mat4 * mat4 (float, & double with AVX),
+// mat4 * vec3 & quat * quat (float). quat::rotateVector stays scalar: its dot products don't fit lanes & a
+// register version measured no faster than what compilers make of the scalar code.
+//
+// results: SIMD paths perform the scalar code's multiplies & adds in the same order, so they're bit identical under
+// strict floating point (MSVC /fp:precise, -ffp-contract=off). where the compiler fuses the scalar multiply-adds
+// (/fp:fast, FMA targets w/ -ffp-contract=fast) the paths differ by rounding only: within MaxULPDifference units in
+// the last place of the summed terms' magnitudes. unit tests check against that bound.
+//
+// runtime dispatch: batch kernels (VectorSoA) pick the widest instruction set the machine supports once, through cpuid,
+// so one binary serves SSE2 through AVX-512 machines. their wider versions live in translation units compiled for that
+// instruction set alone (VectorSoA_AVX.cpp: /arch:AVX or -mavx, VectorSoA_AVX512.cpp: /arch:AVX512 or -mavx512f),
+// a unit compiled without its flags dispatches to the next narrower level. single value operations (mat4, quat) &
+// k-d tree distances are inlined into their callers, so they keep following the project-wide flags above.
+
+namespace SIMD
+{
+    // tolerance between SIMD & scalar results, see above
+    constexpr int MaxULPDifference = 4;
+
+    // instruction set levels for runtime dispatch, each including the ones before
+    enum class Level : uint32_t
+    {
+        Scalar,
+        SSE2,
+        AVX,
+        AVX512,
+    };
+
+    // widest level the cpu & os support, detected once. Scalar off x86 or without COREMATH_SIMD
+    Level getSupportedLevel();
+    // level batch kernels dispatch on: the supported level, or a lower forced one
+    Level getLevel();
+    // forces batch kernels down to a level, for benchmarks & tests. clamped to the supported level
+    // setting the COREMATH_SIMD_LEVEL environment variable to a level name forces it from startup
+    void forceLevel(Level level);
+    // back to the supported level
+    void resetLevel();
+    const char* getLevelName(Level level);
+} // namespace SIMD
+
+#if defined(COREMATH_SIMD)
+
+#if defined(__AVX512F__)
+#define COREMATH_AVX512 1
+#endif
+
+#if defined(__AVX__)
+#define COREMATH_AVX 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COREMATH_SSE2 1
+#endif
+
+#if defined(COREMATH_AVX)
+#include <immintrin.h>
+#elif defined(COREMATH_SSE2)
+#include <emmintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,356 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "DualQuaternion.h"
+#include "Matrix4.h"
+#include "Parallel.h"
+#include "VectorSoA.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// disabling 'loss of precision' warnings as literals will be typed w/ double precision
+#pragma warning(push)
+#pragma warning(disable : 4244)
+
+// bone influences of each vertex, stored as structure of arrays: one index & one weight array per influence slot
+// vertices with fewer than MaxInfluences bones leave the other slots at weight 0 (& any valid index, 0 by default).
+//
+// see the end of the file for ease-of-use typedefs.
+// in general, use 'skin_influences' as the type around your code.
+//
+template <class T>
+class t_skin_influences
+{
+  public:
+    static constexpr int MaxInfluences = 4;
+
+    t_skin_influences() {}
+    explicit t_skin_influences(uint32_t inSize);
+
+    uint32_t getSize() const;
+    // existing influences are kept, new vertices have none
+    void resize(uint32_t inSize);
+
+    // per vertex arrays of a slot
+    uint32_t* getIndices(int slot);
+    const uint32_t* getIndices(int slot) const;
+    T* getWeights(int slot);
+    const T* getWeights(int slot) const;
+
+    void set(uint32_t vertex, int slot, uint32_t boneIndex, T weight);
+    // scales each vertex's weights to sum to 1, vertices without weights are left alone
+    void normalizeWeights();
+
+  private:
+    // slot after slot, getSize() entries each
+    std::vector<uint32_t> indices;
+    std::vector<T> weights;
+    uint32_t size = 0;
+};
+
+// skinning: each vertex moved by the weighted blend of its bones' transforms
+//
+// the palette holds one transform per bone, bind pose inverse included. linear blend skinning sums the weighted
+// matrices; dual quaternion skinning sums the weighted dual quaternions & renormalizes, which keeps the blend rigid
+// (no collapsing joints) but drops scaling. outputs may alias inputs.
+//
+// float is vectorized under COREMATH_SIMD (see Skinning.cpp): bone rows, or dual quaternion parts, are blended in
+// registers per vertex. vertices index arbitrary bones, so vectorizing across vertices would gather every input value
+// lane by lane. linear blend results match the scalar path as SIMD.h describes, dual quaternion ones within rounding
+// (the vector path rotates through cross products rather than quat::rotateVector).
+// the Parallel versions split vertices over worker threads (0: every hardware thread), worth it from ~10k vertices.
+namespace Skinning
+{
+    // vertices per work item of the Parallel versions
+    constexpr uint32_t ParallelBlockSize = 1 << 12;
+
+    // one vertex's blend, MaxInfluences indices & weights
+    template <class T>
+    t_vec3<T> skinLinear(const t_mat4<T>* palette, const uint32_t* boneIndices, const T* weights, const t_vec3<T>& point);
+    // weights of bones on the other hemisphere from the first bone's are negated, as dual quaternions q & -q are the
+    // same transform. vertices without weights are left in place
+    template <class T>
+    t_vec3<T> skinDualQuat(const t_dual_quat<T>* palette, const uint32_t* boneIndices, const T* weights, const t_vec3<T>& point);
+
+    // count vertices, the index, weight & point arrays as in t_skin_influences & t_vec_soa
+    template <class T>
+    void skinLinear(const t_mat4<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints);
+    template <class T>
+    void skinDualQuat(const t_dual_quat<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints);
+
+    // vectorized under COREMATH_SIMD, see Skinning.cpp
+    template <>
+    void skinLinear<float>(const t_mat4<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints);
+    template <>
+    void skinDualQuat<float>(const t_dual_quat<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints);
+
+    // container versions, out is sized to match points
+    template <class T>
+    void skinLinear(const t_mat4<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints);
+    template <class T>
+    void skinDualQuat(const t_dual_quat<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints);
+    template <class T>
+    void skinLinearParallel(const t_mat4<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads = 0);
+    template <class T>
+    void skinDualQuatParallel(const t_dual_quat<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads = 0);
+} // namespace Skinning
+
+#pragma region Constructors
+template <class T>
+inline t_skin_influences<T>::t_skin_influences(uint32_t inSize)
+{
+    resize(inSize);
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class T>
+inline uint32_t t_skin_influences<T>::getSize() const
+{
+    return size;
+}
+
+template <class T>
+inline void t_skin_influences<T>::resize(uint32_t inSize)
+{
+    // slots move to their new offsets
+    std::vector<uint32_t> newIndices(size_t(MaxInfluences) * inSize, 0);
+    std::vector<T> newWeights(size_t(MaxInfluences) * inSize, T(0));
+    const uint32_t keptSize = std::min(size, inSize);
+    for (int slot = 0; slot != MaxInfluences; ++slot)
+    {
+        std::copy(indices.begin() + size_t(slot) * size, indices.begin() + size_t(slot) * size + keptSize, newIndices.begin() + size_t(slot) * inSize);
+        std::copy(weights.begin() + size_t(slot) * size, weights.begin() + size_t(slot) * size + keptSize, newWeights.begin() + size_t(slot) * inSize);
+    }
+    indices.swap(newIndices);
+    weights.swap(newWeights);
+    size = inSize;
+}
+
+template <class T>
+inline uint32_t* t_skin_influences<T>::getIndices(int slot)
+{
+    return indices.data() + size_t(slot) * size;
+}
+
+template <class T>
+inline const uint32_t* t_skin_influences<T>::getIndices(int slot) const
+{
+    return indices.data() + size_t(slot) * size;
+}
+
+template <class T>
+inline T* t_skin_influences<T>::getWeights(int slot)
+{
+    return weights.data() + size_t(slot) * size;
+}
+
+template <class T>
+inline const T* t_skin_influences<T>::getWeights(int slot) const
+{
+    return weights.data() + size_t(slot) * size;
+}
+
+template <class T>
+inline void t_skin_influences<T>::set(uint32_t vertex, int slot, uint32_t boneIndex, T weight)
+{
+    indices[size_t(slot) * size + vertex] = boneIndex;
+    weights[size_t(slot) * size + vertex] = weight;
+}
+
+template <class T>
+inline void t_skin_influences<T>::normalizeWeights()
+{
+    for (uint32_t vertex = 0; vertex != size; ++vertex)
+    {
+        T sum = 0;
+        for (int slot = 0; slot != MaxInfluences; ++slot)
+        {
+            sum += weights[size_t(slot) * size + vertex];
+        }
+        if (sum == T(0))
+            continue;
+        for (int slot = 0; slot != MaxInfluences; ++slot)
+        {
+            weights[size_t(slot) * size + vertex] /= sum;
+        }
+    }
+}
+#pragma endregion
+
+#pragma region Static_Definitions
+namespace Skinning
+{
+    template <class T>
+    inline t_vec3<T> skinLinear(const t_mat4<T>* palette, const uint32_t* boneIndices, const T* weights, const t_vec3<T>& point)
+    {
+        // blended rows, applied as t_mat4 * t_vec3
+        static_assert(t_skin_influences<T>::MaxInfluences == 4, "one term per influence slot");
+        const t_mat4<T>& first = palette[boneIndices[0]];
+        const t_mat4<T>& second = palette[boneIndices[1]];
+        const t_mat4<T>& third = palette[boneIndices[2]];
+        const t_mat4<T>& fourth = palette[boneIndices[3]];
+        T out[3];
+        for (int row = 0; row != 3; ++row)
+        {
+            T blend[4];
+            for (int column = 0; column != 4; ++column)
+            {
+                blend[column] = weights[0] * first.data[row][column] + weights[1] * second.data[row][column] + weights[2] * third.data[row][column] + weights[3] * fourth.data[row][column];
+            }
+            out[row] = (blend[0] * point.x) + (blend[1] * point.y) + (blend[2] * point.z) + blend[3];
+        }
+        return t_vec3<T>(out[0], out[1], out[2]);
+    }
+
+    template <class T>
+    inline t_vec3<T> skinDualQuat(const t_dual_quat<T>* palette, const uint32_t* boneIndices, const T* weights, const t_vec3<T>& point)
+    {
+        const t_quat<T>& firstReal = palette[boneIndices[0]].real;
+        T blend[8] = {};
+        for (int slot = 0; slot != t_skin_influences<T>::MaxInfluences; ++slot)
+        {
+            const t_dual_quat<T>& bone = palette[boneIndices[slot]];
+            const T hemisphere = (firstReal.w * bone.real.w) + (firstReal.x * bone.real.x) + (firstReal.y * bone.real.y) + (firstReal.z * bone.real.z);
+            const T weight = (hemisphere < T(0)) ? -weights[slot] : weights[slot];
+            const T parts[8] = {bone.real.w, bone.real.x, bone.real.y, bone.real.z, bone.dual.w, bone.dual.x, bone.dual.y, bone.dual.z};
+            for (int part = 0; part != 8; ++part)
+            {
+                blend[part] += weight * parts[part];
+            }
+        }
+        t_dual_quat<T> blended(t_quat<T>(blend[0], blend[1], blend[2], blend[3]), t_quat<T>(blend[4], blend[5], blend[6], blend[7]));
+        if (blended.real.getLengthSquared() == T(0))
+        {
+            return point;
+        }
+        blended.normalize();
+        return blended.transformPoint(point);
+    }
+
+    // one vertex's influences, out of the slot arrays
+    template <class T>
+    inline void getInfluences(const uint32_t* const* boneIndices, const T* const* weights, uint32_t vertex, uint32_t* outBoneIndices, T* outWeights)
+    {
+        for (int slot = 0; slot != t_skin_influences<T>::MaxInfluences; ++slot)
+        {
+            outBoneIndices[slot] = boneIndices[slot][vertex];
+            outWeights[slot] = weights[slot][vertex];
+        }
+    }
+
+    // per vertex loops, the float versions' scalar path
+    template <class T>
+    inline void skinLinearLoop(const t_mat4<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            uint32_t vertexIndices[t_skin_influences<T>::MaxInfluences];
+            T vertexWeights[t_skin_influences<T>::MaxInfluences];
+            getInfluences(boneIndices, weights, i, vertexIndices, vertexWeights);
+            const t_vec3<T> point = skinLinear(palette, vertexIndices, vertexWeights, t_vec3<T>(points[0][i], points[1][i], points[2][i]));
+            outPoints[0][i] = point.x;
+            outPoints[1][i] = point.y;
+            outPoints[2][i] = point.z;
+        }
+    }
+
+    template <class T>
+    inline void skinDualQuatLoop(const t_dual_quat<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            uint32_t vertexIndices[t_skin_influences<T>::MaxInfluences];
+            T vertexWeights[t_skin_influences<T>::MaxInfluences];
+            getInfluences(boneIndices, weights, i, vertexIndices, vertexWeights);
+            const t_vec3<T> point = skinDualQuat(palette, vertexIndices, vertexWeights, t_vec3<T>(points[0][i], points[1][i], points[2][i]));
+            outPoints[0][i] = point.x;
+            outPoints[1][i] = point.y;
+            outPoints[2][i] = point.z;
+        }
+    }
+
+    template <class T>
+    inline void skinLinear(const t_mat4<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints)
+    {
+        skinLinearLoop(palette, boneIndices, weights, points, count, outPoints);
+    }
+
+    template <class T>
+    inline void skinDualQuat(const t_dual_quat<T>* palette, const uint32_t* const* boneIndices, const T* const* weights, const T* const* points, uint32_t count, T* const* outPoints)
+    {
+        skinDualQuatLoop(palette, boneIndices, weights, points, count, outPoints);
+    }
+
+    // runs skin(boneIndices, weights, points, count, outPoints) over [rangeBegin, rangeEnd) of the containers
+    template <class T, class SKIN>
+    inline void skinRange(const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, uint32_t rangeBegin, uint32_t rangeEnd, t_vec_soa<T, 3>& outPoints, const SKIN& skin)
+    {
+        const uint32_t* boneIndices[t_skin_influences<T>::MaxInfluences];
+        const T* weights[t_skin_influences<T>::MaxInfluences];
+        for (int slot = 0; slot != t_skin_influences<T>::MaxInfluences; ++slot)
+        {
+            boneIndices[slot] = influences.getIndices(slot) + rangeBegin;
+            weights[slot] = influences.getWeights(slot) + rangeBegin;
+        }
+        const T* pointComponents[3];
+        T* outComponents[3];
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            pointComponents[axis] = points.getComponent(axis) + rangeBegin;
+            outComponents[axis] = outPoints.getComponent(axis) + rangeBegin;
+        }
+        skin(boneIndices, weights, pointComponents, rangeEnd - rangeBegin, outComponents);
+    }
+
+    template <class T>
+    inline void skinLinear(const t_mat4<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints)
+    {
+        outPoints.resize(points.getSize());
+        skinRange(influences, points, 0, points.getSize(), outPoints, [&](const uint32_t* const* boneIndices, const T* const* weights, const T* const* pointComponents, uint32_t count, T* const* outComponents) {
+            skinLinear<T>(palette, boneIndices, weights, pointComponents, count, outComponents);
+        });
+    }
+
+    template <class T>
+    inline void skinDualQuat(const t_dual_quat<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints)
+    {
+        outPoints.resize(points.getSize());
+        skinRange(influences, points, 0, points.getSize(), outPoints, [&](const uint32_t* const* boneIndices, const T* const* weights, const T* const* pointComponents, uint32_t count, T* const* outComponents) {
+            skinDualQuat<T>(palette, boneIndices, weights, pointComponents, count, outComponents);
+        });
+    }
+
+    template <class T>
+    inline void skinLinearParallel(const t_mat4<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads)
+    {
+        outPoints.resize(points.getSize());
+        Parallel::forRange(points.getSize(), ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            skinRange(influences, points, rangeBegin, rangeEnd, outPoints, [&](const uint32_t* const* boneIndices, const T* const* weights, const T* const* pointComponents, uint32_t count, T* const* outComponents) {
+                skinLinear<T>(palette, boneIndices, weights, pointComponents, count, outComponents);
+            });
+        });
+    }
+
+    template <class T>
+    inline void skinDualQuatParallel(const t_dual_quat<T>* palette, const t_skin_influences<T>& influences, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads)
+    {
+        outPoints.resize(points.getSize());
+        Parallel::forRange(points.getSize(), ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            skinRange(influences, points, rangeBegin, rangeEnd, outPoints, [&](const uint32_t* const* boneIndices, const T* const* weights, const T* const* pointComponents, uint32_t count, T* const* outComponents) {
+                skinDualQuat<T>(palette, boneIndices, weights, pointComponents, count, outComponents);
+            });
+        });
+    }
+} // namespace Skinning
+#pragma endregion
+
+typedef t_skin_influences<float> skin_influences_32;
+typedef t_skin_influences<double> skin_influences_64;
+
+// per vertex bone influences, structure of arrays
+typedef t_skin_influences<float> skin_influences;
+
+#pragma warning(pop)
@@ -0,0 +1,812 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "KDTree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// uniform grid of points, hashed into a table of buckets
+// owns its points, each identified by a stable id, answers the same queries as t_kdtree & DynamicKDTree
+//
+// a point lives in the grid cell floor(p / cellSize), cells are hashed into a power of 2 number of buckets.
+// each bucket is an intrusive linked list of point slots, so insert / remove / move only relink one slot.
+// rebuild() counting sorts the slots by bucket so every bucket's points are contiguous again,
+// it runs on its own whenever the points outgrow the table.
+// best for dynamic, roughly uniform points queried at radii around half the cell size, a tree fits clustered data better.
+// VEC needs at least K axes, see t_kdtree_point. cell coordinates, p / cellSize, have to fit in 32 bits.
+// see the end of the file for ease-of-use typedefs.
+//
+// insert / remove / update: O(1), amortized over rebuilds
+// radius search: O(cells overlapped + points in them)
+// nearest neighbor search: O(cells within the nearest distance), a linear scan once that's more than the number of points
+//
+// Source:
+// Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+// https://matthias-research.github.io/pages/publications/tetraederCollision.pdf
+//
+template <class VEC, int K>
+class t_spatial_hash_grid
+{
+    static_assert(K >= 1 && K <= 3, "spatial hash grids hash up to 3 axes");
+
+  public:
+    typedef t_kdtree_point<VEC> tPoint;
+    typedef typename tPoint::T T;
+
+    typedef uint32_t tPointId;
+    static constexpr tPointId InvalidId = UINT32_MAX;
+
+    struct Neighbor
+    {
+        tPointId id;
+        T distanceSqr;
+    };
+
+    // range query callback, invoked once per point found
+    typedef void (*fPointCallback)(tPointId id, const VEC& point, void* pUserData);
+
+    // cellSize: edge length of the grid cells, best around twice the typical query radius so queries span 2 cells per axis
+    t_spatial_hash_grid(T cellSize);
+    // ids are assigned in input order, 0 to n - 1
+    t_spatial_hash_grid(T cellSize, const std::vector<VEC>& inPoints);
+
+    // returns: id of the new point
+    tPointId insert(const VEC& point);
+    // returns: false if id isn't a live point
+    bool remove(tPointId id);
+    // moves a point, keeping its id
+    // returns: false if id isn't a live point
+    bool updatePosition(tPointId id, const VEC& point);
+
+    // lays out every bucket's points contiguously & sizes the table to the number of points
+    // runs on its own as points are inserted, call it after heavy churn to speed up queries
+    void rebuild();
+
+    bool isValid(tPointId id) const;
+    const VEC& getPosition(tPointId id) const;
+    uint32_t getNumPoints() const;
+    T getCellSize() const;
+
+    // returns: InvalidId if the grid is empty
+    tPointId findNearestNeighbor(const VEC& inVec) const;
+
+    // writes up to k nearest points to outNeighbors (capacity of at least k), closest first
+    // returns: number of neighbors found, min(k, number of points)
+    uint32_t findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors) const;
+    // as above, outNeighbors is resized to the number of neighbors found
+    void findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<Neighbor>& outNeighbors) const;
+
+    // writes ids of points closer than radius to outIds, up to maxPoints
+    // returns: total number of points found, may exceed maxPoints
+    uint32_t findPointsInRadius(const VEC& inVec, T radius, tPointId* outIds, uint32_t maxPoints) const;
+    // invokes callback for every point closer than radius
+    void findPointsInRadius(const VEC& inVec, T radius, fPointCallback callback, void* pUserData) const;
+
+  protected:
+    static constexpr uint32_t InvalidSlot = UINT32_MAX;
+    // smallest bucket table
+    static constexpr uint32_t MinBuckets = 64;
+    // points per bucket that trigger a rebuild into a bigger table
+    static constexpr uint32_t MaxLoadFactor = 2;
+
+    struct Cell
+    {
+        int32_t coords[K];
+
+        bool operator==(const Cell& other) const
+        {
+            for (int axis = 0; axis != K; ++axis)
+            {
+                if (coords[axis] != other.coords[axis])
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    T cellSize;
+    T invCellSize;
+
+    // indexed by slot, a slot holds one point or is free
+    // slots of one bucket form a doubly linked list, stored in order right after a rebuild
+    std::vector<VEC> points;
+    // InvalidId for free slots
+    std::vector<tPointId> ids;
+    // cells of the points, tells apart the cells sharing a bucket
+    std::vector<Cell> cells;
+    std::vector<uint32_t> nextSlots;
+    std::vector<uint32_t> prevSlots;
+    std::vector<uint32_t> freeSlots;
+
+    // first slot of each bucket, InvalidSlot if empty
+    std::vector<uint32_t> bucketHeads;
+    // 32 - log2(number of buckets)
+    uint32_t bucketShift;
+
+    // indexed by id
+    std::vector<uint32_t> idSlots;
+    std::vector<tPointId> freeIds;
+    uint32_t numPoints = 0;
+
+    // bounds of the cells points were in since the last rebuild, searches never leave them
+    Cell occupiedMin;
+    Cell occupiedMax;
+
+    Cell getCell(const T* coords) const;
+    Cell getCell(const VEC& point) const;
+    uint32_t getBucket(const Cell& cell) const;
+    T getDistanceSqr(uint32_t slot, const T* query) const;
+
+    // adds / takes a slot to / from the list of its cell's bucket
+    void link(uint32_t slot);
+    void unlink(uint32_t slot);
+    void addOccupiedCell(const Cell& cell);
+    void resizeBuckets(uint32_t numBuckets);
+
+    // number of cells in [cellMin, cellMax], as a double since it may not fit in an integer
+    static double getNumCells(const int64_t* cellMin, const int64_t* cellMax);
+
+    // invoke visitor(slot) for each point in a cell, a box of cells, a ring of cells or the whole grid
+    template <class VISITOR>
+    void visitCell(const Cell& cell, VISITOR& visitor) const;
+    template <class VISITOR>
+    void visitCells(const int64_t* cellMin, const int64_t* cellMax, VISITOR& visitor) const;
+    // cells at Chebyshev distance ring from center, within [cellMin, cellMax]
+    template <class VISITOR>
+    void visitRing(const Cell& center, int64_t ring, const int64_t* cellMin, const int64_t* cellMax, VISITOR& visitor) const;
+    template <class VISITOR>
+    void visitAllSlots(VISITOR& visitor) const;
+
+    // nearest neighbor collectors
+    // getMaxDistanceSqr(): distance beyond which no point is accepted, add(): offers a point
+    struct NearestCollector
+    {
+        tPointId id = InvalidId;
+        T distanceSqr = std::numeric_limits<T>::max();
+
+        T getMaxDistanceSqr() const
+        {
+            return distanceSqr;
+        }
+        void add(tPointId inId, T inDistanceSqr)
+        {
+            if (inDistanceSqr < distanceSqr)
+            {
+                id = inId;
+                distanceSqr = inDistanceSqr;
+            }
+        }
+    };
+    // k closest points as a max heap on distance
+    struct KNearestCollector
+    {
+        Neighbor* pNeighbors;
+        uint32_t k;
+        uint32_t numNeighbors = 0;
+
+        KNearestCollector(Neighbor* inNeighbors, uint32_t inK) : pNeighbors(inNeighbors), k(inK)
+        {
+        }
+        T getMaxDistanceSqr() const
+        {
+            return numNeighbors == k ? pNeighbors[0].distanceSqr : std::numeric_limits<T>::max();
+        }
+        void add(tPointId id, T distanceSqr);
+    };
+
+    // rings of cells around the query, outwards until no point outside the rings can be closer than what was collected
+    template <class COLLECTOR>
+    void searchNearest(const VEC& inVec, COLLECTOR& collector) const;
+};
+
+#pragma region Constructors
+template <class VEC, int K>
+inline t_spatial_hash_grid<VEC, K>::t_spatial_hash_grid(T cellSize) : cellSize(cellSize), invCellSize(T(1) / cellSize)
+{
+    resizeBuckets(MinBuckets);
+}
+
+template <class VEC, int K>
+inline t_spatial_hash_grid<VEC, K>::t_spatial_hash_grid(T cellSize, const std::vector<VEC>& inPoints) : t_spatial_hash_grid(cellSize)
+{
+    const uint32_t numInputPoints = static_cast<uint32_t>(inPoints.size());
+    points = inPoints;
+    ids.resize(numInputPoints);
+    cells.resize(numInputPoints);
+    nextSlots.resize(numInputPoints);
+    prevSlots.resize(numInputPoints);
+    idSlots.resize(numInputPoints);
+    for (uint32_t i = 0; i != numInputPoints; ++i)
+    {
+        ids[i] = i;
+        cells[i] = getCell(inPoints[i]);
+        idSlots[i] = i;
+    }
+    numPoints = numInputPoints;
+
+    // sorts the slots & links the buckets
+    rebuild();
+}
+#pragma endregion
+
+#pragma region Internal_Functions
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::Cell t_spatial_hash_grid<VEC, K>::getCell(const T* coords) const
+{
+    Cell cell;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        cell.coords[axis] = static_cast<int32_t>(std::floor(coords[axis] * invCellSize));
+    }
+    return cell;
+}
+
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::Cell t_spatial_hash_grid<VEC, K>::getCell(const VEC& point) const
+{
+    T coords[K];
+    KDTreeUtil::getCoordinates<K>(point, coords);
+    return getCell(coords);
+}
+
+template <class VEC, int K>
+inline uint32_t t_spatial_hash_grid<VEC, K>::getBucket(const Cell& cell) const
+{
+    // Teschner et al. hash of all but the first axis, spread over the power of 2 table by Fibonacci hashing
+    // the first axis is added on top, so runs of cells along it land in consecutive buckets, contiguous after a rebuild
+    static constexpr uint32_t primes[] = {73856093u, 19349663u, 83492791u};
+    uint32_t hash = 0;
+    for (int axis = 1; axis != K; ++axis)
+    {
+        hash ^= static_cast<uint32_t>(cell.coords[axis]) * primes[axis];
+    }
+    const uint32_t bucketMask = static_cast<uint32_t>(bucketHeads.size()) - 1;
+    return (((hash * 2654435769u) >> bucketShift) + static_cast<uint32_t>(cell.coords[0])) & bucketMask;
+}
+
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::T t_spatial_hash_grid<VEC, K>::getDistanceSqr(uint32_t slot, const T* query) const
+{
+    T coords[K];
+    KDTreeUtil::getCoordinates<K>(points[slot], coords);
+    T distanceSqr = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T delta = coords[axis] - query[axis];
+        distanceSqr += delta * delta;
+    }
+    return distanceSqr;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::link(uint32_t slot)
+{
+    uint32_t& head = bucketHeads[getBucket(cells[slot])];
+    prevSlots[slot] = InvalidSlot;
+    nextSlots[slot] = head;
+    if (head != InvalidSlot)
+        prevSlots[head] = slot;
+    head = slot;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::unlink(uint32_t slot)
+{
+    const uint32_t prevSlot = prevSlots[slot];
+    const uint32_t nextSlot = nextSlots[slot];
+    if (prevSlot != InvalidSlot)
+        nextSlots[prevSlot] = nextSlot;
+    else
+        bucketHeads[getBucket(cells[slot])] = nextSlot;
+    if (nextSlot != InvalidSlot)
+        prevSlots[nextSlot] = prevSlot;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::addOccupiedCell(const Cell& cell)
+{
+    if (numPoints == 0)
+    {
+        occupiedMin = cell;
+        occupiedMax = cell;
+        return;
+    }
+    for (int axis = 0; axis != K; ++axis)
+    {
+        occupiedMin.coords[axis] = std::min(occupiedMin.coords[axis], cell.coords[axis]);
+        occupiedMax.coords[axis] = std::max(occupiedMax.coords[axis], cell.coords[axis]);
+    }
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::resizeBuckets(uint32_t numBuckets)
+{
+    uint32_t log2Buckets = 0;
+    while ((1u << log2Buckets) < numBuckets)
+    {
+        ++log2Buckets;
+    }
+    bucketHeads.assign(size_t(1) << log2Buckets, uint32_t(InvalidSlot));
+    bucketShift = 32 - log2Buckets;
+}
+
+template <class VEC, int K>
+inline double t_spatial_hash_grid<VEC, K>::getNumCells(const int64_t* cellMin, const int64_t* cellMax)
+{
+    double numCells = 1.0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        numCells *= static_cast<double>(cellMax[axis] - cellMin[axis] + 1);
+    }
+    return numCells;
+}
+
+template <class VEC, int K>
+template <class VISITOR>
+inline void t_spatial_hash_grid<VEC, K>::visitCell(const Cell& cell, VISITOR& visitor) const
+{
+    for (uint32_t slot = bucketHeads[getBucket(cell)]; slot != InvalidSlot; slot = nextSlots[slot])
+    {
+        if (cells[slot] == cell)
+            visitor(slot);
+    }
+}
+
+template <class VEC, int K>
+template <class VISITOR>
+inline void t_spatial_hash_grid<VEC, K>::visitCells(const int64_t* cellMin, const int64_t* cellMax, VISITOR& visitor) const
+{
+    Cell cell;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        cell.coords[axis] = static_cast<int32_t>(cellMin[axis]);
+    }
+    for (;;)
+    {
+        visitCell(cell, visitor);
+
+        // step to the next cell, first axis fastest
+        int axis = 0;
+        for (; axis != K; ++axis)
+        {
+            if (cell.coords[axis] != cellMax[axis])
+            {
+                ++cell.coords[axis];
+                break;
+            }
+            cell.coords[axis] = static_cast<int32_t>(cellMin[axis]);
+        }
+        if (axis == K)
+            return;
+    }
+}
+
+template <class VEC, int K>
+template <class VISITOR>
+inline void t_spatial_hash_grid<VEC, K>::visitRing(const Cell& center, int64_t ring, const int64_t* cellMin, const int64_t* cellMax, VISITOR& visitor) const
+{
+    // steps through all but the last axis, the last axis only has its two ends on the ring unless another axis is on it already
+    constexpr int lastAxis = K - 1;
+    Cell cell;
+    for (int axis = 0; axis != lastAxis; ++axis)
+    {
+        cell.coords[axis] = static_cast<int32_t>(cellMin[axis]);
+    }
+    for (;;)
+    {
+        bool isOnRing = (ring == 0);
+        for (int axis = 0; axis != lastAxis; ++axis)
+        {
+            const int64_t offset = cell.coords[axis] - int64_t(center.coords[axis]);
+            isOnRing |= (offset == ring || offset == -ring);
+        }
+        if (isOnRing)
+        {
+            for (int64_t coord = cellMin[lastAxis]; coord <= cellMax[lastAxis]; ++coord)
+            {
+                cell.coords[lastAxis] = static_cast<int32_t>(coord);
+                visitCell(cell, visitor);
+            }
+        }
+        else
+        {
+            const int64_t lowCoord = center.coords[lastAxis] - ring;
+            const int64_t highCoord = center.coords[lastAxis] + ring;
+            if (lowCoord >= cellMin[lastAxis])
+            {
+                cell.coords[lastAxis] = static_cast<int32_t>(lowCoord);
+                visitCell(cell, visitor);
+            }
+            if (highCoord <= cellMax[lastAxis])
+            {
+                cell.coords[lastAxis] = static_cast<int32_t>(highCoord);
+                visitCell(cell, visitor);
+            }
+        }
+
+        int axis = 0;
+        for (; axis != lastAxis; ++axis)
+        {
+            if (cell.coords[axis] != cellMax[axis])
+            {
+                ++cell.coords[axis];
+                break;
+            }
+            cell.coords[axis] = static_cast<int32_t>(cellMin[axis]);
+        }
+        if (axis == lastAxis)
+            return;
+    }
+}
+
+template <class VEC, int K>
+template <class VISITOR>
+inline void t_spatial_hash_grid<VEC, K>::visitAllSlots(VISITOR& visitor) const
+{
+    const uint32_t numSlots = static_cast<uint32_t>(ids.size());
+    for (uint32_t slot = 0; slot != numSlots; ++slot)
+    {
+        if (ids[slot] != InvalidId)
+            visitor(slot);
+    }
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::KNearestCollector::add(tPointId id, T distanceSqr)
+{
+    auto isCloser = [](const Neighbor& a, const Neighbor& b) { return a.distanceSqr < b.distanceSqr; };
+    if (numNeighbors != k)
+    {
+        pNeighbors[numNeighbors++] = {id, distanceSqr};
+        std::push_heap(pNeighbors, pNeighbors + numNeighbors, isCloser);
+    }
+    else if (distanceSqr < pNeighbors[0].distanceSqr)
+    {
+        std::pop_heap(pNeighbors, pNeighbors + k, isCloser);
+        pNeighbors[k - 1] = {id, distanceSqr};
+        std::push_heap(pNeighbors, pNeighbors + k, isCloser);
+    }
+}
+
+template <class VEC, int K>
+template <class COLLECTOR>
+inline void t_spatial_hash_grid<VEC, K>::searchNearest(const VEC& inVec, COLLECTOR& collector) const
+{
+    if (numPoints == 0)
+        return;
+
+    T query[K];
+    KDTreeUtil::getCoordinates<K>(inVec, query);
+    const Cell center = getCell(query);
+    auto measure = [&](uint32_t slot) { collector.add(ids[slot], getDistanceSqr(slot, query)); };
+
+    // rings closer than the occupied cells are empty
+    int64_t ring = 0;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        ring = std::max(ring, int64_t(occupiedMin.coords[axis]) - center.coords[axis]);
+        ring = std::max(ring, int64_t(center.coords[axis]) - occupiedMax.coords[axis]);
+    }
+
+    const double numSlots = static_cast<double>(ids.size());
+    for (;; ++ring)
+    {
+        int64_t cellMin[K];
+        int64_t cellMax[K];
+        bool isCoveringOccupied = true;
+        for (int axis = 0; axis != K; ++axis)
+        {
+            cellMin[axis] = std::max(int64_t(center.coords[axis]) - ring, int64_t(occupiedMin.coords[axis]));
+            cellMax[axis] = std::min(int64_t(center.coords[axis]) + ring, int64_t(occupiedMax.coords[axis]));
+            isCoveringOccupied &= (cellMin[axis] == occupiedMin.coords[axis] && cellMax[axis] == occupiedMax.coords[axis]);
+        }
+
+        // sparse grid, scanning the points not yet measured is cheaper than visiting the cells of the rings so far
+        if (getNumCells(cellMin, cellMax) > numSlots)
+        {
+            auto measureOutsideRings = [&](uint32_t slot) {
+                int64_t cellDistance = 0;
+                for (int axis = 0; axis != K; ++axis)
+                {
+                    cellDistance = std::max(cellDistance, std::abs(int64_t(cells[slot].coords[axis]) - center.coords[axis]));
+                }
+                if (cellDistance >= ring)
+                    measure(slot);
+            };
+            visitAllSlots(measureOutsideRings);
+            return;
+        }
+
+        visitRing(center, ring, cellMin, cellMax, measure);
+        if (isCoveringOccupied)
+            return;
+
+        // distance from the query to the cells outside the rings, in cells
+        T outsideDistance = std::numeric_limits<T>::max();
+        for (int axis = 0; axis != K; ++axis)
+        {
+            const T queryCell = query[axis] * invCellSize;
+            outsideDistance = std::min(outsideDistance, queryCell - static_cast<T>(center.coords[axis] - ring));
+            outsideDistance = std::min(outsideDistance, static_cast<T>(center.coords[axis] + ring + 1) - queryCell);
+        }
+        outsideDistance *= cellSize;
+        if (collector.getMaxDistanceSqr() <= outsideDistance * outsideDistance)
+            return;
+    }
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::tPointId t_spatial_hash_grid<VEC, K>::insert(const VEC& point)
+{
+    tPointId id;
+    if (!freeIds.empty())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        id = static_cast<tPointId>(idSlots.size());
+        idSlots.push_back(uint32_t(InvalidSlot));
+    }
+
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(ids.size());
+        points.emplace_back();
+        ids.push_back(tPointId(InvalidId));
+        cells.emplace_back();
+        nextSlots.push_back(uint32_t(InvalidSlot));
+        prevSlots.push_back(uint32_t(InvalidSlot));
+    }
+
+    points[slot] = point;
+    ids[slot] = id;
+    cells[slot] = getCell(point);
+    link(slot);
+    addOccupiedCell(cells[slot]);
+    idSlots[id] = slot;
+    ++numPoints;
+
+    if (numPoints > MaxLoadFactor * static_cast<uint32_t>(bucketHeads.size()))
+        rebuild();
+    return id;
+}
+
+template <class VEC, int K>
+inline bool t_spatial_hash_grid<VEC, K>::remove(tPointId id)
+{
+    if (!isValid(id))
+        return false;
+
+    const uint32_t slot = idSlots[id];
+    unlink(slot);
+    ids[slot] = InvalidId;
+    freeSlots.push_back(slot);
+    idSlots[id] = InvalidSlot;
+    freeIds.push_back(id);
+    --numPoints;
+    return true;
+}
+
+template <class VEC, int K>
+inline bool t_spatial_hash_grid<VEC, K>::updatePosition(tPointId id, const VEC& point)
+{
+    if (!isValid(id))
+        return false;
+
+    const uint32_t slot = idSlots[id];
+    points[slot] = point;
+    const Cell cell = getCell(point);
+    if (!(cell == cells[slot]))
+    {
+        unlink(slot);
+        cells[slot] = cell;
+        link(slot);
+        addOccupiedCell(cell);
+    }
+    return true;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::rebuild()
+{
+    resizeBuckets(std::max(numPoints, uint32_t(MinBuckets)));
+    const uint32_t numBuckets = static_cast<uint32_t>(bucketHeads.size());
+
+    // counting sort of the live slots by bucket, keeping their order within a bucket
+    std::vector<uint32_t> bucketEnds(numBuckets, 0);
+    const uint32_t numSlots = static_cast<uint32_t>(ids.size());
+    for (uint32_t slot = 0; slot != numSlots; ++slot)
+    {
+        if (ids[slot] != InvalidId)
+            ++bucketEnds[getBucket(cells[slot])];
+    }
+    uint32_t bucketStart = 0;
+    for (uint32_t& bucketEnd : bucketEnds)
+    {
+        const uint32_t bucketSize = bucketEnd;
+        bucketEnd = bucketStart;
+        bucketStart += bucketSize;
+    }
+
+    std::vector<VEC> sortedPoints(numPoints);
+    std::vector<tPointId> sortedIds(numPoints);
+    std::vector<Cell> sortedCells(numPoints);
+    for (uint32_t slot = 0; slot != numSlots; ++slot)
+    {
+        const tPointId id = ids[slot];
+        if (id == InvalidId)
+            continue;
+        const uint32_t sortedSlot = bucketEnds[getBucket(cells[slot])]++;
+        sortedPoints[sortedSlot] = points[slot];
+        sortedIds[sortedSlot] = id;
+        sortedCells[sortedSlot] = cells[slot];
+        idSlots[id] = sortedSlot;
+    }
+    points.swap(sortedPoints);
+    ids.swap(sortedIds);
+    cells.swap(sortedCells);
+    freeSlots.clear();
+
+    // every bucket's list runs through consecutive slots
+    nextSlots.resize(numPoints);
+    prevSlots.resize(numPoints);
+    for (uint32_t bucket = 0; bucket != numBuckets; ++bucket)
+    {
+        const uint32_t firstSlot = (bucket == 0) ? 0 : bucketEnds[bucket - 1];
+        const uint32_t endSlot = bucketEnds[bucket];
+        if (firstSlot == endSlot)
+            continue;
+        bucketHeads[bucket] = firstSlot;
+        for (uint32_t slot = firstSlot; slot != endSlot; ++slot)
+        {
+            prevSlots[slot] = (slot == firstSlot) ? InvalidSlot : slot - 1;
+            nextSlots[slot] = (slot + 1 == endSlot) ? InvalidSlot : slot + 1;
+        }
+    }
+
+    // removed & moved points no longer widen the searched cells
+    if (numPoints != 0)
+    {
+        occupiedMin = cells[0];
+        occupiedMax = cells[0];
+        for (int axis = 0; axis != K; ++axis)
+        {
+            for (const Cell& cell : cells)
+            {
+                occupiedMin.coords[axis] = std::min(occupiedMin.coords[axis], cell.coords[axis]);
+                occupiedMax.coords[axis] = std::max(occupiedMax.coords[axis], cell.coords[axis]);
+            }
+        }
+    }
+}
+
+template <class VEC, int K>
+inline bool t_spatial_hash_grid<VEC, K>::isValid(tPointId id) const
+{
+    return id < idSlots.size() && idSlots[id] != InvalidSlot;
+}
+
+template <class VEC, int K>
+inline const VEC& t_spatial_hash_grid<VEC, K>::getPosition(tPointId id) const
+{
+    return points[idSlots[id]];
+}
+
+template <class VEC, int K>
+inline uint32_t t_spatial_hash_grid<VEC, K>::getNumPoints() const
+{
+    return numPoints;
+}
+
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::T t_spatial_hash_grid<VEC, K>::getCellSize() const
+{
+    return cellSize;
+}
+
+template <class VEC, int K>
+inline typename t_spatial_hash_grid<VEC, K>::tPointId t_spatial_hash_grid<VEC, K>::findNearestNeighbor(const VEC& inVec) const
+{
+    NearestCollector collector;
+    searchNearest(inVec, collector);
+    return collector.id;
+}
+
+template <class VEC, int K>
+inline uint32_t t_spatial_hash_grid<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, Neighbor* outNeighbors) const
+{
+    if (k == 0)
+        return 0;
+
+    KNearestCollector collector(outNeighbors, k);
+    searchNearest(inVec, collector);
+    std::sort_heap(outNeighbors, outNeighbors + collector.numNeighbors, [](const Neighbor& a, const Neighbor& b) { return a.distanceSqr < b.distanceSqr; });
+    return collector.numNeighbors;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::findKNearestNeighbors(const VEC& inVec, uint32_t k, std::vector<Neighbor>& outNeighbors) const
+{
+    outNeighbors.resize(std::min(k, numPoints));
+    outNeighbors.resize(findKNearestNeighbors(inVec, k, outNeighbors.data()));
+}
+
+template <class VEC, int K>
+inline uint32_t t_spatial_hash_grid<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, tPointId* outIds, uint32_t maxPoints) const
+{
+    struct Output
+    {
+        tPointId* pIds;
+        uint32_t maxPoints;
+        uint32_t numPoints;
+    } output = {outIds, maxPoints, 0};
+    findPointsInRadius(inVec, radius, [](tPointId id, const VEC&, void* pUserData) {
+        Output& output = *static_cast<Output*>(pUserData);
+        if (output.numPoints < output.maxPoints)
+            output.pIds[output.numPoints] = id;
+        ++output.numPoints;
+    }, &output);
+    return output.numPoints;
+}
+
+template <class VEC, int K>
+inline void t_spatial_hash_grid<VEC, K>::findPointsInRadius(const VEC& inVec, T radius, fPointCallback callback, void* pUserData) const
+{
+    if (numPoints == 0)
+        return;
+
+    T query[K];
+    KDTreeUtil::getCoordinates<K>(inVec, query);
+    const T radiusSqr = radius * radius;
+    auto measure = [&](uint32_t slot) {
+        if (getDistanceSqr(slot, query) < radiusSqr)
+            callback(ids[slot], points[slot], pUserData);
+    };
+
+    // cells overlapped by the radius' bounding box, within the occupied cells
+    // clamped before converting, as huge or infinite radii don't fit in an integer (nan finds nothing)
+    int64_t cellMin[K];
+    int64_t cellMax[K];
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T low = std::floor((query[axis] - radius) * invCellSize);
+        const T high = std::floor((query[axis] + radius) * invCellSize);
+        if (!(low <= static_cast<T>(occupiedMax.coords[axis])) || !(high >= static_cast<T>(occupiedMin.coords[axis])))
+            return;
+        cellMin[axis] = (low <= static_cast<T>(occupiedMin.coords[axis])) ? int64_t(occupiedMin.coords[axis]) : static_cast<int64_t>(low);
+        cellMax[axis] = (high >= static_cast<T>(occupiedMax.coords[axis])) ? int64_t(occupiedMax.coords[axis]) : static_cast<int64_t>(high);
+        if (cellMin[axis] > cellMax[axis])
+            return;
+    }
+
+    // radius far wider than the cells, scanning every point is cheaper
+    if (getNumCells(cellMin, cellMax) > static_cast<double>(ids.size()))
+        visitAllSlots(measure);
+    else
+        visitCells(cellMin, cellMax, measure);
+}
+#pragma endregion
+
+// 2D & 3D grids over 32 & 64 bit vectors
+typedef t_spatial_hash_grid<vec2_32, 2> hashgrid2_32;
+typedef t_spatial_hash_grid<vec2_64, 2> hashgrid2_64;
+typedef t_spatial_hash_grid<vec3_32, 3> hashgrid3_32;
+typedef t_spatial_hash_grid<vec3_64, 3> hashgrid3_64;
+
+// default to 32 bit
+typedef hashgrid2_32 hashgrid2;
+typedef hashgrid3_32 hashgrid3;
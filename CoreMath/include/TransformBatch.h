@@ -0,0 +1,181 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "Matrix4.h"
+#include "Parallel.h"
+#include "Pose.h"
+#include "Transform.h"
+#include "VectorSoA.h"
+#include <cstdint>
+
+// disabling 'loss of precision' warnings as literals will be typed w/ double precision
+#pragma warning(push)
+#pragma warning(disable : 4244)
+
+// one transform, pose or matrix applied to spans of points or vectors
+//
+// the source is precomputed into an affine matrix once per call, spans then run through the VectorSoA transform
+// kernels (vectorized & dispatched at runtime for float, see SIMD.h), array of structures spans transpose
+// in registers. outputs may alias inputs, so spans can be transformed in place.
+//
+// the Parallel versions split spans over worker threads (0: every hardware thread), worth it from ~100k points.
+// results match the sources' transformPoint & transformVector within rounding of the precomputed matrix.
+namespace TransformBatch
+{
+    // points per work item of the Parallel versions
+    constexpr uint32_t ParallelBlockSize = 1 << 14;
+
+    // matrices applying transformPoint & transformVector of a source, rotations must be unit length
+    template <class T>
+    t_mat4<T> getMatrix(const t_mat4<T>& m);
+    template <class T>
+    t_mat4<T> getMatrix(const t_transform<T>& t);
+    template <class T>
+    t_mat4<T> getMatrix(const t_pose<T>& p);
+
+    // array of structures spans
+    template <class SOURCE, class T>
+    void transformPoints(const SOURCE& source, const t_vec3<T>* points, uint32_t count, t_vec3<T>* outPoints);
+    template <class SOURCE, class T>
+    void transformVectors(const SOURCE& source, const t_vec3<T>* vectors, uint32_t count, t_vec3<T>* outVectors);
+    template <class SOURCE, class T>
+    void transformPointsParallel(const SOURCE& source, const t_vec3<T>* points, uint32_t count, t_vec3<T>* outPoints, uint32_t numThreads = 0);
+    template <class SOURCE, class T>
+    void transformVectorsParallel(const SOURCE& source, const t_vec3<T>* vectors, uint32_t count, t_vec3<T>* outVectors, uint32_t numThreads = 0);
+
+    // structure of arrays spans, out is sized to match
+    template <class SOURCE, class T>
+    void transformPoints(const SOURCE& source, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints);
+    template <class SOURCE, class T>
+    void transformVectors(const SOURCE& source, const t_vec_soa<T, 3>& vectors, t_vec_soa<T, 3>& outVectors);
+    template <class SOURCE, class T>
+    void transformPointsParallel(const SOURCE& source, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads = 0);
+    template <class SOURCE, class T>
+    void transformVectorsParallel(const SOURCE& source, const t_vec_soa<T, 3>& vectors, t_vec_soa<T, 3>& outVectors, uint32_t numThreads = 0);
+} // namespace TransformBatch
+
+#pragma region Static_Definitions
+namespace TransformBatch
+{
+    template <class T>
+    inline t_mat4<T> getMatrix(const t_mat4<T>& m)
+    {
+        return m;
+    }
+
+    template <class T>
+    inline t_mat4<T> getMatrix(const t_transform<T>& t)
+    {
+        return t_mat4<T>(t);
+    }
+
+    template <class T>
+    inline t_mat4<T> getMatrix(const t_pose<T>& p)
+    {
+        return t_mat4<T>(p);
+    }
+
+    template <bool TRANSLATE, class T>
+    inline void transformComponents(const t_mat4<T>& m, const T* const* a, uint32_t count, T* const* out)
+    {
+        if (TRANSLATE)
+            VectorSoA::transformPoints<T>(&m.data[0][0], a, count, out);
+        else
+            VectorSoA::transformVectors<T>(&m.data[0][0], a, count, out);
+    }
+
+    // array of structures spans run on their components in place, t_vec3 is 3 packed values
+    template <bool TRANSLATE, class T>
+    inline void transformAoS(const t_mat4<T>& m, const t_vec3<T>* a, uint32_t count, t_vec3<T>* out)
+    {
+        static_assert(sizeof(t_vec3<T>) == 3 * sizeof(T), "t_vec3 must be packed");
+        const T* pIn = reinterpret_cast<const T*>(a);
+        T* pOut = reinterpret_cast<T*>(out);
+        if (TRANSLATE)
+            VectorSoA::transformInterleavedPoints<T>(&m.data[0][0], pIn, count, pOut);
+        else
+            VectorSoA::transformInterleavedVectors<T>(&m.data[0][0], pIn, count, pOut);
+    }
+
+    // [rangeBegin, rangeEnd) of a structure of arrays span
+    template <bool TRANSLATE, class T>
+    inline void transformSoA(const t_mat4<T>& m, const t_vec_soa<T, 3>& a, uint32_t rangeBegin, uint32_t rangeEnd, t_vec_soa<T, 3>& out)
+    {
+        const T* aComponents[3];
+        T* outComponents[3];
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            aComponents[axis] = a.getComponent(axis) + rangeBegin;
+            outComponents[axis] = out.getComponent(axis) + rangeBegin;
+        }
+        transformComponents<TRANSLATE>(m, aComponents, rangeEnd - rangeBegin, outComponents);
+    }
+
+    template <class SOURCE, class T>
+    inline void transformPoints(const SOURCE& source, const t_vec3<T>* points, uint32_t count, t_vec3<T>* outPoints)
+    {
+        transformAoS<true>(getMatrix(source), points, count, outPoints);
+    }
+
+    template <class SOURCE, class T>
+    inline void transformVectors(const SOURCE& source, const t_vec3<T>* vectors, uint32_t count, t_vec3<T>* outVectors)
+    {
+        transformAoS<false>(getMatrix(source), vectors, count, outVectors);
+    }
+
+    template <class SOURCE, class T>
+    inline void transformPointsParallel(const SOURCE& source, const t_vec3<T>* points, uint32_t count, t_vec3<T>* outPoints, uint32_t numThreads)
+    {
+        const t_mat4<T> m = getMatrix(source);
+        Parallel::forRange(count, ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            transformAoS<true>(m, points + rangeBegin, rangeEnd - rangeBegin, outPoints + rangeBegin);
+        });
+    }
+
+    template <class SOURCE, class T>
+    inline void transformVectorsParallel(const SOURCE& source, const t_vec3<T>* vectors, uint32_t count, t_vec3<T>* outVectors, uint32_t numThreads)
+    {
+        const t_mat4<T> m = getMatrix(source);
+        Parallel::forRange(count, ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            transformAoS<false>(m, vectors + rangeBegin, rangeEnd - rangeBegin, outVectors + rangeBegin);
+        });
+    }
+
+    template <class SOURCE, class T>
+    inline void transformPoints(const SOURCE& source, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints)
+    {
+        outPoints.resize(points.getSize());
+        transformSoA<true>(getMatrix(source), points, 0, points.getSize(), outPoints);
+    }
+
+    template <class SOURCE, class T>
+    inline void transformVectors(const SOURCE& source, const t_vec_soa<T, 3>& vectors, t_vec_soa<T, 3>& outVectors)
+    {
+        outVectors.resize(vectors.getSize());
+        transformSoA<false>(getMatrix(source), vectors, 0, vectors.getSize(), outVectors);
+    }
+
+    template <class SOURCE, class T>
+    inline void transformPointsParallel(const SOURCE& source, const t_vec_soa<T, 3>& points, t_vec_soa<T, 3>& outPoints, uint32_t numThreads)
+    {
+        const t_mat4<T> m = getMatrix(source);
+        outPoints.resize(points.getSize());
+        Parallel::forRange(points.getSize(), ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            transformSoA<true>(m, points, rangeBegin, rangeEnd, outPoints);
+        });
+    }
+
+    template <class SOURCE, class T>
+    inline void transformVectorsParallel(const SOURCE& source, const t_vec_soa<T, 3>& vectors, t_vec_soa<T, 3>& outVectors, uint32_t numThreads)
+    {
+        const t_mat4<T> m = getMatrix(source);
+        outVectors.resize(vectors.getSize());
+        Parallel::forRange(vectors.getSize(), ParallelBlockSize, numThreads, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+            transformSoA<false>(m, vectors, rangeBegin, rangeEnd, outVectors);
+        });
+    }
+} // namespace TransformBatch
+#pragma endregion
+
+#pragma warning(pop)
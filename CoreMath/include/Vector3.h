@@ -183,18 +183,15 @@ inline T t_vec3<T>::angle(const t_vec3<T>& v2) const
 template <class T>
 inline t_vec3<T> t_vec3<T>::cross(const t_vec3<T>& v1, const t_vec3<T>& v2)
 {
-    T x = (v1.y * v2.z) - (v1.z * v2.y);
-    T y = (v1.x * v2.z) - (v1.z * v2.x);
-    T z = (v1.x * v2.y) - (v1.y * v2.z);
+    const T x = (v1.y * v2.z) - (v1.z * v2.y);
+    const T y = (v1.z * v2.x) - (v1.x * v2.z);
+    const T z = (v1.x * v2.y) - (v1.y * v2.x);
     return t_vec3<T>(x, y, z);
 }
 template <class T>
 inline t_vec3<T> t_vec3<T>::cross(const t_vec3<T>& v2) const
 {
-    T x = (y * v2.z) - (z * v2.y);
-    T y = (x * v2.z) - (z * v2.x);
-    T z = (x * v2.y) - (y * v2.z);
-    return t_vec3(x, y, z);
+    return cross(*this, v2);
 }
 #pragma endregion
 
@@ -0,0 +1,632 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "MathHelpers.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// disabling 'loss of precision' warnings as literals will be typed w/ double precision
+#pragma warning(push)
+#pragma warning(disable : 4244)
+
+namespace VectorSoA
+{
+    // alignment of every component array, a cache line & the widest vector register
+    constexpr size_t Alignment = 64;
+
+    // std allocator handing out Alignment aligned blocks
+    template <class T>
+    class t_aligned_allocator
+    {
+      public:
+        typedef T value_type;
+
+        t_aligned_allocator() {}
+        template <class U>
+        t_aligned_allocator(const t_aligned_allocator<U>&)
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            // over-allocate, the unaligned block pointer is stashed right before the aligned one
+            void* pBlock = ::operator new(count * sizeof(T) + Alignment + sizeof(void*));
+            const uintptr_t aligned = (reinterpret_cast<uintptr_t>(pBlock) + sizeof(void*) + Alignment - 1) & ~uintptr_t(Alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = pBlock;
+            return reinterpret_cast<T*>(aligned);
+        }
+        void deallocate(T* p, size_t)
+        {
+            ::operator delete(reinterpret_cast<void**>(p)[-1]);
+        }
+
+        template <class U>
+        bool operator==(const t_aligned_allocator<U>&) const
+        {
+            return true;
+        }
+        template <class U>
+        bool operator!=(const t_aligned_allocator<U>&) const
+        {
+            return false;
+        }
+    };
+
+    // vector type with K components
+    template <class T, int K>
+    struct t_vec_k
+    {
+        static_assert(K == 2 || K == 3, "2d & 3d vectors only");
+        typedef typename std::conditional<K == 2, t_vec2<T>, t_vec3<T>>::type type;
+    };
+
+    template <class T>
+    inline T& getComponent(t_vec2<T>& v, int axis)
+    {
+        return (axis == 0) ? v.x : v.y;
+    }
+    template <class T>
+    inline T& getComponent(t_vec3<T>& v, int axis)
+    {
+        return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+    }
+    template <class T>
+    inline T getComponent(const t_vec2<T>& v, int axis)
+    {
+        return (axis == 0) ? v.x : v.y;
+    }
+    template <class T>
+    inline T getComponent(const t_vec3<T>& v, int axis)
+    {
+        return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+    }
+} // namespace VectorSoA
+
+// 2d or 3d vectors stored as structure of arrays: one array per component
+//
+// each component array starts Alignment aligned & is padded with zeros to a multiple of PaddingSize elements,
+// so kernels can stream whole SIMD registers. all components share one allocation, component after component.
+//
+// see the end of the file for ease-of-use typedefs.
+// in general, use 'vec3_soa' as the type around your code.
+//
+template <class T, int K>
+class t_vec_soa
+{
+  public:
+    typedef typename VectorSoA::t_vec_k<T, K>::type tVec;
+
+    // component arrays are padded to a multiple of this many elements
+    static constexpr uint32_t PaddingSize = VectorSoA::Alignment / sizeof(T);
+
+    t_vec_soa() {}
+    explicit t_vec_soa(uint32_t inSize);
+    explicit t_vec_soa(const std::vector<tVec>& vectors);
+
+    uint32_t getSize() const;
+    // elements per component array, padding included
+    uint32_t getPaddedSize() const;
+
+    // existing vectors are kept, new ones are zero
+    void resize(uint32_t inSize);
+
+    T* getComponent(int axis);
+    const T* getComponent(int axis) const;
+    // the padded component arrays, back to back: K * getPaddedSize() elements
+    T* getData();
+    const T* getData() const;
+
+    tVec get(uint32_t index) const;
+    void set(uint32_t index, const tVec& v);
+
+    // transposes from & to array of structures
+    void fromAoS(const tVec* vectors, uint32_t count);
+    void fromAoS(const std::vector<tVec>& vectors);
+    void toAoS(tVec* outVectors) const;
+    void toAoS(std::vector<tVec>& outVectors) const;
+
+  private:
+    std::vector<T, VectorSoA::t_aligned_allocator<T>> data;
+    uint32_t size = 0;
+    uint32_t paddedSize = 0;
+};
+
+// batch kernels over structure of arrays vectors
+//
+// the pointer versions take one array per component & handle any count, the container versions size their output.
+// outputs may alias inputs. float kernels are vectorized under COREMATH_SIMD (see VectorSoA.cpp) & match the scalar
+// results within the tolerance documented in SIMD.h: same operations, same order, no reciprocal approximations.
+namespace VectorSoA
+{
+    // out = a + b, per element
+    template <class T>
+    void add(const T* a, const T* b, uint32_t count, T* out);
+    // out = a - b, per element
+    template <class T>
+    void sub(const T* a, const T* b, uint32_t count, T* out);
+    // out = a * scale, per element
+    template <class T>
+    void scale(const T* a, T scale, uint32_t count, T* out);
+    // out = a + (b - a) * t, per element
+    template <class T>
+    void lerp(const T* a, const T* b, T t, uint32_t count, T* out);
+
+    // out = dot(a, b), a & b K component arrays each
+    template <class T, int K>
+    void dot(const T* const* a, const T* const* b, uint32_t count, T* out);
+    // out = |a|
+    template <class T, int K>
+    void length(const T* const* a, uint32_t count, T* out);
+    // out = a / |a|, zero length vectors become NaN as with t_vec3::normalize
+    template <class T, int K>
+    void normalize(const T* const* a, uint32_t count, T* const* out);
+    // out = a x b, 3 component arrays each
+    template <class T>
+    void cross(const T* const* a, const T* const* b, uint32_t count, T* const* out);
+    // out = m * a for the affine matrix m: 3 rows of 4 values, row major as in t_mat4
+    // points are translated by the last column, vectors aren't. 3 component arrays each
+    template <class T>
+    void transformPoints(const T* m, const T* const* a, uint32_t count, T* const* out);
+    template <class T>
+    void transformVectors(const T* m, const T* const* a, uint32_t count, T* const* out);
+    // the same over count interleaved xyz triples, arrays of t_vec3 as arrays of T
+    template <class T>
+    void transformInterleavedPoints(const T* m, const T* a, uint32_t count, T* out);
+    template <class T>
+    void transformInterleavedVectors(const T* m, const T* a, uint32_t count, T* out);
+
+    // vectorized under COREMATH_SIMD, see VectorSoA.cpp
+    template <>
+    void add<float>(const float* a, const float* b, uint32_t count, float* out);
+    template <>
+    void sub<float>(const float* a, const float* b, uint32_t count, float* out);
+    template <>
+    void scale<float>(const float* a, float scale, uint32_t count, float* out);
+    template <>
+    void lerp<float>(const float* a, const float* b, float t, uint32_t count, float* out);
+    template <>
+    void dot<float, 2>(const float* const* a, const float* const* b, uint32_t count, float* out);
+    template <>
+    void dot<float, 3>(const float* const* a, const float* const* b, uint32_t count, float* out);
+    template <>
+    void length<float, 2>(const float* const* a, uint32_t count, float* out);
+    template <>
+    void length<float, 3>(const float* const* a, uint32_t count, float* out);
+    template <>
+    void normalize<float, 2>(const float* const* a, uint32_t count, float* const* out);
+    template <>
+    void normalize<float, 3>(const float* const* a, uint32_t count, float* const* out);
+    template <>
+    void cross<float>(const float* const* a, const float* const* b, uint32_t count, float* const* out);
+    template <>
+    void transformPoints<float>(const float* m, const float* const* a, uint32_t count, float* const* out);
+    template <>
+    void transformVectors<float>(const float* m, const float* const* a, uint32_t count, float* const* out);
+    template <>
+    void transformInterleavedPoints<float>(const float* m, const float* a, uint32_t count, float* out);
+    template <>
+    void transformInterleavedVectors<float>(const float* m, const float* a, uint32_t count, float* out);
+
+    // container versions, a & b must be the same size
+    template <class T, int K>
+    void add(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, t_vec_soa<T, K>& out);
+    template <class T, int K>
+    void sub(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, t_vec_soa<T, K>& out);
+    template <class T, int K>
+    void scale(const t_vec_soa<T, K>& a, T scale, t_vec_soa<T, K>& out);
+    template <class T, int K>
+    void lerp(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, T t, t_vec_soa<T, K>& out);
+    // out holds a.getSize() values
+    template <class T, int K>
+    void dot(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, T* out);
+    template <class T, int K>
+    void length(const t_vec_soa<T, K>& a, T* out);
+    template <class T, int K>
+    void normalize(const t_vec_soa<T, K>& a, t_vec_soa<T, K>& out);
+    template <class T>
+    void cross(const t_vec_soa<T, 3>& a, const t_vec_soa<T, 3>& b, t_vec_soa<T, 3>& out);
+} // namespace VectorSoA
+
+#pragma region Constructors
+template <class T, int K>
+inline t_vec_soa<T, K>::t_vec_soa(uint32_t inSize)
+{
+    resize(inSize);
+}
+
+template <class T, int K>
+inline t_vec_soa<T, K>::t_vec_soa(const std::vector<tVec>& vectors)
+{
+    fromAoS(vectors);
+}
+#pragma endregion
+
+#pragma region Member_Functions
+template <class T, int K>
+inline uint32_t t_vec_soa<T, K>::getSize() const
+{
+    return size;
+}
+
+template <class T, int K>
+inline uint32_t t_vec_soa<T, K>::getPaddedSize() const
+{
+    return paddedSize;
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::resize(uint32_t inSize)
+{
+    const uint32_t newPaddedSize = (inSize + PaddingSize - 1) / PaddingSize * PaddingSize;
+    if (newPaddedSize != paddedSize)
+    {
+        // components move to their new offsets
+        const size_t newDataSize = size_t(K) * newPaddedSize;
+        std::vector<T, VectorSoA::t_aligned_allocator<T>> newData(newDataSize, T(0));
+        const uint32_t keptSize = std::min(size, inSize);
+        for (int axis = 0; axis != K; ++axis)
+        {
+            std::copy(data.begin() + size_t(axis) * paddedSize, data.begin() + size_t(axis) * paddedSize + keptSize, newData.begin() + size_t(axis) * newPaddedSize);
+        }
+        data.swap(newData);
+        paddedSize = newPaddedSize;
+    }
+    else
+    {
+        // keep the padding zero
+        for (int axis = 0; axis != K && inSize < size; ++axis)
+        {
+            std::fill(data.begin() + size_t(axis) * paddedSize + inSize, data.begin() + size_t(axis) * paddedSize + size, T(0));
+        }
+    }
+    size = inSize;
+}
+
+template <class T, int K>
+inline T* t_vec_soa<T, K>::getComponent(int axis)
+{
+    return data.data() + size_t(axis) * paddedSize;
+}
+
+template <class T, int K>
+inline const T* t_vec_soa<T, K>::getComponent(int axis) const
+{
+    return data.data() + size_t(axis) * paddedSize;
+}
+
+template <class T, int K>
+inline T* t_vec_soa<T, K>::getData()
+{
+    return data.data();
+}
+
+template <class T, int K>
+inline const T* t_vec_soa<T, K>::getData() const
+{
+    return data.data();
+}
+
+template <class T, int K>
+inline typename t_vec_soa<T, K>::tVec t_vec_soa<T, K>::get(uint32_t index) const
+{
+    tVec v;
+    for (int axis = 0; axis != K; ++axis)
+    {
+        VectorSoA::getComponent(v, axis) = data[size_t(axis) * paddedSize + index];
+    }
+    return v;
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::set(uint32_t index, const tVec& v)
+{
+    for (int axis = 0; axis != K; ++axis)
+    {
+        data[size_t(axis) * paddedSize + index] = VectorSoA::getComponent(v, axis);
+    }
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::fromAoS(const tVec* vectors, uint32_t count)
+{
+    resize(count);
+    // one component at a time, the writes stream & the reads stay within a few cache lines
+    for (int axis = 0; axis != K; ++axis)
+    {
+        T* pComponent = getComponent(axis);
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            pComponent[i] = VectorSoA::getComponent(vectors[i], axis);
+        }
+    }
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::fromAoS(const std::vector<tVec>& vectors)
+{
+    fromAoS(vectors.data(), static_cast<uint32_t>(vectors.size()));
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::toAoS(tVec* outVectors) const
+{
+    for (int axis = 0; axis != K; ++axis)
+    {
+        const T* pComponent = getComponent(axis);
+        for (uint32_t i = 0; i != size; ++i)
+        {
+            VectorSoA::getComponent(outVectors[i], axis) = pComponent[i];
+        }
+    }
+}
+
+template <class T, int K>
+inline void t_vec_soa<T, K>::toAoS(std::vector<tVec>& outVectors) const
+{
+    outVectors.resize(size);
+    toAoS(outVectors.data());
+}
+#pragma endregion
+
+#pragma region Static_Definitions
+namespace VectorSoA
+{
+    template <class T>
+    inline void add(const T* a, const T* b, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            out[i] = a[i] + b[i];
+        }
+    }
+
+    template <class T>
+    inline void sub(const T* a, const T* b, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            out[i] = a[i] - b[i];
+        }
+    }
+
+    template <class T>
+    inline void scale(const T* a, T scale, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            out[i] = a[i] * scale;
+        }
+    }
+
+    template <class T>
+    inline void lerp(const T* a, const T* b, T t, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            out[i] = a[i] + (b[i] - a[i]) * t;
+        }
+    }
+
+    template <class T, int K>
+    inline void dot(const T* const* a, const T* const* b, uint32_t count, T* out)
+    {
+        // same operation order as t_vec3::dot
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            T result = a[0][i] * b[0][i];
+            for (int axis = 1; axis != K; ++axis)
+            {
+                result += a[axis][i] * b[axis][i];
+            }
+            out[i] = result;
+        }
+    }
+
+    template <class T, int K>
+    inline void length(const T* const* a, uint32_t count, T* out)
+    {
+        dot<T, K>(a, a, count, out);
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            out[i] = MathT::sqrt<T>(out[i]);
+        }
+    }
+
+    template <class T, int K>
+    inline void normalize(const T* const* a, uint32_t count, T* const* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            T lengthSqr = a[0][i] * a[0][i];
+            for (int axis = 1; axis != K; ++axis)
+            {
+                lengthSqr += a[axis][i] * a[axis][i];
+            }
+            const T length = MathT::sqrt<T>(lengthSqr);
+            for (int axis = 0; axis != K; ++axis)
+            {
+                out[axis][i] = a[axis][i] / length;
+            }
+        }
+    }
+
+    template <class T>
+    inline void cross(const T* const* a, const T* const* b, uint32_t count, T* const* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const T x = (a[1][i] * b[2][i]) - (a[2][i] * b[1][i]);
+            const T y = (a[2][i] * b[0][i]) - (a[0][i] * b[2][i]);
+            const T z = (a[0][i] * b[1][i]) - (a[1][i] * b[0][i]);
+            out[0][i] = x;
+            out[1][i] = y;
+            out[2][i] = z;
+        }
+    }
+
+    template <class T>
+    inline void transformPoints(const T* m, const T* const* a, uint32_t count, T* const* out)
+    {
+        // same operation order as t_mat4 * t_vec3
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const T x = a[0][i], y = a[1][i], z = a[2][i];
+            for (int row = 0; row != 3; ++row)
+            {
+                const T* pRow = m + 4 * row;
+                out[row][i] = (pRow[0] * x) + (pRow[1] * y) + (pRow[2] * z) + pRow[3];
+            }
+        }
+    }
+
+    template <class T>
+    inline void transformVectors(const T* m, const T* const* a, uint32_t count, T* const* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const T x = a[0][i], y = a[1][i], z = a[2][i];
+            for (int row = 0; row != 3; ++row)
+            {
+                const T* pRow = m + 4 * row;
+                out[row][i] = (pRow[0] * x) + (pRow[1] * y) + (pRow[2] * z);
+            }
+        }
+    }
+
+    template <class T>
+    inline void transformInterleavedPoints(const T* m, const T* a, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const T x = a[3 * i], y = a[3 * i + 1], z = a[3 * i + 2];
+            for (int row = 0; row != 3; ++row)
+            {
+                const T* pRow = m + 4 * row;
+                out[3 * i + row] = (pRow[0] * x) + (pRow[1] * y) + (pRow[2] * z) + pRow[3];
+            }
+        }
+    }
+
+    template <class T>
+    inline void transformInterleavedVectors(const T* m, const T* a, uint32_t count, T* out)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const T x = a[3 * i], y = a[3 * i + 1], z = a[3 * i + 2];
+            for (int row = 0; row != 3; ++row)
+            {
+                const T* pRow = m + 4 * row;
+                out[3 * i + row] = (pRow[0] * x) + (pRow[1] * y) + (pRow[2] * z);
+            }
+        }
+    }
+
+    // component array pointers of a container
+    template <class T, int K>
+    inline void getComponents(const t_vec_soa<T, K>& v, const T** outComponents)
+    {
+        for (int axis = 0; axis != K; ++axis)
+        {
+            outComponents[axis] = v.getComponent(axis);
+        }
+    }
+    template <class T, int K>
+    inline void getComponents(t_vec_soa<T, K>& v, T** outComponents)
+    {
+        for (int axis = 0; axis != K; ++axis)
+        {
+            outComponents[axis] = v.getComponent(axis);
+        }
+    }
+
+    // element wise kernels run once over every padded component, padding stays zero
+    template <class T, int K>
+    inline void add(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, t_vec_soa<T, K>& out)
+    {
+        out.resize(a.getSize());
+        add<T>(a.getData(), b.getData(), K * a.getPaddedSize(), out.getData());
+    }
+
+    template <class T, int K>
+    inline void sub(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, t_vec_soa<T, K>& out)
+    {
+        out.resize(a.getSize());
+        sub<T>(a.getData(), b.getData(), K * a.getPaddedSize(), out.getData());
+    }
+
+    template <class T, int K>
+    inline void scale(const t_vec_soa<T, K>& a, T scale, t_vec_soa<T, K>& out)
+    {
+        out.resize(a.getSize());
+        VectorSoA::scale<T>(a.getData(), scale, K * a.getPaddedSize(), out.getData());
+    }
+
+    template <class T, int K>
+    inline void lerp(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, T t, t_vec_soa<T, K>& out)
+    {
+        out.resize(a.getSize());
+        lerp<T>(a.getData(), b.getData(), t, K * a.getPaddedSize(), out.getData());
+    }
+
+    template <class T, int K>
+    inline void dot(const t_vec_soa<T, K>& a, const t_vec_soa<T, K>& b, T* out)
+    {
+        const T* aComponents[K];
+        const T* bComponents[K];
+        getComponents(a, aComponents);
+        getComponents(b, bComponents);
+        dot<T, K>(aComponents, bComponents, a.getSize(), out);
+    }
+
+    template <class T, int K>
+    inline void length(const t_vec_soa<T, K>& a, T* out)
+    {
+        const T* aComponents[K];
+        getComponents(a, aComponents);
+        length<T, K>(aComponents, a.getSize(), out);
+    }
+
+    template <class T, int K>
+    inline void normalize(const t_vec_soa<T, K>& a, t_vec_soa<T, K>& out)
+    {
+        // only the used range, normalizing the zero padding would fill it with NaNs
+        out.resize(a.getSize());
+        const T* aComponents[K];
+        T* outComponents[K];
+        getComponents(a, aComponents);
+        getComponents(out, outComponents);
+        normalize<T, K>(aComponents, a.getSize(), outComponents);
+    }
+
+    template <class T>
+    inline void cross(const t_vec_soa<T, 3>& a, const t_vec_soa<T, 3>& b, t_vec_soa<T, 3>& out)
+    {
+        out.resize(a.getSize());
+        const T* aComponents[3];
+        const T* bComponents[3];
+        T* outComponents[3];
+        getComponents(a, aComponents);
+        getComponents(b, bComponents);
+        getComponents(out, outComponents);
+        cross<T>(aComponents, bComponents, a.getSize(), outComponents);
+    }
+} // namespace VectorSoA
+#pragma endregion
+
+typedef t_vec_soa<float, 2> vec2_soa_32;
+typedef t_vec_soa<double, 2> vec2_soa_64;
+typedef t_vec_soa<float, 3> vec3_soa_32;
+typedef t_vec_soa<double, 3> vec3_soa_64;
+
+// 2d vectors, structure of arrays
+typedef vec2_soa_32 vec2_soa;
+// 3d vectors, structure of arrays
+typedef vec3_soa_32 vec3_soa;
+
+#pragma warning(pop)
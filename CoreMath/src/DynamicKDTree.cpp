@@ -0,0 +1,345 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "DynamicKDTree.h"
+#include <algorithm>
+
+namespace
+{
+    bool compareDistance(const DynamicKDTree::Neighbor& l, const DynamicKDTree::Neighbor& r)
+    {
+        return l.distanceSqr < r.distanceSqr;
+    }
+
+    // bounded max-heap insertion over a caller provided buffer
+    void addCandidate(DynamicKDTree::Neighbor* pHeap, uint32_t capacity, uint32_t& count, DynamicKDTree::tPointId id, float distanceSqr)
+    {
+        if (count < capacity)
+        {
+            pHeap[count++] = {id, distanceSqr};
+            std::push_heap(pHeap, pHeap + count, compareDistance);
+        }
+        else if (distanceSqr < pHeap[0].distanceSqr)
+        {
+            // evict the furthest candidate
+            std::pop_heap(pHeap, pHeap + count, compareDistance);
+            pHeap[count - 1] = {id, distanceSqr};
+            std::push_heap(pHeap, pHeap + count, compareDistance);
+        }
+    }
+
+    // forwards live points of one level to the caller's radius callback
+    struct RadiusContext
+    {
+        const std::vector<vec3>* pPoints;
+        const std::vector<DynamicKDTree::tPointId>* pIds;
+        DynamicKDTree::fPointCallback callback;
+        void* pUserData;
+
+        static void forwardLivePoint(uint32_t slot, void* pContext)
+        {
+            const RadiusContext& context = *static_cast<const RadiusContext*>(pContext);
+            const DynamicKDTree::tPointId id = (*context.pIds)[slot];
+            if (id != DynamicKDTree::InvalidId)
+                context.callback(id, (*context.pPoints)[slot], context.pUserData);
+        }
+    };
+} // namespace
+
+// DynamicKDTree
+DynamicKDTree::DynamicKDTree()
+{
+    insertBufferPoints.reserve(BaseCapacity);
+    insertBufferIds.reserve(BaseCapacity);
+}
+
+DynamicKDTree::DynamicKDTree(const std::vector<vec3>& inPoints) : DynamicKDTree()
+{
+    const uint32_t numInputPoints = static_cast<uint32_t>(inPoints.size());
+    if (numInputPoints == 0)
+        return;
+
+    std::vector<vec3> points = inPoints;
+    std::vector<tPointId> ids(numInputPoints);
+    for (uint32_t i = 0; i != numInputPoints; ++i)
+    {
+        ids[i] = i;
+    }
+    locations.resize(numInputPoints);
+    numPoints = numInputPoints;
+
+    // straight into the smallest level that fits
+    uint32_t levelIndex = 0;
+    while ((uint64_t(BaseCapacity) << levelIndex) < numInputPoints && levelIndex + 1 < MaxLevels)
+    {
+        ++levelIndex;
+    }
+    rebuildLevel(levelIndex, points, ids);
+}
+
+DynamicKDTree::tPointId DynamicKDTree::insert(const vec3& point)
+{
+    const tPointId id = allocateId();
+    ++numPoints;
+    addToInsertBuffer(id, point);
+    return id;
+}
+
+bool DynamicKDTree::remove(tPointId id)
+{
+    if (!isValid(id))
+        return false;
+
+    detach(id);
+    locations[id].level = FreeLevel;
+    freeIds.push_back(id);
+    --numPoints;
+    return true;
+}
+
+bool DynamicKDTree::updatePosition(tPointId id, const vec3& point)
+{
+    if (!isValid(id))
+        return false;
+
+    // buffered points can move in place
+    const PointLocation& location = locations[id];
+    if (location.level == InsertBufferLevel)
+    {
+        insertBufferPoints[location.slot] = point;
+        return true;
+    }
+
+    detach(id);
+    addToInsertBuffer(id, point);
+    return true;
+}
+
+bool DynamicKDTree::isValid(tPointId id) const
+{
+    return id < locations.size() && locations[id].level != FreeLevel;
+}
+
+const vec3& DynamicKDTree::getPosition(tPointId id) const
+{
+    const PointLocation& location = locations[id];
+    if (location.level == InsertBufferLevel)
+        return insertBufferPoints[location.slot];
+    return levels[location.level].points[location.slot];
+}
+
+uint32_t DynamicKDTree::getNumPoints() const
+{
+    return numPoints;
+}
+
+DynamicKDTree::tPointId DynamicKDTree::findNearestNeighbor(const vec3& inVec) const
+{
+    tPointId result = InvalidId;
+    float minDistanceSqr = FLT_MAX;
+
+    for (uint32_t i = 0, n = static_cast<uint32_t>(insertBufferIds.size()); i != n; ++i)
+    {
+        const float distanceSqr = (insertBufferPoints[i] - inVec).getLengthSquared();
+        if (distanceSqr < minDistanceSqr)
+        {
+            minDistanceSqr = distanceSqr;
+            result = insertBufferIds[i];
+        }
+    }
+
+    for (const Level& level : levels)
+    {
+        if (!level.pTree)
+            continue;
+
+        const vec3* pNearest = level.pTree->findNearestNeighbor(inVec, isLivePoint, const_cast<Level*>(&level));
+        if (pNearest == nullptr)
+            continue;
+
+        const float distanceSqr = (*pNearest - inVec).getLengthSquared();
+        if (distanceSqr < minDistanceSqr)
+        {
+            minDistanceSqr = distanceSqr;
+            result = level.ids[pNearest - level.points.data()];
+        }
+    }
+
+    return result;
+}
+
+uint32_t DynamicKDTree::findKNearestNeighbors(const vec3& inVec, uint32_t k, Neighbor* outNeighbors) const
+{
+    if (k == 0)
+        return 0;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0, n = static_cast<uint32_t>(insertBufferIds.size()); i != n; ++i)
+    {
+        addCandidate(outNeighbors, k, count, insertBufferIds[i], (insertBufferPoints[i] - inVec).getLengthSquared());
+    }
+
+    // per thread scratch for the levels' results, only allocating when k grows past any earlier query's
+    thread_local std::vector<KDTree::Neighbor> levelNeighbors;
+    if (levelNeighbors.size() < k)
+        levelNeighbors.resize(k);
+    for (const Level& level : levels)
+    {
+        if (!level.pTree)
+            continue;
+
+        const uint32_t numFound = level.pTree->findKNearestNeighbors(inVec, k, levelNeighbors.data(), isLivePoint, const_cast<Level*>(&level));
+        for (uint32_t i = 0; i != numFound; ++i)
+        {
+            const KDTree::Neighbor& neighbor = levelNeighbors[i];
+            addCandidate(outNeighbors, k, count, level.ids[neighbor.pPoint - level.points.data()], neighbor.distanceSqr);
+        }
+    }
+
+    std::sort_heap(outNeighbors, outNeighbors + count, compareDistance);
+    return count;
+}
+
+void DynamicKDTree::findPointsInRadius(const vec3& inVec, float radius, fPointCallback callback, void* pUserData) const
+{
+    const float radiusSqr = radius * radius;
+    for (uint32_t i = 0, n = static_cast<uint32_t>(insertBufferIds.size()); i != n; ++i)
+    {
+        if ((insertBufferPoints[i] - inVec).getLengthSquared() < radiusSqr)
+            callback(insertBufferIds[i], insertBufferPoints[i], pUserData);
+    }
+
+    for (const Level& level : levels)
+    {
+        if (!level.pTree)
+            continue;
+
+        RadiusContext context{&level.points, &level.ids, callback, pUserData};
+        level.pTree->findPointsInRadius(inVec, radius, RadiusContext::forwardLivePoint, &context);
+    }
+}
+
+DynamicKDTree::tPointId DynamicKDTree::allocateId()
+{
+    if (!freeIds.empty())
+    {
+        const tPointId id = freeIds.back();
+        freeIds.pop_back();
+        return id;
+    }
+
+    locations.push_back({FreeLevel, 0});
+    return static_cast<tPointId>(locations.size() - 1);
+}
+
+void DynamicKDTree::addToInsertBuffer(tPointId id, const vec3& point)
+{
+    locations[id] = {InsertBufferLevel, static_cast<uint32_t>(insertBufferIds.size())};
+    insertBufferPoints.push_back(point);
+    insertBufferIds.push_back(id);
+
+    if (insertBufferIds.size() == BaseCapacity)
+        flushInsertBuffer();
+}
+
+void DynamicKDTree::detach(tPointId id)
+{
+    const PointLocation location = locations[id];
+    if (location.level == InsertBufferLevel)
+    {
+        // swap & pop
+        const tPointId lastId = insertBufferIds.back();
+        insertBufferPoints[location.slot] = insertBufferPoints.back();
+        insertBufferIds[location.slot] = lastId;
+        locations[lastId].slot = location.slot;
+        insertBufferPoints.pop_back();
+        insertBufferIds.pop_back();
+        return;
+    }
+
+    // tombstone, rebuild once half the level is dead
+    Level& level = levels[location.level];
+    level.ids[location.slot] = InvalidId;
+    ++level.numRemoved;
+    if (level.numRemoved * 2 >= level.ids.size())
+    {
+        std::vector<vec3> livePoints;
+        std::vector<tPointId> liveIds;
+        livePoints.reserve(level.getNumLive());
+        liveIds.reserve(level.getNumLive());
+        for (uint32_t i = 0, n = static_cast<uint32_t>(level.ids.size()); i != n; ++i)
+        {
+            if (level.ids[i] == InvalidId)
+                continue;
+            livePoints.push_back(level.points[i]);
+            liveIds.push_back(level.ids[i]);
+        }
+        rebuildLevel(location.level, livePoints, liveIds);
+    }
+}
+
+void DynamicKDTree::flushInsertBuffer()
+{
+    // first level able to hold the buffer & every level below it
+    uint32_t targetLevel = 0;
+    uint64_t total = insertBufferIds.size() + levels[0].getNumLive();
+    while (total > (uint64_t(BaseCapacity) << targetLevel) && targetLevel + 1 < MaxLevels)
+    {
+        ++targetLevel;
+        total += levels[targetLevel].getNumLive();
+    }
+
+    std::vector<vec3> mergedPoints;
+    std::vector<tPointId> mergedIds;
+    mergedPoints.reserve(total);
+    mergedIds.reserve(total);
+
+    mergedPoints.insert(mergedPoints.end(), insertBufferPoints.begin(), insertBufferPoints.end());
+    mergedIds.insert(mergedIds.end(), insertBufferIds.begin(), insertBufferIds.end());
+    insertBufferPoints.clear();
+    insertBufferIds.clear();
+
+    for (uint32_t levelIndex = 0; levelIndex <= targetLevel; ++levelIndex)
+    {
+        Level& level = levels[levelIndex];
+        for (uint32_t i = 0, n = static_cast<uint32_t>(level.ids.size()); i != n; ++i)
+        {
+            if (level.ids[i] == InvalidId)
+                continue;
+            mergedPoints.push_back(level.points[i]);
+            mergedIds.push_back(level.ids[i]);
+        }
+
+        level.pTree.reset();
+        level.points.clear();
+        level.ids.clear();
+        level.numRemoved = 0;
+    }
+
+    rebuildLevel(targetLevel, mergedPoints, mergedIds);
+}
+
+void DynamicKDTree::rebuildLevel(uint32_t levelIndex, std::vector<vec3>& inPoints, std::vector<tPointId>& inIds)
+{
+    Level& level = levels[levelIndex];
+
+    // the tree points into level.points, so drop it before the points change
+    level.pTree.reset();
+    level.points.swap(inPoints);
+    level.ids.swap(inIds);
+    level.numRemoved = 0;
+
+    for (uint32_t i = 0, n = static_cast<uint32_t>(level.ids.size()); i != n; ++i)
+    {
+        locations[level.ids[i]] = {levelIndex, i};
+    }
+
+    if (!level.points.empty())
+        level.pTree = std::make_unique<KDTree>(level.points);
+}
+
+bool DynamicKDTree::isLivePoint(const vec3* pPoint, void* pUserData)
+{
+    const Level& level = *static_cast<const Level*>(pUserData);
+    return level.ids[pPoint - level.points.data()] != InvalidId;
+}
@@ -2,198 +2,252 @@
 // https://github.com/rshemaka/CoreMath
 
 #include "KDTree.h"
-#include <algorithm>
+#include "SIMD.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 namespace
 {
-    // comparisons
-    typedef bool (*fCompareFunc)(const vec3* l, const vec3* r);
-
-    bool compareX(const vec3* l, const vec3* r)
-    {
-        return (l->x < r->x);
-    }
-    bool compareY(const vec3* l, const vec3* r)
-    {
-        return (l->y < r->y);
-    }
-    bool compareZ(const vec3* l, const vec3* r)
+    // node counts of subtrees over numPoints & numPoints + 1 points
+    // children of either size always hold m or m + 1 points, m = (numPoints - 1) / 2, so one recursion covers both
+    std::pair<uint32_t, uint32_t> getSubtreeNodeCounts(uint32_t numPoints, uint32_t leafSize)
     {
-        return (l->z < r->z);
+        if (numPoints + 1 <= leafSize)
+            return {numPoints == 0 ? 0u : 1u, 1u};
+
+        const uint32_t m = (numPoints - 1) / 2;
+        const std::pair<uint32_t, uint32_t> childCounts = getSubtreeNodeCounts(m, leafSize);
+        auto getCount = [&](uint32_t size) {
+            if (size <= leafSize)
+                return size == 0 ? 0u : 1u;
+            const uint32_t leftSize = size / 2;
+            const uint32_t rightSize = size - 1 - leftSize;
+            return 1 + (leftSize == m ? childCounts.first : childCounts.second) + (rightSize == m ? childCounts.first : childCounts.second);
+        };
+        return {getCount(numPoints), getCount(numPoints + 1)};
     }
 
-    fCompareFunc getAxisComparison(int depth)
+    // squared distances from query to count float points stored as structure of arrays
+    template <int K>
+    void computeDistancesSqrFloat(const float* const* pCoords, uint32_t count, const float* query, float* outDistancesSqr)
     {
-        switch (depth % 3)
+        uint32_t i = 0;
+#if defined(COREMATH_AVX)
+        {
+            __m256 queryCoords[K];
+            for (int axis = 0; axis != K; ++axis)
+            {
+                queryCoords[axis] = _mm256_set1_ps(query[axis]);
+            }
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(pCoords[0] + i), queryCoords[0]);
+                __m256 distanceSqr = _mm256_mul_ps(delta, delta);
+                for (int axis = 1; axis != K; ++axis)
+                {
+                    const __m256 axisDelta = _mm256_sub_ps(_mm256_loadu_ps(pCoords[axis] + i), queryCoords[axis]);
+                    distanceSqr = _mm256_add_ps(distanceSqr, _mm256_mul_ps(axisDelta, axisDelta));
+                }
+                _mm256_storeu_ps(outDistancesSqr + i, distanceSqr);
+            }
+        }
+#endif
+#if defined(COREMATH_SSE2)
+        {
+            __m128 queryCoords[K];
+            for (int axis = 0; axis != K; ++axis)
+            {
+                queryCoords[axis] = _mm_set1_ps(query[axis]);
+            }
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 delta = _mm_sub_ps(_mm_loadu_ps(pCoords[0] + i), queryCoords[0]);
+                __m128 distanceSqr = _mm_mul_ps(delta, delta);
+                for (int axis = 1; axis != K; ++axis)
+                {
+                    const __m128 axisDelta = _mm_sub_ps(_mm_loadu_ps(pCoords[axis] + i), queryCoords[axis]);
+                    distanceSqr = _mm_add_ps(distanceSqr, _mm_mul_ps(axisDelta, axisDelta));
+                }
+                _mm_storeu_ps(outDistancesSqr + i, distanceSqr);
+            }
+        }
+#endif
+        // scalar fallback & remainder, same operation order as vec3::getLengthSquared
+        for (; i < count; ++i)
         {
-        case 0:
-            return compareX;
-        case 1:
-            return compareY;
-        case 2:
-            return compareZ;
-        default:
-            return nullptr;
+            const float delta = pCoords[0][i] - query[0];
+            float distanceSqr = delta * delta;
+            for (int axis = 1; axis != K; ++axis)
+            {
+                const float axisDelta = pCoords[axis][i] - query[axis];
+                distanceSqr += axisDelta * axisDelta;
+            }
+            outDistancesSqr[i] = distanceSqr;
         }
     }
 
-    // deltas
-    typedef float (*fDeltaFunc)(const vec3* l, const vec3* r);
-
-    float deltaX(const vec3* l, const vec3* r)
+#if defined(COREMATH_KDTREE_STATS)
+    // query totals of one thread, written by that thread only, read & reset from any
+    struct ThreadStats
     {
-        return (l->x - r->x);
-    }
-    float deltaY(const vec3* l, const vec3* r)
+        std::atomic<uint64_t> numQueries{0};
+        std::atomic<uint64_t> numNodesVisited{0};
+        std::atomic<uint64_t> numLeavesScanned{0};
+        std::atomic<uint64_t> numDistanceEvaluations{0};
+        std::atomic<uint64_t> numBacktracks{0};
+        std::atomic<uint32_t> maxDepth{0};
+
+        void add(const KDTreeQueryStats& queryStats)
+        {
+            // single writer, no read-modify-write needed
+            auto addTo = [](std::atomic<uint64_t>& counter, uint64_t value) { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); };
+            addTo(numQueries, queryStats.numQueries);
+            addTo(numNodesVisited, queryStats.numNodesVisited);
+            addTo(numLeavesScanned, queryStats.numLeavesScanned);
+            addTo(numDistanceEvaluations, queryStats.numDistanceEvaluations);
+            addTo(numBacktracks, queryStats.numBacktracks);
+            if (queryStats.maxDepth > maxDepth.load(std::memory_order_relaxed))
+                maxDepth.store(queryStats.maxDepth, std::memory_order_relaxed);
+        }
+        KDTreeQueryStats get() const
+        {
+            KDTreeQueryStats stats;
+            stats.numQueries = numQueries.load(std::memory_order_relaxed);
+            stats.numNodesVisited = numNodesVisited.load(std::memory_order_relaxed);
+            stats.numLeavesScanned = numLeavesScanned.load(std::memory_order_relaxed);
+            stats.numDistanceEvaluations = numDistanceEvaluations.load(std::memory_order_relaxed);
+            stats.numBacktracks = numBacktracks.load(std::memory_order_relaxed);
+            stats.maxDepth = maxDepth.load(std::memory_order_relaxed);
+            return stats;
+        }
+        void reset()
+        {
+            numQueries.store(0, std::memory_order_relaxed);
+            numNodesVisited.store(0, std::memory_order_relaxed);
+            numLeavesScanned.store(0, std::memory_order_relaxed);
+            numDistanceEvaluations.store(0, std::memory_order_relaxed);
+            numBacktracks.store(0, std::memory_order_relaxed);
+            maxDepth.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // totals of every live thread, & what finished threads left behind
+    struct StatsRegistry
     {
-        return (l->y - r->y);
-    }
-    float deltaZ(const vec3* l, const vec3* r)
+        std::mutex mutex;
+        std::vector<ThreadStats*> threads;
+        KDTreeQueryStats finishedTotals;
+    };
+    StatsRegistry& getStatsRegistry()
     {
-        return (l->z - r->z);
+        static StatsRegistry registry;
+        return registry;
     }
 
-    fDeltaFunc getAxisDelta(int depth)
+    // registered on a thread's first query, folded into the finished totals when it exits
+    struct ThreadStatsRegistration
     {
-        switch (depth % 3)
+        ThreadStats totals;
+        KDTreeQueryStats lastQuery;
+
+        ThreadStatsRegistration()
         {
-        case 0:
-            return deltaX;
-        case 1:
-            return deltaY;
-        case 2:
-            return deltaZ;
-        default:
-            return nullptr;
+            StatsRegistry& registry = getStatsRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(&totals);
         }
-    }
+        ~ThreadStatsRegistration()
+        {
+            StatsRegistry& registry = getStatsRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.finishedTotals += totals.get();
+            registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &totals));
+        }
+    };
+    thread_local ThreadStatsRegistration threadStats;
+#endif
 } // namespace
 
-// KDTree
-KDTree::KDTree(const std::vector<vec3>& inPoints)
+// KDTreeUtil
+uint32_t KDTreeUtil::getSubtreeNodeCount(uint32_t numPoints, uint32_t leafSize)
 {
-    // make a vector of point pointers to handle vec3 subdivision
-    tConstPointRefs pointRefs;
-    pointRefs.reserve(inPoints.size());
-    for (std::vector<vec3>::const_iterator it = inPoints.begin(), itEnd = inPoints.end(); it != itEnd; ++it)
-    {
-        const vec3* pVec = &*it;
-        pointRefs.push_back(pVec);
-    }
-    // internal constructor
-    init(pointRefs, 0);
+    return getSubtreeNodeCounts(numPoints, leafSize).first;
+}
+
+template <>
+void KDTreeUtil::computeDistancesSqr<float, 2>(const float* const* pCoords, uint32_t count, const float* query, float* outDistancesSqr)
+{
+    computeDistancesSqrFloat<2>(pCoords, count, query, outDistancesSqr);
 }
 
-KDTree::KDTree(tConstPointRefs& inPoints, int depth)
+template <>
+void KDTreeUtil::computeDistancesSqr<float, 3>(const float* const* pCoords, uint32_t count, const float* query, float* outDistancesSqr)
 {
-    init(inPoints, depth);
+    computeDistancesSqrFloat<3>(pCoords, count, query, outDistancesSqr);
 }
 
-KDTree::~KDTree()
+// KDTreeStats
+#if defined(COREMATH_KDTREE_STATS)
+KDTreeQueryStats KDTreeStats::getLastQuery()
 {
-    if (pLeftChild)
-        delete pLeftChild;
-    if (pRightChild)
-        delete pRightChild;
+    return threadStats.lastQuery;
 }
 
-void KDTree::init(tConstPointRefs& inPoints, int depth)
+KDTreeQueryStats KDTreeStats::getThreadTotals()
 {
-    pData = nullptr;
-    pLeftChild = nullptr;
-    pRightChild = nullptr;
+    return threadStats.totals.get();
+}
 
-    if (inPoints.size() == 1)
+KDTreeQueryStats KDTreeStats::getTotals()
+{
+    StatsRegistry& registry = getStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    KDTreeQueryStats totals = registry.finishedTotals;
+    for (ThreadStats* pThreadStats : registry.threads)
     {
-        pData = inPoints[0];
-        return;
+        totals += pThreadStats->get();
     }
-
-    // select sort function
-    fCompareFunc compare = getAxisComparison(depth);
-
-    // sort input
-    std::sort(inPoints.begin(), inPoints.end(), compare);
-
-    // extract median
-    uint32_t medianIndex = static_cast<uint32_t>(inPoints.size()) / 2;
-    pData = inPoints[medianIndex];
-
-    // subdivide remaining points
-    tConstPointRefs leftPoints = tConstPointRefs(inPoints.begin(), inPoints.begin() + medianIndex);
-    tConstPointRefs rightPoints = tConstPointRefs(inPoints.begin() + medianIndex + 1, inPoints.end());
-
-    // recurse
-    pLeftChild = leftPoints.empty() ? nullptr : new KDTree(leftPoints, depth + 1);
-    pRightChild = rightPoints.empty() ? nullptr : new KDTree(rightPoints, depth + 1);
+    return totals;
 }
 
-const vec3* KDTree::findNearestNeighbor(const vec3& inVec)
+void KDTreeStats::reset()
 {
-    // uninitialized?
-    if (pData == nullptr)
-        return nullptr;
-
-    const vec3* pResult = nullptr;
-    float minDistanceSqr = FLT_MAX;
-    searchNearestNeighbor(inVec, 0, pResult, minDistanceSqr);
-    return pResult;
+    StatsRegistry& registry = getStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.finishedTotals = KDTreeQueryStats();
+    for (ThreadStats* pThreadStats : registry.threads)
+    {
+        pThreadStats->reset();
+    }
 }
 
-void KDTree::searchNearestNeighbor(const vec3& inVec, int depth, const vec3*& pResult, float& flMinDistSqr)
+void KDTreeStats::recordQuery(const KDTreeQueryStats& queryStats)
+{
+    threadStats.lastQuery = queryStats;
+    threadStats.totals.add(queryStats);
+}
+#else
+KDTreeQueryStats KDTreeStats::getLastQuery()
 {
-    vec3 deltaPos = (*pData) - inVec;
-    float distanceSqr = deltaPos.getLengthSquared();
+    return KDTreeQueryStats();
+}
 
-    if (distanceSqr < flMinDistSqr)
-    {
-        // new winner!
-        flMinDistSqr = distanceSqr;
-        pResult = pData;
-    }
+KDTreeQueryStats KDTreeStats::getThreadTotals()
+{
+    return KDTreeQueryStats();
+}
 
-    // get relevant functions
-    fCompareFunc compare = getAxisComparison(depth);
-    fDeltaFunc delta = getAxisDelta(depth);
+KDTreeQueryStats KDTreeStats::getTotals()
+{
+    return KDTreeQueryStats();
+}
 
-    // pick a direction and recurse
-    enum eAction
-    {
-        eNone = 0,
-        eLeft,
-        eRight
-    };
-    eAction action = eNone;
-    if (compare(&inVec, pData))
-    {
-        if (pLeftChild)
-            pLeftChild->searchNearestNeighbor(inVec, depth + 1, pResult, flMinDistSqr);
-        action = eLeft;
-    }
-    else
-    {
-        if (pRightChild)
-            pRightChild->searchNearestNeighbor(inVec, depth + 1, pResult, flMinDistSqr);
-        action = eRight;
-    }
+void KDTreeStats::reset()
+{
+}
 
-    // candidate hypersphere (awesome name) crossing the separation plane?
-    float distToSeperation = fabs(delta(pData, &inVec));
-    float distToSeperationsSqr = distToSeperation * distToSeperation;
-    if (distToSeperationsSqr < flMinDistSqr)
-    {
-        switch (action)
-        {
-        case eLeft:
-            if (pRightChild)
-                pRightChild->searchNearestNeighbor(inVec, depth + 1, pResult, flMinDistSqr);
-            break;
-        case eRight:
-            if (pLeftChild)
-                pLeftChild->searchNearestNeighbor(inVec, depth + 1, pResult, flMinDistSqr);
-            break;
-        default:
-            break;
-        }
-    }
+void KDTreeStats::recordQuery(const KDTreeQueryStats&)
+{
 }
+#endif
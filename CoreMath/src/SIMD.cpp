@@ -0,0 +1,153 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "SIMD.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(COREMATH_SIMD) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define COREMATH_CPUID 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if defined(COREMATH_CPUID)
+    // registers eax, ebx, ecx, edx of cpuid leaf & subleaf
+    void getCpuid(uint32_t leaf, uint32_t subleaf, uint32_t* outRegisters)
+    {
+#if defined(_MSC_VER)
+        int registers[4];
+        __cpuidex(registers, int(leaf), int(subleaf));
+        for (int i = 0; i != 4; ++i)
+        {
+            outRegisters[i] = uint32_t(registers[i]);
+        }
+#else
+        __cpuid_count(leaf, subleaf, outRegisters[0], outRegisters[1], outRegisters[2], outRegisters[3]);
+#endif
+    }
+
+    // register state the os saves on context switches, the XCR0 bits
+    uint64_t getEnabledRegisterState()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (uint64_t(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    SIMD::Level detectLevel()
+    {
+#if defined(COREMATH_CPUID)
+        uint32_t registers[4];
+        getCpuid(0, 0, registers);
+        const uint32_t maxLeaf = registers[0];
+
+        getCpuid(1, 0, registers);
+        const bool hasSSE2 = (registers[3] & (1u << 26)) != 0;
+        const bool hasOSXSave = (registers[2] & (1u << 27)) != 0;
+        const bool hasAVX = (registers[2] & (1u << 28)) != 0;
+        if (!hasSSE2)
+            return SIMD::Level::Scalar;
+
+        // the os must save the wider registers too: xmm & ymm for avx, plus opmask & zmm for avx-512
+        const uint64_t registerState = hasOSXSave ? getEnabledRegisterState() : 0;
+        if (!hasAVX || (registerState & 0x6) != 0x6)
+            return SIMD::Level::SSE2;
+
+        bool hasAVX512 = false;
+        if (maxLeaf >= 7)
+        {
+            getCpuid(7, 0, registers);
+            hasAVX512 = (registers[1] & (1u << 16)) != 0;
+        }
+        if (!hasAVX512 || (registerState & 0xe6) != 0xe6)
+            return SIMD::Level::AVX;
+        return SIMD::Level::AVX512;
+#else
+        return SIMD::Level::Scalar;
+#endif
+    }
+
+    const SIMD::Level Levels[] = {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512};
+
+    // COREMATH_SIMD_LEVEL from the environment, the supported level if unset or unknown
+    SIMD::Level getEnvironmentLevel(SIMD::Level supportedLevel)
+    {
+        char* pValue = nullptr;
+#if defined(_MSC_VER)
+        size_t length = 0;
+        if (_dupenv_s(&pValue, &length, "COREMATH_SIMD_LEVEL") != 0)
+            pValue = nullptr;
+#else
+        pValue = std::getenv("COREMATH_SIMD_LEVEL");
+#endif
+        SIMD::Level level = supportedLevel;
+        for (SIMD::Level candidate : Levels)
+        {
+            if (pValue && std::strcmp(pValue, SIMD::getLevelName(candidate)) == 0)
+                level = std::min(candidate, supportedLevel);
+        }
+#if defined(_MSC_VER)
+        free(pValue);
+#endif
+        return level;
+    }
+
+    // the level in use, starts out as the environment's or supported one
+    std::atomic<SIMD::Level>& getLevelState()
+    {
+        static std::atomic<SIMD::Level> level(getEnvironmentLevel(SIMD::getSupportedLevel()));
+        return level;
+    }
+} // namespace
+
+namespace SIMD
+{
+    Level getSupportedLevel()
+    {
+        static const Level supportedLevel = detectLevel();
+        return supportedLevel;
+    }
+
+    Level getLevel()
+    {
+        return getLevelState().load(std::memory_order_relaxed);
+    }
+
+    void forceLevel(Level level)
+    {
+        getLevelState().store(std::min(level, getSupportedLevel()), std::memory_order_relaxed);
+    }
+
+    void resetLevel()
+    {
+        getLevelState().store(getSupportedLevel(), std::memory_order_relaxed);
+    }
+
+    const char* getLevelName(Level level)
+    {
+        switch (level)
+        {
+            case Level::SSE2:
+                return "sse2";
+            case Level::AVX:
+                return "avx";
+            case Level::AVX512:
+                return "avx512";
+            default:
+                return "scalar";
+        }
+    }
+} // namespace SIMD
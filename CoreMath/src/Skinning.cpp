@@ -0,0 +1,141 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "Skinning.h"
+#include "SIMD.h"
+
+namespace
+{
+    const int MaxInfluences = skin_influences::MaxInfluences;
+
+#if defined(COREMATH_SSE2)
+    // vertices index arbitrary bones, so each vertex is one register pass: its bones' rows (or dual quaternion parts)
+    // are weighted & summed lane-wise, then applied to the point. vectorizing across vertices instead would gather
+    // every palette value lane by lane (AVX2 gathers only load 32bit values, one per lane).
+
+    // sum of the lanes in every lane
+    __m128 sumLanes(__m128 a)
+    {
+        const __m128 pairs = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    // x, y & z lanes, w is left as garbage
+    __m128 cross(__m128 a, __m128 b)
+    {
+        const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+        const __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+        return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+    }
+
+    void storePoint(__m128 point, uint32_t i, float* const* outPoints)
+    {
+        outPoints[0][i] = _mm_cvtss_f32(point);
+        outPoints[1][i] = _mm_cvtss_f32(_mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1)));
+        outPoints[2][i] = _mm_cvtss_f32(_mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+
+    // same multiplies & adds as the scalar loop: rows blended slot after slot, then t_mat4 * t_vec3
+    void skinLinearSSE(const t_mat4<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints)
+    {
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const t_mat4<float>& first = palette[boneIndices[0][i]];
+            const __m128 firstWeight = _mm_set1_ps(weights[0][i]);
+            __m128 row0 = _mm_mul_ps(firstWeight, _mm_loadu_ps(first.data[0]));
+            __m128 row1 = _mm_mul_ps(firstWeight, _mm_loadu_ps(first.data[1]));
+            __m128 row2 = _mm_mul_ps(firstWeight, _mm_loadu_ps(first.data[2]));
+            for (int slot = 1; slot != MaxInfluences; ++slot)
+            {
+                const t_mat4<float>& bone = palette[boneIndices[slot][i]];
+                const __m128 weight = _mm_set1_ps(weights[slot][i]);
+                row0 = _mm_add_ps(row0, _mm_mul_ps(weight, _mm_loadu_ps(bone.data[0])));
+                row1 = _mm_add_ps(row1, _mm_mul_ps(weight, _mm_loadu_ps(bone.data[1])));
+                row2 = _mm_add_ps(row2, _mm_mul_ps(weight, _mm_loadu_ps(bone.data[2])));
+            }
+
+            // products transposed into columns, summed as (x + y) + z + translation
+            const __m128 point = _mm_setr_ps(points[0][i], points[1][i], points[2][i], 1.f);
+            __m128 xTerms = _mm_mul_ps(row0, point);
+            __m128 yTerms = _mm_mul_ps(row1, point);
+            __m128 zTerms = _mm_mul_ps(row2, point);
+            __m128 unused = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(xTerms, yTerms, zTerms, unused);
+            storePoint(_mm_add_ps(_mm_add_ps(_mm_add_ps(xTerms, yTerms), zTerms), unused), i, outPoints);
+        }
+    }
+
+    // blends real & dual parts, renormalizes, then with r & d the blended parts in x, y, z, w lanes:
+    // c = cross(r, p) + r.w * p + d, point = p + 2 * (cross(r, c) + r.w * d - d.w * r)
+    void skinDualQuatSSE(const t_dual_quat<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints)
+    {
+        const __m128 signBit = _mm_set1_ps(-0.f);
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            // w, x, y, z lanes
+            const __m128 firstReal = _mm_loadu_ps(&palette[boneIndices[0][i]].real.w);
+            __m128 real = _mm_setzero_ps();
+            __m128 dual = _mm_setzero_ps();
+            for (int slot = 0; slot != MaxInfluences; ++slot)
+            {
+                const t_dual_quat<float>& bone = palette[boneIndices[slot][i]];
+                const __m128 boneReal = _mm_loadu_ps(&bone.real.w);
+                // negated when on the other hemisphere from the first bone
+                const __m128 hemisphere = _mm_and_ps(_mm_cmplt_ps(sumLanes(_mm_mul_ps(firstReal, boneReal)), _mm_setzero_ps()), signBit);
+                const __m128 weight = _mm_xor_ps(_mm_set1_ps(weights[slot][i]), hemisphere);
+                real = _mm_add_ps(real, _mm_mul_ps(weight, boneReal));
+                dual = _mm_add_ps(dual, _mm_mul_ps(weight, _mm_loadu_ps(&bone.dual.w)));
+            }
+            const __m128 point = _mm_setr_ps(points[0][i], points[1][i], points[2][i], 0.f);
+            const __m128 length = _mm_sqrt_ps(sumLanes(_mm_mul_ps(real, real)));
+            // no weights, left in place as in the scalar path
+            if (_mm_cvtss_f32(length) == 0.f)
+            {
+                storePoint(point, i, outPoints);
+                continue;
+            }
+            real = _mm_div_ps(real, length);
+            dual = _mm_div_ps(dual, length);
+
+            const __m128 r = _mm_shuffle_ps(real, real, _MM_SHUFFLE(0, 3, 2, 1));
+            const __m128 d = _mm_shuffle_ps(dual, dual, _MM_SHUFFLE(0, 3, 2, 1));
+            const __m128 rW = _mm_shuffle_ps(real, real, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 dW = _mm_shuffle_ps(dual, dual, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 c = _mm_add_ps(_mm_add_ps(cross(r, point), _mm_mul_ps(rW, point)), d);
+            const __m128 offset = _mm_sub_ps(_mm_add_ps(cross(r, c), _mm_mul_ps(rW, d)), _mm_mul_ps(dW, r));
+            storePoint(_mm_add_ps(point, _mm_add_ps(offset, offset)), i, outPoints);
+        }
+    }
+#endif
+} // namespace
+
+namespace Skinning
+{
+    template <>
+    void skinLinear<float>(const t_mat4<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints)
+    {
+#if defined(COREMATH_SSE2)
+        if (SIMD::getLevel() >= SIMD::Level::SSE2)
+        {
+            skinLinearSSE(palette, boneIndices, weights, points, count, outPoints);
+            return;
+        }
+#endif
+        skinLinearLoop(palette, boneIndices, weights, points, count, outPoints);
+    }
+
+    template <>
+    void skinDualQuat<float>(const t_dual_quat<float>* palette, const uint32_t* const* boneIndices, const float* const* weights, const float* const* points, uint32_t count, float* const* outPoints)
+    {
+#if defined(COREMATH_SSE2)
+        if (SIMD::getLevel() >= SIMD::Level::SSE2)
+        {
+            skinDualQuatSSE(palette, boneIndices, weights, points, count, outPoints);
+            return;
+        }
+#endif
+        skinDualQuatLoop(palette, boneIndices, weights, points, count, outPoints);
+    }
+} // namespace Skinning
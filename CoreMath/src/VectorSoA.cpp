@@ -0,0 +1,239 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "VectorSoA.h"
+#include "SIMD.h"
+#include "VectorSoAKernels.h"
+#include <cmath>
+
+namespace
+{
+    // one register of float lanes & the operations the kernels need
+    // every kernel is written once against this interface & instantiated per register width, scalar included,
+    // so the vector & remainder paths perform the same operations in the same order
+    struct ScalarLanes
+    {
+        typedef float tReg;
+        static const uint32_t Width = 1;
+        static tReg load(const float* p)
+        {
+            return *p;
+        }
+        static void store(float* p, tReg a)
+        {
+            *p = a;
+        }
+        static tReg set(float a)
+        {
+            return a;
+        }
+        static tReg add(tReg a, tReg b)
+        {
+            return a + b;
+        }
+        static tReg sub(tReg a, tReg b)
+        {
+            return a - b;
+        }
+        static tReg mul(tReg a, tReg b)
+        {
+            return a * b;
+        }
+        static tReg div(tReg a, tReg b)
+        {
+            return a / b;
+        }
+        static tReg sqrt(tReg a)
+        {
+            return std::sqrt(a);
+        }
+        static void load3(const float* p, tReg* outXYZ)
+        {
+            outXYZ[0] = p[0];
+            outXYZ[1] = p[1];
+            outXYZ[2] = p[2];
+        }
+        static void store3(float* p, const tReg* xyz)
+        {
+            p[0] = xyz[0];
+            p[1] = xyz[1];
+            p[2] = xyz[2];
+        }
+    };
+
+    const VectorSoA::KernelTable ScalarKernels = COREMATH_VECTORSOA_KERNELS(ScalarLanes);
+
+#if defined(COREMATH_SSE2)
+    struct SSELanes
+    {
+        typedef __m128 tReg;
+        static const uint32_t Width = 4;
+        static tReg load(const float* p)
+        {
+            return _mm_loadu_ps(p);
+        }
+        static void store(float* p, tReg a)
+        {
+            _mm_storeu_ps(p, a);
+        }
+        static tReg set(float a)
+        {
+            return _mm_set1_ps(a);
+        }
+        static tReg add(tReg a, tReg b)
+        {
+            return _mm_add_ps(a, b);
+        }
+        static tReg sub(tReg a, tReg b)
+        {
+            return _mm_sub_ps(a, b);
+        }
+        static tReg mul(tReg a, tReg b)
+        {
+            return _mm_mul_ps(a, b);
+        }
+        static tReg div(tReg a, tReg b)
+        {
+            return _mm_div_ps(a, b);
+        }
+        static tReg sqrt(tReg a)
+        {
+            return _mm_sqrt_ps(a);
+        }
+        static tReg loadQuads(const float* p)
+        {
+            return _mm_loadu_ps(p);
+        }
+        static void storeQuads(float* p, tReg a)
+        {
+            _mm_storeu_ps(p, a);
+        }
+        template <int MASK>
+        static tReg shuffle(tReg a, tReg b)
+        {
+            return _mm_shuffle_ps(a, b, MASK);
+        }
+        static void load3(const float* p, tReg* outXYZ)
+        {
+            deinterleave3<SSELanes>(p, outXYZ);
+        }
+        static void store3(float* p, const tReg* xyz)
+        {
+            interleave3<SSELanes>(p, xyz);
+        }
+    };
+
+    const VectorSoA::KernelTable SSEKernels = COREMATH_VECTORSOA_KERNELS(SSELanes);
+#endif
+
+    // runs one kernel of the tables over [0, count): the widest registers the dispatch level allows first,
+    // narrower ones & scalars for the remainder. call(kernel, i) returns where the kernel stopped
+    template <class KERNEL, class CALL>
+    void runKernel(KERNEL VectorSoA::KernelTable::*pKernel, const CALL& call)
+    {
+        const SIMD::Level level = SIMD::getLevel();
+        uint32_t i = 0;
+        if (level >= SIMD::Level::AVX512 && VectorSoA::pAVX512Kernels)
+            i = call(VectorSoA::pAVX512Kernels->*pKernel, i);
+        if (level >= SIMD::Level::AVX && VectorSoA::pAVXKernels)
+            i = call(VectorSoA::pAVXKernels->*pKernel, i);
+#if defined(COREMATH_SSE2)
+        if (level >= SIMD::Level::SSE2)
+            i = call(SSEKernels.*pKernel, i);
+#endif
+        call(ScalarKernels.*pKernel, i);
+    }
+} // namespace
+
+namespace VectorSoA
+{
+    template <>
+    void add<float>(const float* a, const float* b, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::add, [&](auto kernel, uint32_t i) { return kernel(a, b, i, count, out); });
+    }
+
+    template <>
+    void sub<float>(const float* a, const float* b, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::sub, [&](auto kernel, uint32_t i) { return kernel(a, b, i, count, out); });
+    }
+
+    template <>
+    void scale<float>(const float* a, float scale, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::scale, [&](auto kernel, uint32_t i) { return kernel(a, scale, i, count, out); });
+    }
+
+    template <>
+    void lerp<float>(const float* a, const float* b, float t, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::lerp, [&](auto kernel, uint32_t i) { return kernel(a, b, t, i, count, out); });
+    }
+
+    template <>
+    void dot<float, 2>(const float* const* a, const float* const* b, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::dot2, [&](auto kernel, uint32_t i) { return kernel(a, b, i, count, out); });
+    }
+
+    template <>
+    void dot<float, 3>(const float* const* a, const float* const* b, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::dot3, [&](auto kernel, uint32_t i) { return kernel(a, b, i, count, out); });
+    }
+
+    template <>
+    void length<float, 2>(const float* const* a, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::length2, [&](auto kernel, uint32_t i) { return kernel(a, i, count, out); });
+    }
+
+    template <>
+    void length<float, 3>(const float* const* a, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::length3, [&](auto kernel, uint32_t i) { return kernel(a, i, count, out); });
+    }
+
+    template <>
+    void normalize<float, 2>(const float* const* a, uint32_t count, float* const* out)
+    {
+        runKernel(&KernelTable::normalize2, [&](auto kernel, uint32_t i) { return kernel(a, i, count, out); });
+    }
+
+    template <>
+    void normalize<float, 3>(const float* const* a, uint32_t count, float* const* out)
+    {
+        runKernel(&KernelTable::normalize3, [&](auto kernel, uint32_t i) { return kernel(a, i, count, out); });
+    }
+
+    template <>
+    void cross<float>(const float* const* a, const float* const* b, uint32_t count, float* const* out)
+    {
+        runKernel(&KernelTable::cross, [&](auto kernel, uint32_t i) { return kernel(a, b, i, count, out); });
+    }
+
+    template <>
+    void transformPoints<float>(const float* m, const float* const* a, uint32_t count, float* const* out)
+    {
+        runKernel(&KernelTable::transformPoints, [&](auto kernel, uint32_t i) { return kernel(m, a, i, count, out); });
+    }
+
+    template <>
+    void transformVectors<float>(const float* m, const float* const* a, uint32_t count, float* const* out)
+    {
+        runKernel(&KernelTable::transformVectors, [&](auto kernel, uint32_t i) { return kernel(m, a, i, count, out); });
+    }
+
+    template <>
+    void transformInterleavedPoints<float>(const float* m, const float* a, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::transformInterleavedPoints, [&](auto kernel, uint32_t i) { return kernel(m, a, i, count, out); });
+    }
+
+    template <>
+    void transformInterleavedVectors<float>(const float* m, const float* a, uint32_t count, float* out)
+    {
+        runKernel(&KernelTable::transformInterleavedVectors, [&](auto kernel, uint32_t i) { return kernel(m, a, i, count, out); });
+    }
+} // namespace VectorSoA
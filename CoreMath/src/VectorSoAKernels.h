@@ -0,0 +1,248 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "SIMD.h"
+#include <cstdint>
+
+// VectorSoA float kernels, written once against a register interface & compiled per instruction set
+//
+// a register interface L provides tReg, Width, load, store, set, add, sub, mul, div & sqrt, plus load3 & store3
+// for interleaved xyz triples. vector registers get those from deinterleave3 & interleave3 below, through
+// loadQuads, storeQuads & shuffle.
+// kernels process [i, count) in whole registers & return where they stopped, callers finish with narrower registers.
+//
+// everything below has internal linkage on purpose: VectorSoA_AVX.cpp & VectorSoA_AVX512.cpp are compiled for
+// instruction sets the machine may lack, so none of their code may be shared with (& picked by the linker for) other
+// translation units. for the same reason, kernels stay off std & CoreMath inline functions.
+namespace VectorSoA
+{
+    // whole register kernels of one instruction set
+    struct KernelTable
+    {
+        uint32_t (*add)(const float* a, const float* b, uint32_t i, uint32_t count, float* out);
+        uint32_t (*sub)(const float* a, const float* b, uint32_t i, uint32_t count, float* out);
+        uint32_t (*scale)(const float* a, float scale, uint32_t i, uint32_t count, float* out);
+        uint32_t (*lerp)(const float* a, const float* b, float t, uint32_t i, uint32_t count, float* out);
+        uint32_t (*dot2)(const float* const* a, const float* const* b, uint32_t i, uint32_t count, float* out);
+        uint32_t (*dot3)(const float* const* a, const float* const* b, uint32_t i, uint32_t count, float* out);
+        uint32_t (*length2)(const float* const* a, uint32_t i, uint32_t count, float* out);
+        uint32_t (*length3)(const float* const* a, uint32_t i, uint32_t count, float* out);
+        uint32_t (*normalize2)(const float* const* a, uint32_t i, uint32_t count, float* const* out);
+        uint32_t (*normalize3)(const float* const* a, uint32_t i, uint32_t count, float* const* out);
+        uint32_t (*cross)(const float* const* a, const float* const* b, uint32_t i, uint32_t count, float* const* out);
+        uint32_t (*transformPoints)(const float* m, const float* const* a, uint32_t i, uint32_t count, float* const* out);
+        uint32_t (*transformVectors)(const float* m, const float* const* a, uint32_t i, uint32_t count, float* const* out);
+        uint32_t (*transformInterleavedPoints)(const float* m, const float* a, uint32_t i, uint32_t count, float* out);
+        uint32_t (*transformInterleavedVectors)(const float* m, const float* a, uint32_t i, uint32_t count, float* out);
+    };
+
+    // kernels of the wider instruction sets, null when their unit was compiled without its flags
+    extern const KernelTable* const pAVXKernels;
+    extern const KernelTable* const pAVX512Kernels;
+} // namespace VectorSoA
+
+namespace
+{
+    template <class L>
+    uint32_t addLanes(const float* a, const float* b, uint32_t i, uint32_t count, float* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            L::store(out + i, L::add(L::load(a + i), L::load(b + i)));
+        }
+        return i;
+    }
+
+    template <class L>
+    uint32_t subLanes(const float* a, const float* b, uint32_t i, uint32_t count, float* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            L::store(out + i, L::sub(L::load(a + i), L::load(b + i)));
+        }
+        return i;
+    }
+
+    template <class L>
+    uint32_t scaleLanes(const float* a, float scale, uint32_t i, uint32_t count, float* out)
+    {
+        const typename L::tReg scaleReg = L::set(scale);
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            L::store(out + i, L::mul(L::load(a + i), scaleReg));
+        }
+        return i;
+    }
+
+    template <class L>
+    uint32_t lerpLanes(const float* a, const float* b, float t, uint32_t i, uint32_t count, float* out)
+    {
+        const typename L::tReg tReg = L::set(t);
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            const typename L::tReg aReg = L::load(a + i);
+            L::store(out + i, L::add(aReg, L::mul(L::sub(L::load(b + i), aReg), tReg)));
+        }
+        return i;
+    }
+
+    template <class L, int K>
+    typename L::tReg dotReg(const float* const* a, const float* const* b, uint32_t i)
+    {
+        typename L::tReg result = L::mul(L::load(a[0] + i), L::load(b[0] + i));
+        for (int axis = 1; axis != K; ++axis)
+        {
+            result = L::add(result, L::mul(L::load(a[axis] + i), L::load(b[axis] + i)));
+        }
+        return result;
+    }
+
+    template <class L, int K>
+    uint32_t dotLanes(const float* const* a, const float* const* b, uint32_t i, uint32_t count, float* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            L::store(out + i, dotReg<L, K>(a, b, i));
+        }
+        return i;
+    }
+
+    template <class L, int K>
+    uint32_t lengthLanes(const float* const* a, uint32_t i, uint32_t count, float* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            L::store(out + i, L::sqrt(dotReg<L, K>(a, a, i)));
+        }
+        return i;
+    }
+
+    template <class L, int K>
+    uint32_t normalizeLanes(const float* const* a, uint32_t i, uint32_t count, float* const* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            const typename L::tReg length = L::sqrt(dotReg<L, K>(a, a, i));
+            typename L::tReg components[K];
+            for (int axis = 0; axis != K; ++axis)
+            {
+                components[axis] = L::div(L::load(a[axis] + i), length);
+            }
+            for (int axis = 0; axis != K; ++axis)
+            {
+                L::store(out[axis] + i, components[axis]);
+            }
+        }
+        return i;
+    }
+
+    template <class L>
+    uint32_t crossLanes(const float* const* a, const float* const* b, uint32_t i, uint32_t count, float* const* out)
+    {
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            const typename L::tReg ax = L::load(a[0] + i), ay = L::load(a[1] + i), az = L::load(a[2] + i);
+            const typename L::tReg bx = L::load(b[0] + i), by = L::load(b[1] + i), bz = L::load(b[2] + i);
+            L::store(out[0] + i, L::sub(L::mul(ay, bz), L::mul(az, by)));
+            L::store(out[1] + i, L::sub(L::mul(az, bx), L::mul(ax, bz)));
+            L::store(out[2] + i, L::sub(L::mul(ax, by), L::mul(ay, bx)));
+        }
+        return i;
+    }
+
+#if defined(COREMATH_SSE2)
+    // Width xyz triples to one register per component
+    // every 128 bits transpose 4 triples, loadQuads gathers the 4 float groups of consecutive 4 triple runs
+    template <class L>
+    void deinterleave3(const float* p, typename L::tReg* outXYZ)
+    {
+        const typename L::tReg x0y0z0x1 = L::loadQuads(p);
+        const typename L::tReg y1z1x2y2 = L::loadQuads(p + 4);
+        const typename L::tReg z2x3y3z3 = L::loadQuads(p + 8);
+        const typename L::tReg x2y2x3y3 = L::template shuffle<_MM_SHUFFLE(2, 1, 3, 2)>(y1z1x2y2, z2x3y3z3);
+        const typename L::tReg y0z0y1z1 = L::template shuffle<_MM_SHUFFLE(1, 0, 2, 1)>(x0y0z0x1, y1z1x2y2);
+        outXYZ[0] = L::template shuffle<_MM_SHUFFLE(2, 0, 3, 0)>(x0y0z0x1, x2y2x3y3);
+        outXYZ[1] = L::template shuffle<_MM_SHUFFLE(3, 1, 2, 0)>(y0z0y1z1, x2y2x3y3);
+        outXYZ[2] = L::template shuffle<_MM_SHUFFLE(3, 0, 3, 1)>(y0z0y1z1, z2x3y3z3);
+    }
+
+    // the reverse of deinterleave3
+    template <class L>
+    void interleave3(float* p, const typename L::tReg* xyz)
+    {
+        const typename L::tReg x0x2y0y2 = L::template shuffle<_MM_SHUFFLE(2, 0, 2, 0)>(xyz[0], xyz[1]);
+        const typename L::tReg y1y3z1z3 = L::template shuffle<_MM_SHUFFLE(3, 1, 3, 1)>(xyz[1], xyz[2]);
+        const typename L::tReg z0z2x1x3 = L::template shuffle<_MM_SHUFFLE(3, 1, 2, 0)>(xyz[2], xyz[0]);
+        L::storeQuads(p, L::template shuffle<_MM_SHUFFLE(2, 0, 2, 0)>(x0x2y0y2, z0z2x1x3));
+        L::storeQuads(p + 4, L::template shuffle<_MM_SHUFFLE(3, 1, 2, 0)>(y1y3z1z3, x0x2y0y2));
+        L::storeQuads(p + 8, L::template shuffle<_MM_SHUFFLE(3, 1, 3, 1)>(z0z2x1x3, y1y3z1z3));
+    }
+#endif
+
+    // rows of the matrix stay in registers, each output row sums in t_mat4 * t_vec3's order
+    template <class L>
+    void setRows(const float* m, typename L::tReg (*outRows)[4])
+    {
+        for (int row = 0; row != 3; ++row)
+        {
+            for (int column = 0; column != 4; ++column)
+            {
+                outRows[row][column] = L::set(m[4 * row + column]);
+            }
+        }
+    }
+
+    template <class L, bool TRANSLATE>
+    void transformReg(const typename L::tReg (*rows)[4], const typename L::tReg* xyz, typename L::tReg* outXYZ)
+    {
+        for (int row = 0; row != 3; ++row)
+        {
+            outXYZ[row] = L::add(L::add(L::mul(rows[row][0], xyz[0]), L::mul(rows[row][1], xyz[1])), L::mul(rows[row][2], xyz[2]));
+            if (TRANSLATE)
+                outXYZ[row] = L::add(outXYZ[row], rows[row][3]);
+        }
+    }
+
+    template <class L, bool TRANSLATE>
+    uint32_t transformLanes(const float* m, const float* const* a, uint32_t i, uint32_t count, float* const* out)
+    {
+        typename L::tReg rows[3][4];
+        setRows<L>(m, rows);
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            const typename L::tReg xyz[3] = {L::load(a[0] + i), L::load(a[1] + i), L::load(a[2] + i)};
+            typename L::tReg results[3];
+            transformReg<L, TRANSLATE>(rows, xyz, results);
+            for (int row = 0; row != 3; ++row)
+            {
+                L::store(out[row] + i, results[row]);
+            }
+        }
+        return i;
+    }
+
+    // i & count in triples
+    template <class L, bool TRANSLATE>
+    uint32_t transformInterleavedLanes(const float* m, const float* a, uint32_t i, uint32_t count, float* out)
+    {
+        typename L::tReg rows[3][4];
+        setRows<L>(m, rows);
+        for (; i + L::Width <= count; i += L::Width)
+        {
+            typename L::tReg xyz[3];
+            L::load3(a + 3 * i, xyz);
+            typename L::tReg results[3];
+            transformReg<L, TRANSLATE>(rows, xyz, results);
+            L::store3(out + 3 * i, results);
+        }
+        return i;
+    }
+
+// every kernel of register interface L, in KernelTable order. a constant initializer, so building a table runs no code
+#define COREMATH_VECTORSOA_KERNELS(L)                                                                                                                                                                              \
+    {                                                                                                                                                                                                              \
+        &addLanes<L>, &subLanes<L>, &scaleLanes<L>, &lerpLanes<L>, &dotLanes<L, 2>, &dotLanes<L, 3>, &lengthLanes<L, 2>, &lengthLanes<L, 3>, &normalizeLanes<L, 2>, &normalizeLanes<L, 3>, &crossLanes<L>,         \
+        &transformLanes<L, true>, &transformLanes<L, false>, &transformInterleavedLanes<L, true>, &transformInterleavedLanes<L, false>                                                                             \
+    }
+} // namespace
@@ -0,0 +1,79 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+// VectorSoA kernels on 8 float lanes, compile with /arch:AVX or -mavx
+// only reached when cpuid reports AVX, see SIMD.h
+
+#include "SIMD.h"
+#include "VectorSoAKernels.h"
+
+#if defined(COREMATH_AVX)
+namespace
+{
+    struct AVXLanes
+    {
+        typedef __m256 tReg;
+        static const uint32_t Width = 8;
+        static tReg load(const float* p)
+        {
+            return _mm256_loadu_ps(p);
+        }
+        static void store(float* p, tReg a)
+        {
+            _mm256_storeu_ps(p, a);
+        }
+        static tReg set(float a)
+        {
+            return _mm256_set1_ps(a);
+        }
+        static tReg add(tReg a, tReg b)
+        {
+            return _mm256_add_ps(a, b);
+        }
+        static tReg sub(tReg a, tReg b)
+        {
+            return _mm256_sub_ps(a, b);
+        }
+        static tReg mul(tReg a, tReg b)
+        {
+            return _mm256_mul_ps(a, b);
+        }
+        static tReg div(tReg a, tReg b)
+        {
+            return _mm256_div_ps(a, b);
+        }
+        static tReg sqrt(tReg a)
+        {
+            return _mm256_sqrt_ps(a);
+        }
+        static tReg loadQuads(const float* p)
+        {
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+        }
+        static void storeQuads(float* p, tReg a)
+        {
+            _mm_storeu_ps(p, _mm256_castps256_ps128(a));
+            _mm_storeu_ps(p + 12, _mm256_extractf128_ps(a, 1));
+        }
+        template <int MASK>
+        static tReg shuffle(tReg a, tReg b)
+        {
+            return _mm256_shuffle_ps(a, b, MASK);
+        }
+        static void load3(const float* p, tReg* outXYZ)
+        {
+            deinterleave3<AVXLanes>(p, outXYZ);
+        }
+        static void store3(float* p, const tReg* xyz)
+        {
+            interleave3<AVXLanes>(p, xyz);
+        }
+    };
+
+    const VectorSoA::KernelTable AVXKernels = COREMATH_VECTORSOA_KERNELS(AVXLanes);
+} // namespace
+
+const VectorSoA::KernelTable* const VectorSoA::pAVXKernels = &AVXKernels;
+#else
+const VectorSoA::KernelTable* const VectorSoA::pAVXKernels = nullptr;
+#endif
@@ -0,0 +1,81 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+// VectorSoA kernels on 16 float lanes, compile with /arch:AVX512 or -mavx512f
+// only reached when cpuid reports AVX-512, see SIMD.h
+
+#include "SIMD.h"
+#include "VectorSoAKernels.h"
+
+#if defined(COREMATH_AVX512)
+namespace
+{
+    struct AVX512Lanes
+    {
+        typedef __m512 tReg;
+        static const uint32_t Width = 16;
+        static tReg load(const float* p)
+        {
+            return _mm512_loadu_ps(p);
+        }
+        static void store(float* p, tReg a)
+        {
+            _mm512_storeu_ps(p, a);
+        }
+        static tReg set(float a)
+        {
+            return _mm512_set1_ps(a);
+        }
+        static tReg add(tReg a, tReg b)
+        {
+            return _mm512_add_ps(a, b);
+        }
+        static tReg sub(tReg a, tReg b)
+        {
+            return _mm512_sub_ps(a, b);
+        }
+        static tReg mul(tReg a, tReg b)
+        {
+            return _mm512_mul_ps(a, b);
+        }
+        static tReg div(tReg a, tReg b)
+        {
+            return _mm512_div_ps(a, b);
+        }
+        static tReg sqrt(tReg a)
+        {
+            return _mm512_sqrt_ps(a);
+        }
+        static tReg loadQuads(const float* p)
+        {
+            return _mm512_insertf32x4(_mm512_insertf32x4(_mm512_insertf32x4(_mm512_castps128_ps512(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1), _mm_loadu_ps(p + 24), 2), _mm_loadu_ps(p + 36), 3);
+        }
+        static void storeQuads(float* p, tReg a)
+        {
+            _mm_storeu_ps(p, _mm512_castps512_ps128(a));
+            _mm_storeu_ps(p + 12, _mm512_extractf32x4_ps(a, 1));
+            _mm_storeu_ps(p + 24, _mm512_extractf32x4_ps(a, 2));
+            _mm_storeu_ps(p + 36, _mm512_extractf32x4_ps(a, 3));
+        }
+        template <int MASK>
+        static tReg shuffle(tReg a, tReg b)
+        {
+            return _mm512_shuffle_ps(a, b, MASK);
+        }
+        static void load3(const float* p, tReg* outXYZ)
+        {
+            deinterleave3<AVX512Lanes>(p, outXYZ);
+        }
+        static void store3(float* p, const tReg* xyz)
+        {
+            interleave3<AVX512Lanes>(p, xyz);
+        }
+    };
+
+    const VectorSoA::KernelTable AVX512Kernels = COREMATH_VECTORSOA_KERNELS(AVX512Lanes);
+} // namespace
+
+const VectorSoA::KernelTable* const VectorSoA::pAVX512Kernels = &AVX512Kernels;
+#else
+const VectorSoA::KernelTable* const VectorSoA::pAVX512Kernels = nullptr;
+#endif
@@ -0,0 +1,147 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BenchmarkHelpers.h"
+#include "BVH.h"
+#include "Random.h"
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // small boxes scattered through a cube, about as many as fit side by side
+    std::vector<aabb> makeScene(int numObjects)
+    {
+        std::vector<aabb> boxes;
+        boxes.reserve(numObjects);
+        for (int i = 0; i != numObjects; ++i)
+        {
+            const vec3 center(randRange(0.f, 100.f), randRange(0.f, 100.f), randRange(0.f, 100.f));
+            const vec3 extent(randRange(0.2f, 1.f), randRange(0.2f, 1.f), randRange(0.2f, 1.f));
+            boxes.push_back(aabb(center - extent, center + extent));
+        }
+        return boxes;
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (BVHBenchmarks)
+    {
+      public:
+        TEST_METHOD (BroadphaseTime)
+        {
+            constexpr int numObjects = 100000;
+            constexpr int numTicks = 8;
+            std::vector<aabb> boxes = makeScene(numObjects);
+            std::vector<vec3> velocities(numObjects);
+            for (vec3& velocity : velocities)
+            {
+                velocity = vec3(randRange(-0.5f, 0.5f), randRange(-0.5f, 0.5f), randRange(-0.5f, 0.5f));
+            }
+
+            tClock::time_point start = tClock::now();
+            bvh hierarchy(boxes);
+            const double buildMs = getElapsedMs(start);
+            const float builtCost = hierarchy.getSAHCost();
+
+            // objects drift each tick, the refit tree loosens while a rebuild stays tight
+            double refitMs = 0.0;
+            double rebuildMs = 0.0;
+            double refitPairsMs = 0.0;
+            double rebuildPairsMs = 0.0;
+            size_t numPairs = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> pairs;
+            for (int tick = 0; tick != numTicks; ++tick)
+            {
+                for (int i = 0; i != numObjects; ++i)
+                {
+                    boxes[i] = aabb(boxes[i].min + velocities[i], boxes[i].max + velocities[i]);
+                }
+
+                start = tClock::now();
+                hierarchy.refit(boxes);
+                refitMs += getElapsedMs(start);
+                start = tClock::now();
+                hierarchy.findOverlappingPairs(pairs);
+                refitPairsMs += getElapsedMs(start);
+                numPairs += pairs.size();
+
+                start = tClock::now();
+                const bvh rebuiltHierarchy(boxes);
+                rebuildMs += getElapsedMs(start);
+                start = tClock::now();
+                rebuiltHierarchy.findOverlappingPairs(pairs);
+                rebuildPairsMs += getElapsedMs(start);
+            }
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Objects: " << numObjects << ", overlapping pairs per tick: " << numPairs / numTicks << "\n"
+                         << "Build: " << buildMs << " ms, SAH cost " << builtCost << "\n"
+                         << "Refit: " << refitMs / numTicks << " ms/tick, pairs " << refitPairsMs / numTicks << " ms/tick, SAH cost after " << numTicks << " ticks " << hierarchy.getSAHCost() << "\n"
+                         << "Rebuild: " << rebuildMs / numTicks << " ms/tick, pairs " << rebuildPairsMs / numTicks << " ms/tick\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (RayNearestQueryTime)
+        {
+            constexpr int numObjects = 100000;
+            constexpr int numQueries = 1 << 14;
+            // brute force on a subset, it's slow
+            constexpr int numNaiveQueries = 1 << 8;
+            const std::vector<aabb> boxes = makeScene(numObjects);
+            const bvh hierarchy(boxes);
+
+            std::vector<vec3> origins(numQueries);
+            std::vector<vec3> directions(numQueries);
+            for (int i = 0; i != numQueries; ++i)
+            {
+                origins[i] = vec3(randRange(0.f, 100.f), randRange(0.f, 100.f), randRange(0.f, 100.f));
+                directions[i] = randomPointOnUnitSphere();
+            }
+
+            bvh::RayHit hit;
+            uint32_t numHits = 0;
+            tClock::time_point start = tClock::now();
+            for (int i = 0; i != numQueries; ++i)
+            {
+                numHits += hierarchy.findFirstRayHit(origins[i], directions[i], 50.f, hit) ? 1 : 0;
+            }
+            const double rayMs = getElapsedMs(start);
+
+            start = tClock::now();
+            for (int i = 0; i != numQueries; ++i)
+            {
+                hierarchy.findNearestPrimitive(origins[i]);
+            }
+            const double nearestMs = getElapsedMs(start);
+
+            // naive nearest by box distance
+            start = tClock::now();
+            float checksum = 0.f;
+            for (int i = 0; i != numNaiveQueries; ++i)
+            {
+                float nearestDistanceSqr = FLT_MAX;
+                for (const aabb& box : boxes)
+                {
+                    nearestDistanceSqr = std::min(nearestDistanceSqr, box.getDistanceSqr(origins[i]));
+                }
+                checksum += nearestDistanceSqr;
+            }
+            const double naiveNearestMs = getElapsedMs(start) * (numQueries / numNaiveQueries);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Objects: " << numObjects << ", queries: " << numQueries << ", rays hitting: " << numHits << "\n"
+                         << "First ray hits: " << rayMs << " ms\n"
+                         << "Nearest objects: " << nearestMs << " ms\n"
+                         << "Naive nearest objects (extrapolated): " << naiveNearestMs << " ms (" << checksum << ")\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,287 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BVH.h"
+#include "Matrix4.h"
+#include "Random.h"
+#include <algorithm>
+#include <limits>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    std::vector<aabb> makeBoxes(int numBoxes)
+    {
+        std::vector<aabb> boxes;
+        boxes.reserve(numBoxes);
+        for (int i = 0; i != numBoxes; ++i)
+        {
+            const vec3 center(rand01(), rand01(), rand01());
+            const vec3 extent(randRange(0.001f, 0.02f), randRange(0.001f, 0.02f), randRange(0.001f, 0.02f));
+            boxes.push_back(aabb(center - extent, center + extent));
+        }
+        return boxes;
+    }
+
+    std::vector<sphere> makeSpheres(int numSpheres)
+    {
+        std::vector<sphere> spheres;
+        spheres.reserve(numSpheres);
+        for (int i = 0; i != numSpheres; ++i)
+        {
+            spheres.push_back(sphere(vec3(rand01(), rand01(), rand01()), randRange(0.001f, 0.02f)));
+        }
+        return spheres;
+    }
+
+    // naive slab test, entry distance along a unit direction
+    bool intersectRayNaive(const vec3& origin, const vec3& direction, const aabb& box, float& outDistance)
+    {
+        float entry = 0.f;
+        float exit = FLT_MAX;
+        const float origins[3] = {origin.x, origin.y, origin.z};
+        const float directions[3] = {direction.x, direction.y, direction.z};
+        const float mins[3] = {box.min.x, box.min.y, box.min.z};
+        const float maxs[3] = {box.max.x, box.max.y, box.max.z};
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            const float a = (mins[axis] - origins[axis]) / directions[axis];
+            const float b = (maxs[axis] - origins[axis]) / directions[axis];
+            entry = std::max(entry, std::min(a, b));
+            exit = std::min(exit, std::max(a, b));
+        }
+        outDistance = entry;
+        return entry <= exit;
+    }
+
+    bool intersectRayNaive(const vec3& origin, const vec3& direction, const sphere& s, float& outDistance)
+    {
+        // march the closest approach back by the chord half length
+        const vec3 offset = s.center - origin;
+        const float along = offset.dot(direction);
+        const float closestDistanceSqr = (offset - direction * along).getLengthSquared();
+        const float radiusSqr = s.radius * s.radius;
+        if (offset.getLengthSquared() <= radiusSqr)
+        {
+            outDistance = 0.f;
+            return true;
+        }
+        if (along < 0.f || closestDistanceSqr > radiusSqr)
+            return false;
+        outDistance = along - std::sqrt(radiusSqr - closestDistanceSqr);
+        return true;
+    }
+
+    // checks box, sphere, ray & nearest queries against brute force
+    template <class PRIMITIVE>
+    void checkQueries(const bvh& hierarchy, const std::vector<PRIMITIVE>& primitives)
+    {
+        constexpr int testRounds = 128;
+        std::vector<uint32_t> bvhResults;
+        for (int i = 0; i != testRounds; ++i)
+        {
+            const vec3 center(rand01(), rand01(), rand01());
+            const vec3 extent(randRange(0.f, 0.1f), randRange(0.f, 0.1f), randRange(0.f, 0.1f));
+            const aabb queryBox(center - extent, center + extent);
+            const sphere querySphere(center, randRange(0.f, 0.1f));
+
+            std::vector<uint32_t> naiveBoxResults;
+            std::vector<uint32_t> naiveSphereResults;
+            for (uint32_t j = 0; j != primitives.size(); ++j)
+            {
+                if (primitives[j].overlaps(queryBox))
+                    naiveBoxResults.push_back(j);
+                if (querySphere.overlaps(primitives[j]))
+                    naiveSphereResults.push_back(j);
+            }
+
+            hierarchy.findOverlaps(queryBox, bvhResults);
+            std::sort(bvhResults.begin(), bvhResults.end());
+            Assert::IsTrue(naiveBoxResults == bvhResults);
+            hierarchy.findOverlaps(querySphere, bvhResults);
+            std::sort(bvhResults.begin(), bvhResults.end());
+            Assert::IsTrue(naiveSphereResults == bvhResults);
+
+            // rays from outside the unit cube through it
+            const vec3 origin = center + randomPointOnUnitSphere() * 2.f;
+            const vec3 direction = (center - origin).getUnit();
+            float naiveDistance = FLT_MAX;
+            std::vector<float> naiveDistances;
+            for (const PRIMITIVE& primitive : primitives)
+            {
+                float distance;
+                if (intersectRayNaive(origin, direction, primitive, distance) && distance <= 3.f)
+                {
+                    naiveDistance = std::min(naiveDistance, distance);
+                    naiveDistances.push_back(distance);
+                }
+            }
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Round: " << i << "\n"
+                         << "Origin: " << origin;
+            bvh::RayHit hit;
+            const bool isHit = hierarchy.findFirstRayHit(origin, direction * 5.f, 3.f, hit);
+            Assert::AreEqual(naiveDistance != FLT_MAX, isHit, outputStream.str().c_str());
+            if (isHit)
+                Assert::IsTrue(MathHelpers::isNearlyEqual(naiveDistance, hit.distance), outputStream.str().c_str());
+
+            std::vector<bvh::RayHit> hits;
+            hierarchy.findRayHits(origin, direction, 3.f, hits);
+            std::sort(naiveDistances.begin(), naiveDistances.end());
+            Assert::AreEqual(naiveDistances.size(), hits.size(), outputStream.str().c_str());
+            for (size_t j = 0; j != hits.size(); ++j)
+            {
+                Assert::IsTrue(MathHelpers::isNearlyEqual(naiveDistances[j], hits[j].distance), outputStream.str().c_str());
+            }
+
+            // nearest from anywhere around the cube
+            const vec3 queryPoint(randRange(-0.5f, 1.5f), randRange(-0.5f, 1.5f), randRange(-0.5f, 1.5f));
+            float naiveDistanceSqr = FLT_MAX;
+            for (const PRIMITIVE& primitive : primitives)
+            {
+                naiveDistanceSqr = std::min(naiveDistanceSqr, primitive.getDistanceSqr(queryPoint));
+            }
+            float bvhDistanceSqr;
+            const uint32_t nearest = hierarchy.findNearestPrimitive(queryPoint, &bvhDistanceSqr);
+            Assert::AreEqual(naiveDistanceSqr, bvhDistanceSqr);
+            Assert::AreEqual(naiveDistanceSqr, primitives[nearest].getDistanceSqr(queryPoint));
+        }
+
+        // all overlapping pairs
+        std::vector<std::pair<uint32_t, uint32_t>> naivePairs;
+        for (uint32_t a = 0; a != primitives.size(); ++a)
+        {
+            for (uint32_t b = a + 1; b != primitives.size(); ++b)
+            {
+                if (primitives[a].overlaps(primitives[b]))
+                    naivePairs.push_back({a, b});
+            }
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> bvhPairs;
+        hierarchy.findOverlappingPairs(bvhPairs);
+        std::sort(bvhPairs.begin(), bvhPairs.end());
+        Assert::IsTrue(naivePairs == bvhPairs);
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (BVHTests)
+    {
+      public:
+        TEST_METHOD (BoxQueries)
+        {
+            const std::vector<aabb> boxes = makeBoxes(2048);
+            const bvh hierarchy(boxes);
+            Assert::AreEqual(uint32_t(2048), hierarchy.getNumPrimitives());
+            checkQueries(hierarchy, boxes);
+
+            // every build setting gives the same answers
+            bvh::BuildSettings settings;
+            settings.maxLeafSize = 1;
+            settings.numBins = 2;
+            checkQueries(bvh(boxes, settings), boxes);
+            settings.maxLeafSize = 100;
+            settings.numBins = 100;
+            checkQueries(bvh(boxes, settings), boxes);
+        }
+
+        TEST_METHOD (SphereQueries)
+        {
+            const std::vector<sphere> spheres = makeSpheres(2048);
+            const bvh hierarchy(spheres);
+            checkQueries(hierarchy, spheres);
+        }
+
+        TEST_METHOD (Refit)
+        {
+            // animate the primitives, the refit tree still answers exactly, only slower
+            std::vector<aabb> boxes = makeBoxes(2048);
+            bvh hierarchy(boxes);
+            const float builtCost = hierarchy.getSAHCost();
+            for (aabb& box : boxes)
+            {
+                const vec3 offset(randRange(-0.2f, 0.2f), randRange(-0.2f, 0.2f), randRange(-0.2f, 0.2f));
+                box = aabb(box.min + offset, box.max + offset);
+            }
+            hierarchy.refit(boxes);
+            checkQueries(hierarchy, boxes);
+            Assert::IsTrue(hierarchy.getSAHCost() > builtCost);
+            Assert::IsTrue(bvh(boxes).getSAHCost() < hierarchy.getSAHCost());
+
+            std::vector<sphere> spheres = makeSpheres(1024);
+            bvh sphereHierarchy(spheres);
+            for (sphere& s : spheres)
+            {
+                s.center += vec3(randRange(-0.2f, 0.2f), randRange(-0.2f, 0.2f), randRange(-0.2f, 0.2f));
+            }
+            sphereHierarchy.refit(spheres);
+            checkQueries(sphereHierarchy, spheres);
+        }
+
+        TEST_METHOD (DegenerateInputs)
+        {
+            // empty
+            const bvh emptyHierarchy(std::vector<aabb>{});
+            bvh::RayHit hit;
+            std::vector<uint32_t> results;
+            Assert::AreEqual(bvh::InvalidIndex, emptyHierarchy.findNearestPrimitive(vec3(0.f)));
+            Assert::IsFalse(emptyHierarchy.findFirstRayHit(vec3(0.f), vec3(1.f, 0.f, 0.f), 10.f, hit));
+            emptyHierarchy.findOverlaps(aabb(vec3(-1.f), vec3(1.f)), results);
+            Assert::IsTrue(results.empty());
+
+            // coincident boxes can't be split by cost, still every one is found
+            const std::vector<aabb> stacked(1000, aabb(vec3(0.f), vec3(1.f)));
+            const bvh stackedHierarchy(stacked);
+            stackedHierarchy.findOverlaps(aabb(vec3(0.5f), vec3(0.5f)), results);
+            Assert::AreEqual(size_t(1000), results.size());
+            Assert::IsTrue(stackedHierarchy.findFirstRayHit(vec3(-1.f, 0.5f, 0.5f), vec3(1.f, 0.f, 0.f), 10.f, hit));
+            Assert::IsTrue(MathHelpers::isNearlyEqual(1.f, hit.distance));
+
+            // no primitive is nearest to a NaN point
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            float distanceSqr = -1.f;
+            Assert::AreEqual(bvh::InvalidIndex, stackedHierarchy.findNearestPrimitive(vec3(nan, 0.f, 0.f), &distanceSqr));
+            Assert::AreEqual(-1.f, distanceSqr);
+
+            // axis parallel rays & rays starting inside
+            const std::vector<aabb> boxes = {aabb(vec3(0.f), vec3(1.f)), aabb(vec3(2.f, 0.f, 0.f), vec3(3.f, 1.f, 1.f))};
+            const bvh hierarchy(boxes);
+            Assert::IsTrue(hierarchy.findFirstRayHit(vec3(0.5f), vec3(1.f, 0.f, 0.f), 10.f, hit));
+            Assert::IsTrue(hit.index == 0 && hit.distance == 0.f);
+            Assert::IsTrue(hierarchy.findFirstRayHit(vec3(1.5f, 0.5f, 0.5f), vec3(1.f, 0.f, 0.f), 10.f, hit));
+            Assert::IsTrue(hit.index == 1 && MathHelpers::isNearlyEqual(0.5f, hit.distance));
+            Assert::IsFalse(hierarchy.findFirstRayHit(vec3(1.5f, 0.5f, 0.5f), vec3(1.f, 0.f, 0.f), 0.25f, hit));
+            Assert::IsFalse(hierarchy.findFirstRayHit(vec3(1.5f, 0.5f, 0.5f), vec3(0.f), 10.f, hit));
+        }
+
+        TEST_METHOD (TransformedBounds)
+        {
+            // transformed boxes & spheres still hold their transformed points
+            for (int i = 0; i != 64; ++i)
+            {
+                const transform t(vec3(randRange(-5.f, 5.f), randRange(-5.f, 5.f), randRange(-5.f, 5.f)), randomRotation(), vec3(randRange(0.1f, 3.f), randRange(0.1f, 3.f), randRange(0.1f, 3.f)));
+                const mat4 m(t);
+                const aabb box(vec3(-1.f, -2.f, -0.5f), vec3(1.f, 0.5f, 2.f));
+                const aabb worldBox = box.getTransformed(m);
+                const sphere s(vec3(0.5f, -1.f, 0.f), 0.75f);
+                const sphere worldSphere = s.getTransformed(m);
+                for (int j = 0; j != 64; ++j)
+                {
+                    const vec3 boxPoint(randRange(box.min.x, box.max.x), randRange(box.min.y, box.max.y), randRange(box.min.z, box.max.z));
+                    Assert::IsTrue(worldBox.getDistanceSqr(m * boxPoint) < 0.0001f);
+
+                    const vec3 spherePoint = s.center + randomPointOnUnitSphere() * randRange(0.f, s.radius);
+                    Assert::IsTrue(worldSphere.getDistanceSqr(m * spherePoint) < 0.0001f);
+                }
+            }
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,36 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include "Random.h"
+#include "Vector3.h"
+#include <cstdint>
+#include <vector>
+
+// inputs shared by the batch transform & skinning tests
+
+// counts around the register sizes
+constexpr uint32_t BatchTestCounts[] = {0u, 1u, 7u, 16u, 37u, 300u};
+
+// several parallel blocks & a partial one
+inline uint32_t getParallelTestCount(uint32_t blockSize)
+{
+    return 3 * blockSize + 77;
+}
+
+// points within 10
+inline std::vector<vec3> randomPoints(uint32_t count)
+{
+    std::vector<vec3> points(count);
+    for (vec3& point : points)
+    {
+        point = vec3(randRange(-10.f, 10.f), randRange(-10.f, 10.f), randRange(-10.f, 10.f));
+    }
+    return points;
+}
+
+// bit for bit, as in place & parallel runs must match serial ones
+inline bool isSame(const vec3& a, const vec3& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
@@ -0,0 +1,14 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#pragma once
+#include <chrono>
+
+// timing shared by the benchmark classes
+
+typedef std::chrono::high_resolution_clock tClock;
+
+inline double getElapsedMs(tClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(tClock::now() - start).count();
+}
@@ -0,0 +1,147 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "DynamicKDTree.h"
+#include "Random.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    typedef std::unordered_map<DynamicKDTree::tPointId, vec3> tReferencePoints;
+
+    // naive nearest distance over the reference set
+    float findNearestDistanceSqr(const tReferencePoints& referencePoints, const vec3& queryPoint)
+    {
+        float smallestDistanceSqr = FLT_MAX;
+        for (const auto& idAndPoint : referencePoints)
+        {
+            smallestDistanceSqr = std::min(smallestDistanceSqr, (idAndPoint.second - queryPoint).getLengthSquared());
+        }
+        return smallestDistanceSqr;
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (DynamicKDTreeTests)
+    {
+      public:
+        TEST_METHOD (InsertRemoveUpdate)
+        {
+            // start from a point cloud, then churn it
+            constexpr int numPoints = 512;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            DynamicKDTree kdTree(pointCloud);
+            tReferencePoints referencePoints;
+            for (int i = 0; i != numPoints; ++i)
+            {
+                referencePoints[i] = pointCloud[i];
+            }
+
+            std::vector<DynamicKDTree::Neighbor> neighbors(8);
+            constexpr int testRounds = 4096;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                // random operation
+                const float operation = rand01();
+                if (operation < 0.4f || referencePoints.empty())
+                {
+                    const vec3 point(rand01(), rand01(), rand01());
+                    referencePoints[kdTree.insert(point)] = point;
+                }
+                else
+                {
+                    auto it = referencePoints.begin();
+                    std::advance(it, randIndex(referencePoints.size()));
+                    if (operation < 0.7f)
+                    {
+                        Assert::IsTrue(kdTree.remove(it->first));
+                        Assert::IsFalse(kdTree.isValid(it->first));
+                        referencePoints.erase(it);
+                    }
+                    else
+                    {
+                        it->second = vec3(rand01(), rand01(), rand01());
+                        Assert::IsTrue(kdTree.updatePosition(it->first, it->second));
+                    }
+                }
+                Assert::AreEqual(uint32_t(referencePoints.size()), kdTree.getNumPoints());
+
+                // queries stay valid after every operation
+                const vec3 queryPoint(rand01(), rand01(), rand01());
+                const DynamicKDTree::tPointId nearestId = kdTree.findNearestNeighbor(queryPoint);
+                Assert::IsTrue(referencePoints.count(nearestId) == 1);
+                Assert::IsTrue(kdTree.getPosition(nearestId).isEqual(referencePoints[nearestId]));
+
+                std::wstringstream outputStream;
+                outputStream << "\n"
+                             << "Round: " << i << "\n"
+                             << "Query: " << queryPoint;
+                Assert::AreEqual(findNearestDistanceSqr(referencePoints, queryPoint), (referencePoints[nearestId] - queryPoint).getLengthSquared(), outputStream.str().c_str());
+
+                // k nearest come back sorted & live
+                const uint32_t numFound = kdTree.findKNearestNeighbors(queryPoint, 8, neighbors.data());
+                Assert::AreEqual(std::min(uint32_t(8), uint32_t(referencePoints.size())), numFound);
+                for (uint32_t j = 0; j != numFound; ++j)
+                {
+                    Assert::IsTrue(referencePoints.count(neighbors[j].id) == 1);
+                    if (j != 0)
+                        Assert::IsTrue(neighbors[j - 1].distanceSqr <= neighbors[j].distanceSqr);
+                }
+            }
+        }
+
+        TEST_METHOD (RadiusSearch)
+        {
+            DynamicKDTree kdTree;
+            tReferencePoints referencePoints;
+            constexpr int numPoints = 1024;
+            for (int i = 0; i != numPoints; ++i)
+            {
+                const vec3 point(rand01(), rand01(), rand01());
+                referencePoints[kdTree.insert(point)] = point;
+            }
+
+            // remove every other point, leaving tombstones behind
+            for (DynamicKDTree::tPointId id = 0; id < numPoints; id += 2)
+            {
+                kdTree.remove(id);
+                referencePoints.erase(id);
+            }
+
+            constexpr int testRounds = 64;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                const vec3 queryPoint(rand01(), rand01(), rand01());
+                const float radius = randRange(0.f, 0.3f);
+
+                std::vector<DynamicKDTree::tPointId> naiveResults;
+                for (const auto& idAndPoint : referencePoints)
+                {
+                    if ((idAndPoint.second - queryPoint).getLengthSquared() < radius * radius)
+                        naiveResults.push_back(idAndPoint.first);
+                }
+
+                std::vector<DynamicKDTree::tPointId> treeResults;
+                kdTree.findPointsInRadius(queryPoint, radius, [](DynamicKDTree::tPointId id, const vec3& point, void* pUserData) { static_cast<std::vector<DynamicKDTree::tPointId>*>(pUserData)->push_back(id); }, &treeResults);
+
+                std::sort(naiveResults.begin(), naiveResults.end());
+                std::sort(treeResults.begin(), treeResults.end());
+                Assert::IsTrue(naiveResults == treeResults);
+            }
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,648 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BenchmarkHelpers.h"
+#include "DynamicKDTree.h"
+#include "KDTree.h"
+#include "Parallel.h"
+#include "Random.h"
+#include "SpatialHashGrid.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    std::vector<vec3> makePointCloud(int numPoints)
+    {
+        std::vector<vec3> pointCloud;
+        pointCloud.reserve(numPoints);
+        for (int i = 0; i != numPoints; ++i)
+        {
+            pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+        }
+        return pointCloud;
+    }
+
+    // reference copy of the original construction: full sort and vector copies at every level, one heap node per point
+    struct SortedKDNode
+    {
+        typedef std::vector<const vec3*> tConstPointRefs;
+
+        SortedKDNode(tConstPointRefs& inPoints, int depth)
+        {
+            if (inPoints.size() == 1)
+            {
+                pData = inPoints[0];
+                return;
+            }
+
+            const int axis = depth % 3;
+            std::sort(inPoints.begin(), inPoints.end(), [axis](const vec3* l, const vec3* r) { return (&l->x)[axis] < (&r->x)[axis]; });
+
+            const size_t medianIndex = inPoints.size() / 2;
+            pData = inPoints[medianIndex];
+
+            tConstPointRefs leftPoints = tConstPointRefs(inPoints.begin(), inPoints.begin() + medianIndex);
+            tConstPointRefs rightPoints = tConstPointRefs(inPoints.begin() + medianIndex + 1, inPoints.end());
+
+            pLeftChild = leftPoints.empty() ? nullptr : new SortedKDNode(leftPoints, depth + 1);
+            pRightChild = rightPoints.empty() ? nullptr : new SortedKDNode(rightPoints, depth + 1);
+        }
+        ~SortedKDNode()
+        {
+            delete pLeftChild;
+            delete pRightChild;
+        }
+
+        const vec3* pData = nullptr;
+        SortedKDNode* pLeftChild = nullptr;
+        SortedKDNode* pRightChild = nullptr;
+    };
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (KDTreeBenchmarks)
+    {
+      public:
+        TEST_METHOD (BuildTime)
+        {
+            constexpr int numPoints = 1 << 18;
+            constexpr int buildRounds = 4;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+
+            double sortedBuildMs = 0.0;
+            double kdTreeBuildMs = 0.0;
+            double parallelBuildMs = 0.0;
+            for (int i = 0; i != buildRounds; ++i)
+            {
+                {
+                    tClock::time_point start = tClock::now();
+                    std::vector<const vec3*> pointRefs;
+                    pointRefs.reserve(pointCloud.size());
+                    for (const vec3& point : pointCloud)
+                    {
+                        pointRefs.push_back(&point);
+                    }
+                    SortedKDNode sortedTree(pointRefs, 0);
+                    sortedBuildMs += getElapsedMs(start);
+                }
+                {
+                    tClock::time_point start = tClock::now();
+                    KDTree kdTree(pointCloud);
+                    kdTreeBuildMs += getElapsedMs(start);
+                }
+                {
+                    tClock::time_point start = tClock::now();
+                    KDTree::BuildSettings settings;
+                    settings.parallelDepth = 4;
+                    KDTree kdTree(pointCloud, settings);
+                    parallelBuildMs += getElapsedMs(start);
+                }
+            }
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << "\n"
+                         << "Sort + copy build: " << sortedBuildMs / buildRounds << " ms\n"
+                         << "KDTree build: " << kdTreeBuildMs / buildRounds << " ms\n"
+                         << "KDTree parallel build: " << parallelBuildMs / buildRounds << " ms\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (BatchQueryTime)
+        {
+            constexpr int numPoints = 1 << 18;
+            constexpr int numQueries = 1 << 18;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+            const KDTree kdTree(pointCloud);
+            std::vector<const vec3*> results(numQueries);
+
+            double singleQueryMs = 0.0;
+            {
+                tClock::time_point start = tClock::now();
+                for (int i = 0; i != numQueries; ++i)
+                {
+                    results[i] = kdTree.findNearestNeighbor(queryPoints[i]);
+                }
+                singleQueryMs = getElapsedMs(start);
+            }
+
+            KDTree::BatchSettings settings;
+            double batchQueryMs = 0.0;
+            {
+                tClock::time_point start = tClock::now();
+                kdTree.findNearestNeighbors(queryPoints.data(), numQueries, results.data(), settings);
+                batchQueryMs = getElapsedMs(start);
+            }
+
+            settings.sortQueries = true;
+            double sortedBatchQueryMs = 0.0;
+            {
+                tClock::time_point start = tClock::now();
+                kdTree.findNearestNeighbors(queryPoints.data(), numQueries, results.data(), settings);
+                sortedBatchQueryMs = getElapsedMs(start);
+            }
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << ", threads: " << Parallel::getDefaultThreadCount() << "\n"
+                         << "Single queries: " << singleQueryMs << " ms\n"
+                         << "Batch: " << batchQueryMs << " ms\n"
+                         << "Morton sorted batch: " << sortedBatchQueryMs << " ms\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (LeafSizeQueryTime)
+        {
+            constexpr int numPoints = 1 << 20;
+            constexpr int numQueries = 1 << 17;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << "\n";
+            for (uint32_t leafSize : {1u, 4u, 8u, 16u, 32u})
+            {
+                KDTree::BuildSettings settings;
+                settings.leafSize = leafSize;
+                const KDTree kdTree(pointCloud, settings);
+
+                tClock::time_point start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    kdTree.findNearestNeighbor(queryPoint);
+                }
+                outputStream << "Leaf size " << leafSize << ": " << getElapsedMs(start) << " ms\n";
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (SplitPolicyVisitedNodes)
+        {
+            constexpr int numPoints = 1 << 20;
+            constexpr int numQueries = 1 << 16;
+
+            // anisotropic clouds: a long corridor & flat terrain
+            struct Dataset
+            {
+                const char* name;
+                vec3 scale;
+            };
+            const Dataset datasets[] = {{"Cube", vec3(1.f, 1.f, 1.f)}, {"Corridor", vec3(100.f, 1.f, 1.f)}, {"Terrain", vec3(1.f, 1.f, 0.01f)}};
+            const std::pair<const char*, KDTree::SplitPolicy> policies[] = {
+                {"cycle", KDTree::SplitPolicy::Cycle}, {"widest extent", KDTree::SplitPolicy::WidestExtent}, {"max variance", KDTree::SplitPolicy::MaxVariance}};
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << "\n";
+            for (const Dataset& dataset : datasets)
+            {
+                auto makeScaledPointCloud = [&](int count) {
+                    std::vector<vec3> pointCloud = makePointCloud(count);
+                    for (vec3& point : pointCloud)
+                    {
+                        point = vec3(point.x * dataset.scale.x, point.y * dataset.scale.y, point.z * dataset.scale.z);
+                    }
+                    return pointCloud;
+                };
+                const std::vector<vec3> pointCloud = makeScaledPointCloud(numPoints);
+                const std::vector<vec3> queryPoints = makeScaledPointCloud(numQueries);
+
+                for (const auto& policy : policies)
+                {
+                    KDTree::BuildSettings settings;
+                    settings.splitPolicy = policy.second;
+                    tClock::time_point buildStart = tClock::now();
+                    const KDTree kdTree(pointCloud, settings);
+                    const double buildMs = getElapsedMs(buildStart);
+
+                    // exact search, only counting visits
+                    const KDTree::ApproximateSettings exactSettings;
+                    uint64_t totalVisitedNodes = 0;
+                    tClock::time_point start = tClock::now();
+                    for (const vec3& queryPoint : queryPoints)
+                    {
+                        uint32_t numVisitedNodes = 0;
+                        kdTree.findApproximateNearestNeighbor(queryPoint, exactSettings, &numVisitedNodes);
+                        totalVisitedNodes += numVisitedNodes;
+                    }
+                    const double queryMs = getElapsedMs(start);
+
+                    outputStream << dataset.name << ", " << policy.first << ": build " << buildMs << " ms, query " << queryMs << " ms, "
+                                 << double(totalVisitedNodes) / numQueries << " visits/query\n";
+                }
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (NodeBoundsVisitedNodes)
+        {
+            constexpr int numPoints = 1 << 20;
+            constexpr int numQueries = 1 << 14;
+            constexpr int numClusters = 256;
+
+            // dense clusters in mostly empty space, queries anywhere
+            const std::vector<vec3> clusterCenters = makePointCloud(numClusters);
+            std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud[i] = clusterCenters[i % numClusters] + pointCloud[i] * 0.01f;
+            }
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+
+            const std::pair<const char*, KDTree::NodeBounds> boundsTypes[] = {
+                {"none", KDTree::NodeBounds::None}, {"full", KDTree::NodeBounds::Full}, {"quantized", KDTree::NodeBounds::Quantized}};
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << " in " << numClusters << " clusters, queries: " << numQueries << "\n";
+            for (const auto& boundsType : boundsTypes)
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = boundsType.second;
+                const KDTree kdTree(pointCloud, settings);
+
+                // exact search, only counting visits
+                const KDTree::ApproximateSettings exactSettings;
+                uint64_t totalVisitedNodes = 0;
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    uint32_t numVisitedNodes = 0;
+                    kdTree.findApproximateNearestNeighbor(queryPoint, exactSettings, &numVisitedNodes);
+                    totalVisitedNodes += numVisitedNodes;
+                }
+
+                tClock::time_point start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    kdTree.findNearestNeighbor(queryPoint);
+                }
+                const double queryMs = getElapsedMs(start);
+
+                KDTree::IndexNeighbor neighbors[16];
+                start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    kdTree.findKNearestNeighbors(queryPoint, 16, neighbors);
+                }
+                const double kQueryMs = getElapsedMs(start);
+
+                outputStream << boundsType.first << " bounds: " << double(totalVisitedNodes) / numQueries << " visits/query, nearest " << queryMs << " ms, 16 nearest " << kQueryMs << " ms\n";
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (PointStorageQueryTime)
+        {
+            constexpr int numPoints = 1 << 22;
+            constexpr int numQueries = 1 << 18;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+
+            KDTree::BuildSettings copySettings;
+            copySettings.copyPoints = true;
+            const KDTree referenceTree(pointCloud);
+            const KDTree copyTree(pointCloud, copySettings);
+
+            // touch the result, as a caller would
+            auto timeQueries = [&](const KDTree& kdTree) {
+                float sum = 0.f;
+                tClock::time_point start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    sum += kdTree.findNearestNeighbor(queryPoint)->x;
+                }
+                const double queryMs = getElapsedMs(start);
+                return sum >= 0.f ? queryMs : 0.0;
+            };
+            auto timeIndexQueries = [&](const KDTree& kdTree) {
+                uint32_t sum = 0;
+                tClock::time_point start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    sum += kdTree.findNearestNeighborIndex(queryPoint);
+                }
+                const double queryMs = getElapsedMs(start);
+                return sum != 1 ? queryMs : 0.0;
+            };
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << "\n"
+                         << "Referenced points, pointer results: " << timeQueries(referenceTree) << " ms\n"
+                         << "Referenced points, index results: " << timeIndexQueries(referenceTree) << " ms\n"
+                         << "Copied points, pointer results: " << timeQueries(copyTree) << " ms\n"
+                         << "Copied points, index results: " << timeIndexQueries(copyTree) << " ms\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (AllKNearestNeighborsTime)
+        {
+            constexpr int numPoints = 1 << 19;
+            constexpr uint32_t k = 8;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", k: " << k << "\n";
+            for (KDTree::NodeBounds nodeBounds : {KDTree::NodeBounds::None, KDTree::NodeBounds::Full})
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = nodeBounds;
+                const KDTree kdTree(pointCloud, settings);
+
+                // one query per point, its own nearest neighbor included
+                std::vector<KDTree::IndexNeighbor> neighbors(size_t(numPoints) * (k + 1));
+                tClock::time_point start = tClock::now();
+                Parallel::forRange(numPoints, 256, 0, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+                    for (uint32_t i = rangeBegin; i != rangeEnd; ++i)
+                    {
+                        kdTree.findKNearestNeighbors(pointCloud[i], k + 1, neighbors.data() + size_t(i) * (k + 1));
+                    }
+                });
+                const double queryMs = getElapsedMs(start);
+
+                KDTree::NeighborGraph graph;
+                start = tClock::now();
+                kdTree.findAllKNearestNeighbors(k, graph);
+                const double allMs = getElapsedMs(start);
+
+                outputStream << (nodeBounds == KDTree::NodeBounds::None ? "No" : "Full") << " node bounds: per point queries " << queryMs << " ms, all k nearest " << allMs << " ms\n";
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (RayQueryTime)
+        {
+            constexpr int numPoints = 1 << 20;
+            constexpr int numRays = 1 << 12;
+            constexpr int numBruteForceRays = 1 << 8;
+            constexpr float radius = 0.002f;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> origins = makePointCloud(numRays);
+            const std::vector<vec3> targets = makePointCloud(numRays);
+
+            // projecting every point by hand, on fewer rays
+            uint32_t numHits = 0;
+            tClock::time_point start = tClock::now();
+            for (int i = 0; i != numBruteForceRays; ++i)
+            {
+                const vec3 direction = (targets[i] - origins[i]).getUnit();
+                float firstRayDistance = FLT_MAX;
+                for (const vec3& point : pointCloud)
+                {
+                    const float rayDistance = std::max((point - origins[i]).dot(direction), 0.f);
+                    if (rayDistance < firstRayDistance && (point - (origins[i] + direction * rayDistance)).getLengthSquared() < radius * radius)
+                        firstRayDistance = rayDistance;
+                }
+                numHits += (firstRayDistance != FLT_MAX) ? 1 : 0;
+            }
+            const double bruteForceMs = getElapsedMs(start);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", rays: " << numRays << "\n"
+                         << "Brute force first hit, " << numBruteForceRays << " rays: " << bruteForceMs << " ms, " << numHits << " hits\n";
+            for (KDTree::NodeBounds nodeBounds : {KDTree::NodeBounds::None, KDTree::NodeBounds::Full})
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = nodeBounds;
+                const KDTree kdTree(pointCloud, settings);
+
+                start = tClock::now();
+                for (int i = 0; i != numRays; ++i)
+                {
+                    KDTree::IndexRayHit hit;
+                    kdTree.findFirstRayHit(origins[i], targets[i] - origins[i], radius, FLT_MAX, hit);
+                }
+                const double firstHitMs = getElapsedMs(start);
+
+                std::vector<KDTree::IndexRayHit> hits;
+                start = tClock::now();
+                for (int i = 0; i != numRays; ++i)
+                {
+                    kdTree.findPointsNearSegment(origins[i], targets[i], radius, hits);
+                }
+                const double segmentMs = getElapsedMs(start);
+
+                outputStream << (nodeBounds == KDTree::NodeBounds::None ? "No" : "Full") << " node bounds: first hit " << firstHitMs << " ms, segment " << segmentMs << " ms\n";
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (ApproximateQueryTradeoff)
+        {
+            constexpr int numPoints = 1 << 20;
+            constexpr int numQueries = 1 << 16;
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+            const KDTree kdTree(pointCloud);
+
+            // exact reference distances
+            std::vector<float> nearestDistances(numQueries);
+            for (int i = 0; i != numQueries; ++i)
+            {
+                nearestDistances[i] = (*kdTree.findNearestNeighbor(queryPoints[i]) - queryPoints[i]).getLength();
+            }
+
+            struct Tradeoff
+            {
+                float epsilon;
+                uint32_t maxVisitedNodes;
+            };
+            const Tradeoff tradeoffs[] = {{0.f, 0}, {0.1f, 0}, {0.5f, 0}, {1.f, 0}, {2.f, 0}, {0.f, 32}, {0.f, 20}};
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << "\n";
+            for (const Tradeoff& tradeoff : tradeoffs)
+            {
+                KDTree::ApproximateSettings settings;
+                settings.epsilon = tradeoff.epsilon;
+                settings.maxVisitedNodes = tradeoff.maxVisitedNodes;
+
+                std::vector<const vec3*> results(numQueries);
+                uint64_t totalVisitedNodes = 0;
+                tClock::time_point start = tClock::now();
+                for (int i = 0; i != numQueries; ++i)
+                {
+                    uint32_t numVisitedNodes = 0;
+                    results[i] = kdTree.findApproximateNearestNeighbor(queryPoints[i], settings, &numVisitedNodes);
+                    totalVisitedNodes += numVisitedNodes;
+                }
+                const double queryMs = getElapsedMs(start);
+
+                int numExact = 0;
+                double totalErrorRatio = 0.0;
+                double maxErrorRatio = 0.0;
+                for (int i = 0; i != numQueries; ++i)
+                {
+                    const float distance = (*results[i] - queryPoints[i]).getLength();
+                    const double errorRatio = (nearestDistances[i] > 0.f) ? (distance / nearestDistances[i]) - 1.0 : 0.0;
+                    numExact += (errorRatio == 0.0) ? 1 : 0;
+                    totalErrorRatio += errorRatio;
+                    maxErrorRatio = std::max(maxErrorRatio, errorRatio);
+                }
+
+                outputStream << "epsilon " << tradeoff.epsilon << ", max visits " << tradeoff.maxVisitedNodes << ": " << queryMs << " ms, "
+                             << double(totalVisitedNodes) / numQueries << " visits/query, " << 100.0 * numExact / numQueries << "% exact, "
+                             << "mean error " << 100.0 * totalErrorRatio / numQueries << "%, max error " << 100.0 * maxErrorRatio << "%\n";
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (DynamicUpdateTime)
+        {
+            constexpr int numPoints = 1 << 18;
+            constexpr int numTicks = 8;
+            constexpr int movesPerTick = numPoints / 100;
+            std::vector<vec3> pointCloud = makePointCloud(numPoints);
+
+            // move 1% of the points per tick
+            DynamicKDTree dynamicTree(pointCloud);
+            double dynamicMs = 0.0;
+            double rebuildMs = 0.0;
+            for (int tick = 0; tick != numTicks; ++tick)
+            {
+                std::vector<uint32_t> movedPoints(movesPerTick);
+                for (uint32_t& pointIndex : movedPoints)
+                {
+                    pointIndex = randIndex(numPoints);
+                    pointCloud[pointIndex] = vec3(rand01(), rand01(), rand01());
+                }
+
+                {
+                    tClock::time_point start = tClock::now();
+                    for (uint32_t pointIndex : movedPoints)
+                    {
+                        dynamicTree.updatePosition(pointIndex, pointCloud[pointIndex]);
+                    }
+                    dynamicMs += getElapsedMs(start);
+                }
+                {
+                    tClock::time_point start = tClock::now();
+                    KDTree kdTree(pointCloud);
+                    rebuildMs += getElapsedMs(start);
+                }
+            }
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", moved per tick: " << movesPerTick << "\n"
+                         << "DynamicKDTree updates: " << dynamicMs / numTicks << " ms/tick\n"
+                         << "KDTree rebuild: " << rebuildMs / numTicks << " ms/tick\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (HashGridUpdateQueryTime)
+        {
+            constexpr int numPoints = 1 << 18;
+            constexpr int numTicks = 8;
+            constexpr int queriesPerTick = 1 << 12;
+            constexpr float radius = 0.02f;
+            std::vector<vec3> pointCloud = makePointCloud(numPoints);
+
+            // particles: every point jitters a little each tick, then some of them look around
+            DynamicKDTree dynamicTree(pointCloud);
+            hashgrid3 grid(2.f * radius, pointCloud);
+            double treeUpdateMs = 0.0;
+            double gridUpdateMs = 0.0;
+            double treeQueryMs = 0.0;
+            double gridQueryMs = 0.0;
+            uint32_t treeFound = 0;
+            uint32_t gridFound = 0;
+            auto countPoint = [](uint32_t, const vec3&, void* pUserData) { ++*static_cast<uint32_t*>(pUserData); };
+            for (int tick = 0; tick != numTicks; ++tick)
+            {
+                for (vec3& point : pointCloud)
+                {
+                    point += vec3(randRange(-0.002f, 0.002f), randRange(-0.002f, 0.002f), randRange(-0.002f, 0.002f));
+                }
+                const std::vector<vec3> queryPoints = makePointCloud(queriesPerTick);
+
+                tClock::time_point start = tClock::now();
+                for (uint32_t i = 0; i != numPoints; ++i)
+                {
+                    dynamicTree.updatePosition(i, pointCloud[i]);
+                }
+                treeUpdateMs += getElapsedMs(start);
+
+                start = tClock::now();
+                for (uint32_t i = 0; i != numPoints; ++i)
+                {
+                    grid.updatePosition(i, pointCloud[i]);
+                }
+                grid.rebuild();
+                gridUpdateMs += getElapsedMs(start);
+
+                start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    dynamicTree.findPointsInRadius(queryPoint, radius, countPoint, &treeFound);
+                }
+                treeQueryMs += getElapsedMs(start);
+
+                start = tClock::now();
+                for (const vec3& queryPoint : queryPoints)
+                {
+                    grid.findPointsInRadius(queryPoint, radius, countPoint, &gridFound);
+                }
+                gridQueryMs += getElapsedMs(start);
+            }
+            Assert::AreEqual(treeFound, gridFound);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", all moved per tick, radius queries per tick: " << queriesPerTick << "\n"
+                         << "DynamicKDTree: " << treeUpdateMs / numTicks << " ms/tick updates, " << treeQueryMs / numTicks << " ms/tick queries\n"
+                         << "hashgrid3: " << gridUpdateMs / numTicks << " ms/tick updates, " << gridQueryMs / numTicks << " ms/tick queries\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (SaveLoadTime)
+        {
+            constexpr int numPoints = 1 << 22;
+            constexpr int numQueries = 1 << 12;
+            const char* path = "KDTreeBenchmarks.kdtree";
+            const std::vector<vec3> pointCloud = makePointCloud(numPoints);
+            const std::vector<vec3> queryPoints = makePointCloud(numQueries);
+
+            tClock::time_point start = tClock::now();
+            {
+                const KDTree kdTree(pointCloud);
+                kdTree.save(path);
+            }
+            const double buildMs = getElapsedMs(start);
+
+            // first queries fault in the pages they touch
+            start = tClock::now();
+            std::unique_ptr<KDTree> pLoadedTree = KDTree::load(path);
+            const double loadMs = getElapsedMs(start);
+            start = tClock::now();
+            for (const vec3& queryPoint : queryPoints)
+            {
+                pLoadedTree->findNearestNeighbor(queryPoint);
+            }
+            const double firstQueriesMs = getElapsedMs(start);
+            pLoadedTree.reset();
+            std::remove(path);
+
+            std::wstringstream outputStream;
+            outputStream << "\n"
+                         << "Points: " << numPoints << ", queries: " << numQueries << "\n"
+                         << "KDTree build & save: " << buildMs << " ms\n"
+                         << "KDTree load: " << loadMs << " ms\n"
+                         << "First queries on loaded tree: " << firstQueriesMs << " ms\n";
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+    };
+} // namespace CoreMathUnitTest
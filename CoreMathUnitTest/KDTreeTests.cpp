@@ -6,10 +6,57 @@
 
 #include "KDTree.h"
 #include "Random.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
 #include <string>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+namespace
+{
+    // checks nearest neighbor queries of any tree type against a linear search
+    // POINT_FUNC: random point, DISTANCE_FUNC: squared distance between two points
+    template <class TREE, class VEC, class POINT_FUNC, class DISTANCE_FUNC>
+    void testNearestNeighbors(POINT_FUNC makePoint, DISTANCE_FUNC getDistanceSqr)
+    {
+        constexpr int numPoints = 1024;
+        std::vector<VEC> pointCloud;
+        pointCloud.reserve(numPoints);
+        for (int i = 0; i != numPoints; ++i)
+        {
+            pointCloud.push_back(makePoint());
+        }
+
+        TREE kdTree(pointCloud);
+
+        constexpr int testRounds = 256;
+        for (int i = 0; i != testRounds; ++i)
+        {
+            const VEC queryPoint = makePoint();
+
+            // naive query
+            const VEC* pNearestNeighbor = nullptr;
+            auto smallestDistanceSqr = getDistanceSqr(pointCloud[0], queryPoint);
+            for (const VEC& point : pointCloud)
+            {
+                const auto distanceSqr = getDistanceSqr(point, queryPoint);
+                if (distanceSqr <= smallestDistanceSqr)
+                {
+                    pNearestNeighbor = &point;
+                    smallestDistanceSqr = distanceSqr;
+                }
+            }
+
+            // ties may resolve to either point
+            const VEC* pKDNearestNeighbor = kdTree.findNearestNeighbor(queryPoint);
+            Assert::IsTrue(pKDNearestNeighbor != nullptr && getDistanceSqr(*pKDNearestNeighbor, queryPoint) == smallestDistanceSqr);
+        }
+    }
+} // namespace
+
 namespace CoreMathUnitTest
 {
     TEST_CLASS (KDTreeTests)
@@ -63,5 +110,825 @@ namespace CoreMathUnitTest
                 Assert::IsTrue(pNearestNeighbor == pKDNearestNeighbor, outputStream.str().c_str());
             }
         }
+
+        TEST_METHOD (KNearestNeighbors)
+        {
+            // init a point cloud
+            constexpr int numPoints = 256;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // precompute spacial indexing
+            KDTree kdTree(pointCloud);
+
+            std::vector<float> naiveDistances(numPoints);
+            std::vector<KDTree::Neighbor> neighbors;
+            constexpr int testRounds = 64;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                vec3 queryPoint(rand01(), rand01(), rand01());
+                const uint32_t k = 1 + randIndex(16);
+
+                // naive query
+                for (int j = 0; j != numPoints; ++j)
+                {
+                    naiveDistances[j] = (pointCloud[j] - queryPoint).getLengthSquared();
+                }
+                std::sort(naiveDistances.begin(), naiveDistances.end());
+
+                // k-d tree query
+                kdTree.findKNearestNeighbors(queryPoint, k, neighbors);
+                Assert::AreEqual(size_t(k), neighbors.size());
+                for (uint32_t j = 0; j != k; ++j)
+                {
+                    std::wstringstream outputStream;
+                    outputStream << "\n"
+                                 << "Query: " << queryPoint << "\n"
+                                 << "k: " << k << ", index: " << j << "\n"
+                                 << "Naive distance: " << naiveDistances[j] << "\n"
+                                 << "K-D Tree distance: " << neighbors[j].distanceSqr;
+                    Assert::AreEqual(naiveDistances[j], neighbors[j].distanceSqr, outputStream.str().c_str());
+                    Assert::AreEqual(naiveDistances[j], (*neighbors[j].pPoint - queryPoint).getLengthSquared(), outputStream.str().c_str());
+                }
+            }
+
+            // asking for more neighbors than points returns them all
+            kdTree.findKNearestNeighbors(vec3(0.5f), numPoints * 2, neighbors);
+            Assert::AreEqual(size_t(numPoints), neighbors.size());
+        }
+
+        TEST_METHOD (RadiusSearch)
+        {
+            // init a point cloud
+            constexpr int numPoints = 1024;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // precompute spacial indexing
+            KDTree kdTree(pointCloud);
+
+            std::vector<const vec3*> kdResults(numPoints);
+            constexpr int testRounds = 64;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                vec3 queryPoint(rand01(), rand01(), rand01());
+                const float radius = randRange(0.f, 0.3f);
+
+                // naive query
+                std::vector<const vec3*> naiveResults;
+                for (const vec3& point : pointCloud)
+                {
+                    if ((point - queryPoint).getLengthSquared() < radius * radius)
+                        naiveResults.push_back(&point);
+                }
+
+                // k-d tree query
+                const uint32_t numFound = kdTree.findPointsInRadius(queryPoint, radius, kdResults.data(), numPoints);
+                std::vector<const vec3*> treeResults(kdResults.begin(), kdResults.begin() + numFound);
+
+                // callback query
+                std::vector<const vec3*> callbackResults;
+                kdTree.findPointsInRadius(queryPoint, radius, [](const vec3* pPoint, void* pUserData) { static_cast<std::vector<const vec3*>*>(pUserData)->push_back(pPoint); }, &callbackResults);
+
+                std::sort(naiveResults.begin(), naiveResults.end());
+                std::sort(treeResults.begin(), treeResults.end());
+                std::sort(callbackResults.begin(), callbackResults.end());
+                Assert::IsTrue(naiveResults == treeResults);
+                Assert::IsTrue(naiveResults == callbackResults);
+            }
+
+            // a short buffer still reports the full count
+            const vec3* pSingleResult = nullptr;
+            Assert::AreEqual(uint32_t(numPoints), kdTree.findPointsInRadius(vec3(0.5f), 2.f, &pSingleResult, 1));
+            Assert::IsTrue(pSingleResult != nullptr);
+        }
+
+        TEST_METHOD (BoxSearch)
+        {
+            // init a point cloud
+            constexpr int numPoints = 1024;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // precompute spacial indexing
+            KDTree kdTree(pointCloud);
+
+            std::vector<const vec3*> kdResults(numPoints);
+            constexpr int testRounds = 64;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                const vec3 cornerA(rand01(), rand01(), rand01());
+                const vec3 cornerB(rand01(), rand01(), rand01());
+                const vec3 boxMin(fmin(cornerA.x, cornerB.x), fmin(cornerA.y, cornerB.y), fmin(cornerA.z, cornerB.z));
+                const vec3 boxMax(fmax(cornerA.x, cornerB.x), fmax(cornerA.y, cornerB.y), fmax(cornerA.z, cornerB.z));
+
+                // naive query
+                std::vector<const vec3*> naiveResults;
+                for (const vec3& point : pointCloud)
+                {
+                    if (point.x >= boxMin.x && point.y >= boxMin.y && point.z >= boxMin.z && point.x <= boxMax.x && point.y <= boxMax.y && point.z <= boxMax.z)
+                        naiveResults.push_back(&point);
+                }
+
+                // k-d tree query
+                const uint32_t numFound = kdTree.findPointsInBox(boxMin, boxMax, kdResults.data(), numPoints);
+                std::vector<const vec3*> treeResults(kdResults.begin(), kdResults.begin() + numFound);
+
+                std::sort(naiveResults.begin(), naiveResults.end());
+                std::sort(treeResults.begin(), treeResults.end());
+                Assert::IsTrue(naiveResults == treeResults);
+            }
+        }
+
+        TEST_METHOD (BatchNearestNeighbors)
+        {
+            // init a point cloud
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // precompute spacial indexing
+            KDTree kdTree(pointCloud);
+
+            constexpr int numQueries = 4096;
+            std::vector<vec3> queryPoints;
+            queryPoints.reserve(numQueries);
+            for (int i = 0; i != numQueries; ++i)
+            {
+                queryPoints.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            KDTree::BatchSettings settings;
+            settings.numThreads = 4;
+            for (bool sortQueries : {false, true})
+            {
+                settings.sortQueries = sortQueries;
+                std::vector<const vec3*> batchResults(numQueries, nullptr);
+                kdTree.findNearestNeighbors(queryPoints.data(), numQueries, batchResults.data(), settings);
+                for (int i = 0; i != numQueries; ++i)
+                {
+                    Assert::IsTrue(batchResults[i] == kdTree.findNearestNeighbor(queryPoints[i]));
+                }
+            }
+        }
+
+        TEST_METHOD (IndexResults)
+        {
+            // init a point cloud
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // a tree with its own copy outlives its input
+            KDTree referenceTree(pointCloud);
+            KDTree::BuildSettings settings;
+            settings.copyPoints = true;
+            std::unique_ptr<KDTree> pCopyTree;
+            {
+                std::vector<vec3> inputCopy = pointCloud;
+                pCopyTree.reset(new KDTree(inputCopy, settings));
+                inputCopy.assign(numPoints, vec3(-1.f));
+            }
+
+            constexpr int testRounds = 256;
+            std::vector<vec3> queryPoints;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                queryPoints.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+            std::vector<uint32_t> batchIndices(testRounds);
+            pCopyTree->findNearestNeighbors(queryPoints.data(), testRounds, batchIndices.data());
+
+            for (int i = 0; i != testRounds; ++i)
+            {
+                const vec3& queryPoint = queryPoints[i];
+
+                // indices map back to the input
+                const vec3* pNearestNeighbor = referenceTree.findNearestNeighbor(queryPoint);
+                const uint32_t nearestIndex = pCopyTree->findNearestNeighborIndex(queryPoint);
+                Assert::IsTrue(nearestIndex == pNearestNeighbor - pointCloud.data());
+                Assert::IsTrue(batchIndices[i] == nearestIndex);
+                Assert::IsTrue(pCopyTree->findNearestNeighbor(queryPoint)->isEqual(*pNearestNeighbor));
+
+                constexpr uint32_t k = 8;
+                KDTree::Neighbor neighbors[k];
+                KDTree::IndexNeighbor indexNeighbors[k];
+                Assert::IsTrue(referenceTree.findKNearestNeighbors(queryPoint, k, neighbors) == k);
+                Assert::IsTrue(pCopyTree->findKNearestNeighbors(queryPoint, k, indexNeighbors) == k);
+                for (uint32_t j = 0; j != k; ++j)
+                {
+                    Assert::IsTrue(indexNeighbors[j].distanceSqr == neighbors[j].distanceSqr);
+                    Assert::IsTrue(pointCloud[indexNeighbors[j].index].isEqual(*neighbors[j].pPoint));
+                }
+
+                constexpr uint32_t maxPoints = 128;
+                const vec3* pointsInRadius[maxPoints];
+                uint32_t indicesInRadius[maxPoints];
+                const uint32_t numInRadius = std::min(referenceTree.findPointsInRadius(queryPoint, 0.1f, pointsInRadius, maxPoints), maxPoints);
+                Assert::IsTrue(std::min(pCopyTree->findPointsInRadius(queryPoint, 0.1f, indicesInRadius, maxPoints), maxPoints) == numInRadius);
+                for (uint32_t j = 0; j != numInRadius; ++j)
+                {
+                    Assert::IsTrue((pointCloud[indicesInRadius[j]] - queryPoint).getLengthSquared() < 0.01f);
+                }
+            }
+
+            Assert::IsTrue(KDTree(std::vector<vec3>()).findNearestNeighborIndex(vec3(0.f)) == KDTree::InvalidIndex);
+        }
+
+        TEST_METHOD (ApproximateNearestNeighbor)
+        {
+            // init a point cloud
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // precompute spacial indexing
+            KDTree kdTree(pointCloud);
+
+            constexpr int testRounds = 256;
+            for (float epsilon : {0.f, 0.25f, 1.f})
+            {
+                KDTree::ApproximateSettings settings;
+                settings.epsilon = epsilon;
+                for (int i = 0; i != testRounds; ++i)
+                {
+                    vec3 queryPoint(rand01(), rand01(), rand01());
+                    const vec3* pNearestNeighbor = kdTree.findNearestNeighbor(queryPoint);
+                    const vec3* pApproximateNeighbor = kdTree.findApproximateNearestNeighbor(queryPoint, settings);
+
+                    const float nearestDistance = (*pNearestNeighbor - queryPoint).getLength();
+                    const float approximateDistance = (*pApproximateNeighbor - queryPoint).getLength();
+
+                    std::wstringstream outputStream;
+                    outputStream << "\n"
+                                 << "Epsilon: " << epsilon << "\n"
+                                 << "Nearest distance: " << nearestDistance << "\n"
+                                 << "Approximate distance: " << approximateDistance;
+                    Assert::IsTrue(approximateDistance <= nearestDistance * (1.f + epsilon) + FLT_EPSILON, outputStream.str().c_str());
+                }
+            }
+
+            // a node budget caps the visits, but still returns a point
+            KDTree::ApproximateSettings settings;
+            settings.maxVisitedNodes = 3;
+            uint32_t numVisitedNodes = 0;
+            Assert::IsTrue(kdTree.findApproximateNearestNeighbor(vec3(0.5f), settings, &numVisitedNodes) != nullptr);
+            Assert::AreEqual(settings.maxVisitedNodes, numVisitedNodes);
+        }
+
+        TEST_METHOD (LeafSizes)
+        {
+            // init a point cloud
+            constexpr int numPoints = 1000;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            for (uint32_t leafSize : {0u, 1u, 3u, 8u, 32u, KDTree::MaxLeafSize, KDTree::MaxLeafSize * 4})
+            {
+                KDTree::BuildSettings settings;
+                settings.leafSize = leafSize;
+                KDTree kdTree(pointCloud, settings);
+
+                constexpr int testRounds = 64;
+                for (int i = 0; i != testRounds; ++i)
+                {
+                    vec3 queryPoint(rand01(), rand01(), rand01());
+
+                    // naive query
+                    const vec3* pNearestNeighbor = nullptr;
+                    float smallestDistanceSqr = FLT_MAX;
+                    for (const vec3& point : pointCloud)
+                    {
+                        float distanceSqr = (point - queryPoint).getLengthSquared();
+                        if (distanceSqr < smallestDistanceSqr)
+                        {
+                            pNearestNeighbor = &point;
+                            smallestDistanceSqr = distanceSqr;
+                        }
+                    }
+
+                    std::wstringstream outputStream;
+                    outputStream << "\n"
+                                 << "Leaf size: " << leafSize << "\n"
+                                 << "Query: " << queryPoint;
+                    Assert::IsTrue(pNearestNeighbor == kdTree.findNearestNeighbor(queryPoint), outputStream.str().c_str());
+                }
+            }
+        }
+
+        TEST_METHOD (ParallelBuild)
+        {
+            // init a point cloud, with duplicates to exercise median ties
+            constexpr int numPoints = 1 << 15;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                if (i % 8 == 0 && i != 0)
+                    pointCloud.push_back(pointCloud[randIndex(pointCloud.size())]);
+                else
+                    pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            KDTree serialTree(pointCloud);
+            KDTree::BuildSettings parallelSettings;
+            parallelSettings.parallelDepth = 4;
+            KDTree parallelTree(pointCloud, parallelSettings);
+
+            // identical trees return the identical point, even between duplicates
+            constexpr int testRounds = 1024;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                vec3 queryPoint(rand01(), rand01(), rand01());
+                Assert::IsTrue(serialTree.findNearestNeighbor(queryPoint) == parallelTree.findNearestNeighbor(queryPoint));
+            }
+        }
+
+        TEST_METHOD (SplitPolicies)
+        {
+            // init an anisotropic point cloud, a long thin slab
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01() * 100.f, rand01() * 10.f, rand01() * 0.1f));
+            }
+
+            for (KDTree::SplitPolicy policy : {KDTree::SplitPolicy::Cycle, KDTree::SplitPolicy::WidestExtent, KDTree::SplitPolicy::MaxVariance})
+            {
+                KDTree::BuildSettings settings;
+                settings.splitPolicy = policy;
+                KDTree kdTree(pointCloud, settings);
+
+                constexpr int testRounds = 256;
+                for (int i = 0; i != testRounds; ++i)
+                {
+                    vec3 queryPoint(rand01() * 100.f, rand01() * 10.f, rand01() * 0.1f);
+
+                    // naive query
+                    const vec3* pNearestNeighbor = nullptr;
+                    float smallestDistanceSqr = FLT_MAX;
+                    for (const vec3& point : pointCloud)
+                    {
+                        float distanceSqr = (point - queryPoint).getLengthSquared();
+                        if (distanceSqr < smallestDistanceSqr)
+                        {
+                            pNearestNeighbor = &point;
+                            smallestDistanceSqr = distanceSqr;
+                        }
+                    }
+                    Assert::IsTrue(pNearestNeighbor == kdTree.findNearestNeighbor(queryPoint));
+
+                    // box queries follow the same per node axes
+                    const vec3 boxExtent(5.f, 1.f, 0.01f);
+                    std::vector<const vec3*> boxPoints(numPoints);
+                    boxPoints.resize(kdTree.findPointsInBox(queryPoint - boxExtent, queryPoint + boxExtent, boxPoints.data(), numPoints));
+                    int numNaiveBoxPoints = 0;
+                    for (const vec3& point : pointCloud)
+                    {
+                        const vec3 delta = point - queryPoint;
+                        numNaiveBoxPoints += (std::abs(delta.x) <= boxExtent.x && std::abs(delta.y) <= boxExtent.y && std::abs(delta.z) <= boxExtent.z) ? 1 : 0;
+                    }
+                    Assert::IsTrue(numNaiveBoxPoints == int(boxPoints.size()));
+                }
+            }
+        }
+
+        TEST_METHOD (NodeBounds)
+        {
+            // init a clustered point cloud, far from the origin to exercise quantization
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                const vec3 clusterCenter(float(i % 16) * 10.f + 1000.f, float(i % 5) * 10.f, 0.f);
+                pointCloud.push_back(clusterCenter + vec3(rand01(), rand01(), rand01()));
+            }
+
+            // bounds only prune points that couldn't be a result, so results match a tree without them
+            const KDTree referenceTree(pointCloud);
+            const char* path = "NodeBounds.kdtree";
+            for (KDTree::NodeBounds nodeBounds : {KDTree::NodeBounds::Full, KDTree::NodeBounds::Quantized})
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = nodeBounds;
+                const KDTree kdTree(pointCloud, settings);
+                Assert::IsTrue(kdTree.save(path));
+                std::unique_ptr<KDTree> pLoadedTree = KDTree::load(path);
+                Assert::IsTrue(pLoadedTree != nullptr);
+
+                for (const KDTree* pTree : {&kdTree, static_cast<const KDTree*>(pLoadedTree.get())})
+                {
+                    constexpr int testRounds = 256;
+                    for (int i = 0; i != testRounds; ++i)
+                    {
+                        const vec3 queryPoint = vec3(rand01() * 170.f + 995.f, rand01() * 50.f - 5.f, rand01() * 10.f - 5.f);
+                        Assert::IsTrue(pTree->findNearestNeighborIndex(queryPoint) == referenceTree.findNearestNeighborIndex(queryPoint));
+
+                        KDTree::IndexNeighbor neighbors[8];
+                        KDTree::IndexNeighbor referenceNeighbors[8];
+                        const uint32_t numNeighbors = pTree->findKNearestNeighbors(queryPoint, 8, neighbors);
+                        Assert::IsTrue(numNeighbors == referenceTree.findKNearestNeighbors(queryPoint, 8, referenceNeighbors));
+                        for (uint32_t n = 0; n != numNeighbors; ++n)
+                        {
+                            Assert::IsTrue(neighbors[n].index == referenceNeighbors[n].index);
+                        }
+
+                        uint32_t indices[numPoints];
+                        Assert::IsTrue(pTree->findPointsInRadius(queryPoint, 2.f, indices, numPoints) == referenceTree.findPointsInRadius(queryPoint, 2.f, indices, numPoints));
+                        const vec3 boxExtent(3.f, 2.f, 1.f);
+                        Assert::IsTrue(pTree->findPointsInBox(queryPoint - boxExtent, queryPoint + boxExtent, indices, numPoints) ==
+                                       referenceTree.findPointsInBox(queryPoint - boxExtent, queryPoint + boxExtent, indices, numPoints));
+                    }
+                }
+            }
+            std::remove(path);
+        }
+
+        TEST_METHOD (DegenerateInputs)
+        {
+            // duplicates & collinear points, with single point leaves for the deepest trees
+            constexpr int numPoints = 1 << 16;
+            std::vector<vec3> duplicatePoints(numPoints, vec3(0.5f));
+            std::vector<vec3> collinearPoints;
+            collinearPoints.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                collinearPoints.push_back(vec3(float(i % 256), 0.f, 0.f));
+            }
+
+            KDTree::BuildSettings settings;
+            settings.leafSize = 1;
+            for (const std::vector<vec3>* pPointCloud : {&duplicatePoints, &collinearPoints})
+            {
+                const std::vector<vec3>& pointCloud = *pPointCloud;
+                KDTree kdTree(pointCloud, settings);
+
+                constexpr int testRounds = 64;
+                for (int i = 0; i != testRounds; ++i)
+                {
+                    vec3 queryPoint(rand01() * 256.f, rand01(), rand01());
+
+                    // naive queries
+                    float smallestDistanceSqr = FLT_MAX;
+                    uint32_t numInRadius = 0;
+                    uint32_t numInBox = 0;
+                    for (const vec3& point : pointCloud)
+                    {
+                        const vec3 delta = point - queryPoint;
+                        smallestDistanceSqr = std::min(smallestDistanceSqr, delta.getLengthSquared());
+                        numInRadius += (delta.getLengthSquared() < 4.f) ? 1 : 0;
+                        numInBox += (std::abs(delta.x) <= 2.f && std::abs(delta.y) <= 2.f && std::abs(delta.z) <= 2.f) ? 1 : 0;
+                    }
+
+                    const vec3* pNearestNeighbor = kdTree.findNearestNeighbor(queryPoint);
+                    Assert::IsTrue((*pNearestNeighbor - queryPoint).getLengthSquared() == smallestDistanceSqr);
+                    Assert::IsTrue(kdTree.findPointsInRadius(queryPoint, 2.f, static_cast<uint32_t*>(nullptr), 0) == numInRadius);
+                    Assert::IsTrue(kdTree.findPointsInBox(queryPoint - vec3(2.f), queryPoint + vec3(2.f), static_cast<uint32_t*>(nullptr), 0) == numInBox);
+                }
+            }
+        }
+
+        TEST_METHOD (QueryStats)
+        {
+            // init a point cloud
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+            KDTree::BuildSettings settings;
+            settings.leafSize = 8;
+            KDTree kdTree(pointCloud, settings);
+
+            KDTreeStats::reset();
+            const vec3 queryPoint(rand01(), rand01(), rand01());
+            uint32_t numVisitedNodes = 0;
+            kdTree.findApproximateNearestNeighbor(queryPoint, KDTree::ApproximateSettings(), &numVisitedNodes);
+            const KDTreeQueryStats queryStats = KDTreeStats::getLastQuery();
+
+            // batch workers exit before the call returns, their counts stay in the totals
+            constexpr int numQueries = 1000;
+            std::vector<vec3> queryPoints(numQueries, queryPoint);
+            std::vector<uint32_t> results(numQueries);
+            KDTree::BatchSettings batchSettings;
+            batchSettings.numThreads = 4;
+            kdTree.findNearestNeighbors(queryPoints.data(), numQueries, results.data(), batchSettings);
+            const KDTreeQueryStats threadTotals = KDTreeStats::getThreadTotals();
+            const KDTreeQueryStats totals = KDTreeStats::getTotals();
+
+            if (!KDTreeStats::Enabled)
+            {
+                Assert::IsTrue(queryStats.numQueries == 0 && queryStats.numNodesVisited == 0 && totals.numQueries == 0);
+                return;
+            }
+            Assert::IsTrue(queryStats.numQueries == 1);
+            Assert::IsTrue(queryStats.numNodesVisited == numVisitedNodes);
+            Assert::IsTrue(queryStats.numLeavesScanned >= 1 && queryStats.numLeavesScanned < queryStats.numNodesVisited);
+            Assert::IsTrue(queryStats.numDistanceEvaluations >= queryStats.numNodesVisited);
+            Assert::IsTrue(queryStats.numBacktracks < queryStats.numNodesVisited);
+            Assert::IsTrue(queryStats.maxDepth >= 8 && queryStats.maxDepth <= 12);
+            Assert::IsTrue(threadTotals.numQueries >= 1 && threadTotals.numNodesVisited >= numVisitedNodes);
+            Assert::IsTrue(totals.numQueries == numQueries + 1);
+            Assert::IsTrue(totals.numNodesVisited == (numQueries + 1) * uint64_t(numVisitedNodes));
+
+            // box queries count the same way
+            const vec3 boxExtent(0.05f);
+            kdTree.findPointsInBox(queryPoint - boxExtent, queryPoint + boxExtent, static_cast<uint32_t*>(nullptr), 0);
+            const KDTreeQueryStats boxStats = KDTreeStats::getLastQuery();
+            Assert::IsTrue(boxStats.numQueries == 1 && boxStats.numLeavesScanned >= 1 && boxStats.numDistanceEvaluations >= boxStats.numNodesVisited);
+
+            // & so do thick rays & segments, crossing the whole cloud
+            KDTree::IndexRayHit rayHits[16];
+            kdTree.findRayHits(vec3(-0.5f, 0.5f, 0.5f), vec3(1.f, 0.f, 0.f), 0.05f, 2.f, rayHits, 16);
+            const KDTreeQueryStats rayStats = KDTreeStats::getLastQuery();
+            Assert::IsTrue(rayStats.numQueries == 1 && rayStats.numLeavesScanned >= 1 && rayStats.numLeavesScanned < rayStats.numNodesVisited);
+            Assert::IsTrue(rayStats.numDistanceEvaluations >= rayStats.numNodesVisited && rayStats.numBacktracks >= 1);
+            Assert::IsTrue(rayStats.maxDepth >= 8 && rayStats.maxDepth <= 12);
+            std::vector<KDTree::IndexRayHit> segmentHits;
+            kdTree.findPointsNearSegment(vec3(0.f, 0.5f, 0.5f), vec3(1.f, 0.5f, 0.5f), 0.05f, segmentHits);
+            const KDTreeQueryStats segmentStats = KDTreeStats::getLastQuery();
+            Assert::IsTrue(segmentStats.numQueries == 1 && segmentStats.numLeavesScanned >= 1 && segmentStats.numDistanceEvaluations >= segmentHits.size());
+
+            // all nearest neighbors count one query per shared traversal, each point measured against k others at least
+            KDTreeStats::reset();
+            KDTree::NeighborGraph graph;
+            kdTree.findAllKNearestNeighbors(4, graph, batchSettings);
+            const KDTreeQueryStats graphTotals = KDTreeStats::getTotals();
+            Assert::IsTrue(graphTotals.numQueries >= numPoints / settings.leafSize && graphTotals.numQueries < numPoints);
+            Assert::IsTrue(graphTotals.numLeavesScanned >= numPoints / settings.leafSize && graphTotals.numDistanceEvaluations >= 4 * numPoints);
+
+            KDTreeStats::reset();
+            Assert::IsTrue(KDTreeStats::getTotals().numQueries == 0);
+        }
+
+        TEST_METHOD (RayQueries)
+        {
+            // init a point cloud
+            constexpr int numPoints = 4096;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            // naive thick ray test, same arithmetic as the tree
+            struct NaiveHit
+            {
+                uint32_t index;
+                float rayDistance;
+            };
+            auto getNaiveHits = [&](const vec3& origin, const vec3& direction, float radius, float maxDistance) {
+                const float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+                const vec3 unitDirection(direction.x / length, direction.y / length, direction.z / length);
+                std::vector<NaiveHit> hits;
+                for (uint32_t i = 0; i != numPoints; ++i)
+                {
+                    const vec3 offset = pointCloud[i] - origin;
+                    const float projection = offset.x * unitDirection.x + offset.y * unitDirection.y + offset.z * unitDirection.z;
+                    const float rayDistance = std::min(std::max(projection, 0.f), maxDistance);
+                    const vec3 delta(offset.x - rayDistance * unitDirection.x, offset.y - rayDistance * unitDirection.y, offset.z - rayDistance * unitDirection.z);
+                    if (delta.getLengthSquared() < radius * radius)
+                        hits.push_back({i, rayDistance});
+                }
+                std::sort(hits.begin(), hits.end(), [](const NaiveHit& l, const NaiveHit& r) { return l.rayDistance < r.rayDistance; });
+                return hits;
+            };
+
+            for (KDTree::NodeBounds nodeBounds : {KDTree::NodeBounds::None, KDTree::NodeBounds::Full})
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = nodeBounds;
+                KDTree kdTree(pointCloud, settings);
+
+                constexpr int testRounds = 256;
+                for (int i = 0; i != testRounds; ++i)
+                {
+                    // rays from anywhere, some axis aligned
+                    const vec3 origin(rand01() * 2.f - 0.5f, rand01() * 2.f - 0.5f, rand01() * 2.f - 0.5f);
+                    vec3 direction(rand01() - 0.5f, rand01() - 0.5f, rand01() - 0.5f);
+                    if (i % 8 == 0)
+                        direction = vec3(0.f, (i % 16 == 0) ? 1.f : -2.f, 0.f);
+                    const float radius = 0.01f + rand01() * 0.04f;
+                    const float maxDistance = (i % 2 == 0) ? FLT_MAX : rand01();
+
+                    const std::vector<NaiveHit> naiveHits = getNaiveHits(origin, direction, radius, maxDistance);
+                    KDTree::IndexRayHit firstHit;
+                    const bool isHit = kdTree.findFirstRayHit(origin, direction, radius, maxDistance, firstHit);
+                    Assert::IsTrue(isHit == !naiveHits.empty());
+                    if (isHit)
+                        Assert::IsTrue(firstHit.rayDistance == naiveHits[0].rayDistance);
+
+                    KDTree::RayHit hits[4];
+                    const uint32_t numHits = kdTree.findRayHits(origin, direction, radius, maxDistance, hits, 4);
+                    Assert::IsTrue(numHits == std::min(4u, uint32_t(naiveHits.size())));
+                    for (uint32_t h = 0; h != numHits; ++h)
+                    {
+                        Assert::IsTrue(hits[h].rayDistance == naiveHits[h].rayDistance);
+                        Assert::IsTrue(hits[h].pPoint >= pointCloud.data() && hits[h].pPoint < pointCloud.data() + numPoints);
+                    }
+
+                    // segments, including zero length
+                    const vec3 end = (i % 32 == 0) ? origin : origin + direction;
+                    const std::vector<NaiveHit> naiveSegmentHits = (i % 32 == 0) ? std::vector<NaiveHit>() : getNaiveHits(origin, end - origin, radius, (end - origin).getLength());
+                    std::vector<KDTree::IndexRayHit> segmentHits;
+                    kdTree.findPointsNearSegment(origin, end, radius, segmentHits);
+                    if (i % 32 == 0)
+                    {
+                        uint32_t numNearOrigin = 0;
+                        for (const vec3& point : pointCloud)
+                        {
+                            numNearOrigin += ((point - origin).getLengthSquared() < radius * radius) ? 1 : 0;
+                        }
+                        Assert::IsTrue(segmentHits.size() == numNearOrigin);
+                        continue;
+                    }
+                    Assert::IsTrue(segmentHits.size() == naiveSegmentHits.size());
+                    for (size_t h = 0; h != segmentHits.size(); ++h)
+                    {
+                        Assert::IsTrue(segmentHits[h].rayDistance == naiveSegmentHits[h].rayDistance);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (AllKNearestNeighbors)
+        {
+            // init a point cloud, with duplicates to exercise ties & self exclusion
+            constexpr int numPoints = 2000;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                if (i % 10 == 0 && i != 0)
+                    pointCloud.push_back(pointCloud[randIndex(pointCloud.size())]);
+                else
+                    pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            for (KDTree::NodeBounds nodeBounds : {KDTree::NodeBounds::None, KDTree::NodeBounds::Full})
+            {
+                KDTree::BuildSettings settings;
+                settings.nodeBounds = nodeBounds;
+                KDTree kdTree(pointCloud, settings);
+
+                constexpr uint32_t k = 8;
+                KDTree::NeighborGraph graph;
+                KDTree::BatchSettings batchSettings;
+                batchSettings.numThreads = 4;
+                kdTree.findAllKNearestNeighbors(k, graph, batchSettings);
+                Assert::IsTrue(graph.offsets.size() == numPoints + 1 && graph.offsets[numPoints] == numPoints * k);
+
+                // naive queries, ties may resolve to either point
+                for (uint32_t i = 0; i != numPoints; ++i)
+                {
+                    std::vector<float> distancesSqr;
+                    for (uint32_t j = 0; j != numPoints; ++j)
+                    {
+                        if (j != i)
+                            distancesSqr.push_back((pointCloud[j] - pointCloud[i]).getLengthSquared());
+                    }
+                    std::sort(distancesSqr.begin(), distancesSqr.end());
+
+                    Assert::IsTrue(graph.offsets[i + 1] - graph.offsets[i] == k);
+                    for (uint32_t n = 0; n != k; ++n)
+                    {
+                        const uint32_t neighbor = graph.neighbors[graph.offsets[i] + n];
+                        Assert::IsTrue(neighbor != i && neighbor < numPoints);
+                        Assert::IsTrue(graph.distancesSqr[graph.offsets[i] + n] == distancesSqr[n]);
+                        Assert::IsTrue((pointCloud[neighbor] - pointCloud[i]).getLengthSquared() == distancesSqr[n]);
+                    }
+                }
+            }
+
+            // fewer points than neighbors asked for
+            std::vector<vec3> smallCloud = {vec3(0.f), vec3(1.f), vec3(2.f)};
+            KDTree smallTree(smallCloud);
+            KDTree::NeighborGraph smallGraph;
+            smallTree.findAllKNearestNeighbors(8, smallGraph);
+            Assert::IsTrue(smallGraph.offsets.back() == 6 && smallGraph.neighbors[0] == 1 && smallGraph.neighbors[1] == 2);
+        }
+
+        TEST_METHOD (PointTypes)
+        {
+            // 2d
+            testNearestNeighbors<kdtree2, vec2>([]() { return vec2(rand01(), rand01()); }, [](const vec2& l, const vec2& r) { return (l - r).getLengthSquared(); });
+
+            // double precision, far from the origin
+            const vec3_64 origin(1.0e7, -1.0e7, 1.0e7);
+            testNearestNeighbors<kdtree3_64, vec3_64>([&origin]() { return origin + vec3_64(rand01(), rand01(), rand01()); }, [](const vec3_64& l, const vec3_64& r) { return (l - r).getLengthSquared(); });
+
+            // indexing the first 2 axes of 3d points
+            testNearestNeighbors<t_kdtree<vec3, 2>, vec3>([]() { return vec3(rand01(), rand01(), rand01()); }, [](const vec3& l, const vec3& r) {
+                const float dx = l.x - r.x;
+                const float dy = l.y - r.y;
+                return dx * dx + dy * dy;
+            });
+
+            // arbitrary dimensions
+            typedef std::array<float, 6> tFeature;
+            testNearestNeighbors<t_kdtree<tFeature, 6>, tFeature>(
+                []() {
+                    tFeature feature;
+                    for (float& f : feature)
+                    {
+                        f = rand01();
+                    }
+                    return feature;
+                },
+                [](const tFeature& l, const tFeature& r) {
+                    float distanceSqr = 0.f;
+                    for (size_t i = 0; i != l.size(); ++i)
+                    {
+                        distanceSqr += (l[i] - r[i]) * (l[i] - r[i]);
+                    }
+                    return distanceSqr;
+                });
+        }
+
+        TEST_METHOD (SaveLoad)
+        {
+            constexpr int numPoints = 4096;
+            const char* path = "KDTreeTests.kdtree";
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            KDTree kdTree(pointCloud);
+            Assert::IsTrue(kdTree.save(path));
+            std::unique_ptr<KDTree> pLoadedTree = KDTree::load(path);
+            Assert::IsTrue(pLoadedTree != nullptr && pLoadedTree->getNumPoints() == numPoints);
+
+            // same point indices from the mapped copy
+            constexpr int testRounds = 256;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                vec3 queryPoint(rand01(), rand01(), rand01());
+                const uint32_t nearestIndex = kdTree.findNearestNeighborIndex(queryPoint);
+                Assert::IsTrue(pLoadedTree->findNearestNeighborIndex(queryPoint) == nearestIndex);
+                Assert::IsTrue(pLoadedTree->findNearestNeighbor(queryPoint)->isEqual(pointCloud[nearestIndex]));
+
+                const vec3* pointsInRadius[64];
+                const vec3* loadedPointsInRadius[64];
+                const uint32_t numInRadius = kdTree.findPointsInRadius(queryPoint, 0.1f, pointsInRadius, 64);
+                Assert::IsTrue(pLoadedTree->findPointsInRadius(queryPoint, 0.1f, loadedPointsInRadius, 64) == numInRadius);
+            }
+
+            // other point types, versions & missing files are rejected
+            Assert::IsTrue(kdtree2::load(path) == nullptr);
+            Assert::IsTrue(kdtree3_64::load(path) == nullptr);
+            pLoadedTree.reset();
+            {
+                std::ofstream damagedFile(path, std::ios::binary | std::ios::in | std::ios::out);
+                damagedFile.seekp(4);
+                damagedFile.put(static_cast<char>(0xff));
+            }
+            Assert::IsTrue(KDTree::load(path) == nullptr);
+            Assert::IsTrue(KDTree::load("missing.kdtree") == nullptr);
+            std::remove(path);
+        }
+
+        TEST_METHOD (EmptyTree)
+        {
+            std::vector<vec3> pointCloud;
+            KDTree kdTree(pointCloud);
+            Assert::IsTrue(kdTree.findNearestNeighbor(vec3(0.f)) == nullptr);
+        }
     };
 } // namespace CoreMathUnitTest
@@ -6,9 +6,27 @@
 
 #include "Matrix4.h"
 #include "Random.h"
+#include "SIMD.h"
+#include <cmath>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+namespace
+{
+    mat4 randomMatrix()
+    {
+        mat4 m;
+        for (int row = 0; row != 4; ++row)
+        {
+            for (int column = 0; column != 4; ++column)
+            {
+                m.data[row][column] = randRange(-2.f, 2.f);
+            }
+        }
+        return m;
+    }
+} // namespace
+
 namespace CoreMathUnitTest
 {
     TEST_CLASS (MatrixTests)
@@ -32,5 +50,82 @@ namespace CoreMathUnitTest
 
             Assert::IsTrue(pointA.isEqual(pointB), outputStream.str().c_str());
         }
+
+        TEST_METHOD (Product)
+        {
+            for (int i = 0, n = 128; i != n; ++i)
+            {
+                const mat4 m1 = randomMatrix();
+                const mat4 m2 = randomMatrix();
+                const mat4 product = m1 * m2;
+                for (int row = 0; row != 4; ++row)
+                {
+                    for (int column = 0; column != 4; ++column)
+                    {
+                        // scalar reference, the template's order
+                        float expected = 0.f;
+                        float magnitude = 0.f;
+                        for (int k = 0; k != 4; ++k)
+                        {
+                            expected += m1.data[row][k] * m2.data[k][column];
+                            magnitude += std::fabs(m1.data[row][k] * m2.data[k][column]);
+                        }
+                        Assert::IsTrue(MathHelpers::isWithinULPs(product.data[row][column], expected, magnitude, SIMD::MaxULPDifference));
+                    }
+                }
+
+                const mat4 identityProduct = mat4() * m1;
+                Assert::IsTrue(memcmp(identityProduct.data, m1.data, sizeof(m1.data)) == 0);
+            }
+
+            // double precision
+            mat4_64 m1;
+            mat4_64 m2;
+            for (int row = 0; row != 4; ++row)
+            {
+                for (int column = 0; column != 4; ++column)
+                {
+                    m1.data[row][column] = row - column + 0.5;
+                    m2.data[row][column] = row * column - 1.25;
+                }
+            }
+            const mat4_64 product = m1 * m2;
+            for (int row = 0; row != 4; ++row)
+            {
+                for (int column = 0; column != 4; ++column)
+                {
+                    double expected = 0.0;
+                    for (int k = 0; k != 4; ++k)
+                    {
+                        expected += m1.data[row][k] * m2.data[k][column];
+                    }
+                    Assert::AreEqual(expected, product.data[row][column]);
+                }
+            }
+        }
+
+        TEST_METHOD (TransformVector)
+        {
+            for (int i = 0, n = 128; i != n; ++i)
+            {
+                const mat4 m = randomMatrix();
+                const vec3 v = randomPointInUnitSphere() * 10.f;
+                const vec3 transformed = m * v;
+                const float coords[3] = {v.x, v.y, v.z};
+                const float results[3] = {transformed.x, transformed.y, transformed.z};
+                for (int row = 0; row != 3; ++row)
+                {
+                    float expected = 0.f;
+                    float magnitude = std::fabs(m.data[row][3]);
+                    for (int k = 0; k != 3; ++k)
+                    {
+                        expected += m.data[row][k] * coords[k];
+                        magnitude += std::fabs(m.data[row][k] * coords[k]);
+                    }
+                    expected += m.data[row][3];
+                    Assert::IsTrue(MathHelpers::isWithinULPs(results[row], expected, magnitude, SIMD::MaxULPDifference));
+                }
+            }
+        }
     };
 } // namespace CoreMathUnitTest
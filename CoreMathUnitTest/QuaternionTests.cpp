@@ -5,8 +5,11 @@
 #include "stdafx.h"
 
 #include "MathHelpers.h"
+#include "Matrix4.h"
 #include "Quaternion.h"
 #include "Random.h"
+#include "SIMD.h"
+#include <cmath>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -48,6 +51,68 @@ namespace CoreMathUnitTest
                 Assert::AreEqual(point.angle(outPoint), angleShift, outputStream.str().c_str());
             }
         }
+
+        TEST_METHOD (Product)
+        {
+            for (int i = 0, n = 128; i != n; ++i)
+            {
+                const quat a = randomRotation();
+                const quat b = randomRotation();
+                const quat product = a * b;
+
+                // scalar reference, the template's order
+                const float expected[4] = {
+                    (a.w * b.w) - (a.x * b.x) - (a.y * b.y) - (a.z * b.z),
+                    (a.w * b.x) + (a.x * b.w) + (a.y * b.z) - (a.z * b.y),
+                    (a.w * b.y) - (a.x * b.z) + (a.y * b.w) + (a.z * b.x),
+                    (a.w * b.z) + (a.x * b.y) - (a.y * b.x) + (a.z * b.w),
+                };
+                const float results[4] = {product.w, product.x, product.y, product.z};
+                for (int component = 0; component != 4; ++component)
+                {
+                    // unit quaternions, the summed magnitudes are at most 2
+                    Assert::IsTrue(MathHelpers::isWithinULPs(results[component], expected[component], 2.f, SIMD::MaxULPDifference));
+                }
+
+                // rotating by a * b rotates by b, then by a
+                const vec3 point = randomPointInUnitSphere();
+                Assert::IsTrue(product.rotateVector(point).isEqual(a.rotateVector(b.rotateVector(point))));
+
+                const quat identityProduct = quat::getIdentity() * a;
+                Assert::IsTrue(identityProduct.w == a.w && identityProduct.x == a.x && identityProduct.y == a.y && identityProduct.z == a.z);
+            }
+        }
+
+        TEST_METHOD (RotateVectorMatchesMatrix)
+        {
+            for (int i = 0, n = 128; i != n; ++i)
+            {
+                const quat rotation = randomRotation();
+                const vec3 point = randomPointInUnitSphere();
+                const vec3 rotated = rotation.rotateVector(point);
+
+                // scalar reference, the template's order
+                const vec3 u(rotation.x, rotation.y, rotation.z);
+                const float uvDot = u.dot(point);
+                const float uuDot = u.dot(u);
+                const vec3 uvCross = u.cross(point);
+                const float coords[3] = {u.x, u.y, u.z};
+                const float pointCoords[3] = {point.x, point.y, point.z};
+                const float crossCoords[3] = {uvCross.x, uvCross.y, uvCross.z};
+                const float results[3] = {rotated.x, rotated.y, rotated.z};
+                for (int axis = 0; axis != 3; ++axis)
+                {
+                    const float terms[3] = {(2.f * uvDot) * coords[axis], ((rotation.w * rotation.w) - uuDot) * pointCoords[axis], (2.f * rotation.w) * crossCoords[axis]};
+                    const float expected = terms[0] + terms[1] + terms[2];
+                    Assert::IsTrue(MathHelpers::isWithinULPs(results[axis], expected, std::fabs(terms[0]) + std::fabs(terms[1]) + std::fabs(terms[2]), SIMD::MaxULPDifference));
+                }
+
+                // & the same rotation as a matrix
+                Assert::IsTrue(rotated.isEqual(mat4(rotation) * point));
+                Assert::IsTrue(MathHelpers::isNearlyEqual(rotated.getLength(), point.getLength()));
+            }
+        }
+
         TEST_METHOD (EulerConversions)
         {
             auto isEqualOrOffByPi = [](float a, float b) { return MathHelpers::isNearlyEqual(a, b) || MathHelpers::isNearlyEqual(std::fabsf(a - b), Pi); };
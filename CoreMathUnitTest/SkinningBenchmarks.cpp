@@ -0,0 +1,180 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BenchmarkHelpers.h"
+#include "Random.h"
+#include "SIMD.h"
+#include "Skinning.h"
+#include "TransformBatch.h"
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // per vertex bones of the naive loop, array of structures
+    struct Vertex
+    {
+        vec3 position;
+        uint32_t boneIndices[skin_influences::MaxInfluences];
+        float weights[skin_influences::MaxInfluences];
+    };
+
+    // a mesh skinned by 64 bones, 4 per vertex: a per vertex loop over array of structures vertices against the
+    // batch versions, forced to scalar, at the supported level & parallel
+    void runSkinning(int numVertices, int numPasses, std::wstringstream& outputStream)
+    {
+        const uint32_t numBones = 64;
+        std::vector<mat4> matrices(numBones);
+        std::vector<dual_quat> dualQuats(numBones);
+        for (uint32_t bone = 0; bone != numBones; ++bone)
+        {
+            const transform t(randomPointInUnitSphere(), randomRotation(), vec3(1.f));
+            matrices[bone] = TransformBatch::getMatrix(t);
+            dualQuats[bone] = dual_quat(t);
+        }
+
+        std::vector<Vertex> vertices(numVertices);
+        std::vector<vec3> points(numVertices);
+        skin_influences influences(numVertices);
+        for (int i = 0; i != numVertices; ++i)
+        {
+            vertices[i].position = points[i] = randomPointInUnitSphere();
+            for (int slot = 0; slot != skin_influences::MaxInfluences; ++slot)
+            {
+                influences.set(i, slot, randIndex(numBones), randRange(0.1f, 1.f));
+            }
+        }
+        influences.normalizeWeights();
+        for (int i = 0; i != numVertices; ++i)
+        {
+            for (int slot = 0; slot != skin_influences::MaxInfluences; ++slot)
+            {
+                vertices[i].boneIndices[slot] = influences.getIndices(slot)[i];
+                vertices[i].weights[slot] = influences.getWeights(slot)[i];
+            }
+        }
+        const vec3_soa soaPoints(points);
+        vec3_soa outPoints;
+        std::vector<vec3> loopPoints(numVertices);
+
+        // weighted sum of each bone's transformed point
+        tClock::time_point start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numVertices; ++i)
+            {
+                const Vertex& vertex = vertices[i];
+                vec3 sum(0.f);
+                for (int slot = 0; slot != skin_influences::MaxInfluences; ++slot)
+                {
+                    vec3 moved = matrices[vertex.boneIndices[slot]] * vertex.position;
+                    moved *= vertex.weights[slot];
+                    sum += moved;
+                }
+                loopPoints[i] = sum;
+            }
+        }
+        const double linearLoopMs = getElapsedMs(start);
+
+        SIMD::forceLevel(SIMD::Level::Scalar);
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinLinear(matrices.data(), influences, soaPoints, outPoints);
+        }
+        const double linearScalarMs = getElapsedMs(start);
+        SIMD::resetLevel();
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinLinear(matrices.data(), influences, soaPoints, outPoints);
+        }
+        const double linearMs = getElapsedMs(start);
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinLinearParallel(matrices.data(), influences, soaPoints, outPoints);
+        }
+        const double linearParallelMs = getElapsedMs(start);
+
+        float maxError = 0.f;
+        for (int i = 0; i < numVertices; i += 64)
+        {
+            maxError = std::max(maxError, (outPoints.get(i) - loopPoints[i]).getLength());
+        }
+
+        // dual quaternions blended & applied per vertex
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numVertices; ++i)
+            {
+                const Vertex& vertex = vertices[i];
+                loopPoints[i] = Skinning::skinDualQuat(dualQuats.data(), vertex.boneIndices, vertex.weights, vertex.position);
+            }
+        }
+        const double dualQuatLoopMs = getElapsedMs(start);
+
+        SIMD::forceLevel(SIMD::Level::Scalar);
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinDualQuat(dualQuats.data(), influences, soaPoints, outPoints);
+        }
+        const double dualQuatScalarMs = getElapsedMs(start);
+        SIMD::resetLevel();
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinDualQuat(dualQuats.data(), influences, soaPoints, outPoints);
+        }
+        const double dualQuatMs = getElapsedMs(start);
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            Skinning::skinDualQuatParallel(dualQuats.data(), influences, soaPoints, outPoints);
+        }
+        const double dualQuatParallelMs = getElapsedMs(start);
+
+        for (int i = 0; i < numVertices; i += 64)
+        {
+            maxError = std::max(maxError, (outPoints.get(i) - loopPoints[i]).getLength());
+        }
+
+        outputStream << "Vertices: " << numVertices << ", passes: " << numPasses << ", level: " << SIMD::getLevelName(SIMD::getLevel()) << "\n"
+                     << "Linear blend per vertex loop: " << linearLoopMs << " ms\n"
+                     << "Linear blend scalar: " << linearScalarMs << " ms, " << linearLoopMs / linearScalarMs << "x\n"
+                     << "Linear blend: " << linearMs << " ms, " << linearLoopMs / linearMs << "x\n"
+                     << "Linear blend parallel: " << linearParallelMs << " ms, " << linearLoopMs / linearParallelMs << "x\n"
+                     << "Dual quaternion per vertex loop: " << dualQuatLoopMs << " ms\n"
+                     << "Dual quaternion scalar: " << dualQuatScalarMs << " ms, " << dualQuatLoopMs / dualQuatScalarMs << "x\n"
+                     << "Dual quaternion: " << dualQuatMs << " ms, " << dualQuatLoopMs / dualQuatMs << "x\n"
+                     << "Dual quaternion parallel: " << dualQuatParallelMs << " ms, " << dualQuatLoopMs / dualQuatParallelMs << "x, max difference " << maxError << "\n";
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (SkinningBenchmarks)
+    {
+      public:
+        TEST_METHOD (SkinningTime)
+        {
+            std::wstringstream outputStream;
+            outputStream << "\n";
+            for (int numVertices : {1 << 12, 1 << 18})
+            {
+                runSkinning(numVertices, (1 << 22) / numVertices, outputStream);
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+    };
+} // namespace CoreMathUnitTest
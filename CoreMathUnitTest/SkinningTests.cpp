@@ -0,0 +1,292 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BatchTestHelpers.h"
+#include "Random.h"
+#include "SIMD.h"
+#include "Skinning.h"
+#include "TransformBatch.h"
+#include <cstdint>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // squared distance skinned points may be off from per vertex math, points within 10 & translations within 5
+    constexpr float Epsilon = 1e-7f;
+    constexpr uint32_t NumBones = 24;
+
+    transform randomRigidTransform()
+    {
+        return transform(randomPointInUnitSphere() * 5.f, randomRotation(), vec3(1.f));
+    }
+
+    // 1 to 4 bones per vertex, normalized weights
+    skin_influences randomInfluences(uint32_t count)
+    {
+        skin_influences influences(count);
+        for (uint32_t vertex = 0; vertex != count; ++vertex)
+        {
+            const int numBones = 1 + int(randIndex(skin_influences::MaxInfluences));
+            for (int slot = 0; slot != numBones; ++slot)
+            {
+                influences.set(vertex, slot, randIndex(NumBones), randRange(0.1f, 1.f));
+            }
+        }
+        influences.normalizeWeights();
+        return influences;
+    }
+
+    void getInfluences(const skin_influences& influences, uint32_t vertex, uint32_t* outBoneIndices, float* outWeights)
+    {
+        for (int slot = 0; slot != skin_influences::MaxInfluences; ++slot)
+        {
+            outBoneIndices[slot] = influences.getIndices(slot)[vertex];
+            outWeights[slot] = influences.getWeights(slot)[vertex];
+        }
+    }
+
+    // in & out of place
+    template <class PALETTE, class SKIN, class REFERENCE>
+    void checkSkinning(const std::vector<PALETTE>& palette, const SKIN& skin, const REFERENCE& reference)
+    {
+        for (uint32_t count : BatchTestCounts)
+        {
+            const std::vector<vec3> points = randomPoints(count);
+            const skin_influences influences = randomInfluences(count);
+            const vec3_soa soaPoints(points);
+            vec3_soa outPoints;
+            skin(palette.data(), influences, soaPoints, outPoints);
+            Assert::AreEqual(count, outPoints.getSize());
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                uint32_t boneIndices[skin_influences::MaxInfluences];
+                float weights[skin_influences::MaxInfluences];
+                getInfluences(influences, i, boneIndices, weights);
+                Assert::IsTrue(outPoints.get(i).isEqual(reference(palette.data(), boneIndices, weights, points[i]), Epsilon));
+            }
+
+            vec3_soa inPlace(points);
+            skin(palette.data(), influences, inPlace, inPlace);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(inPlace.get(i), outPoints.get(i)));
+            }
+        }
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (SkinningTests)
+    {
+      public:
+        TEST_METHOD (DualQuaternions)
+        {
+            for (int i = 0; i != 16; ++i)
+            {
+                // rigid transforms move points & vectors the same either way
+                const transform t = randomRigidTransform();
+                const dual_quat dq(t);
+                const vec3 point = randomPointInUnitSphere() * 10.f;
+                Assert::IsTrue(dq.transformPoint(point).isEqual(t.transformPoint(point), Epsilon));
+                Assert::IsTrue(dq.transformVector(point).isEqual(t.transformVector(point), Epsilon));
+
+                // q & -q are the same transform
+                dual_quat negated(quat(-dq.real.w, -dq.real.x, -dq.real.y, -dq.real.z), quat(-dq.dual.w, -dq.dual.x, -dq.dual.y, -dq.dual.z));
+                Assert::IsTrue(negated.transformPoint(point).isEqual(dq.transformPoint(point), Epsilon));
+
+                // rotation then translation
+                const vec3 translation = randomPointInUnitSphere() * 5.f;
+                const dual_quat rotateTranslate(t.rotation, translation);
+                Assert::IsTrue(rotateTranslate.getTranslation().isEqual(translation, Epsilon));
+                Assert::IsTrue(rotateTranslate.transformPoint(point).isEqual(t.rotation.rotateVector(point) + translation, Epsilon));
+
+                // scaled parts normalize back
+                dual_quat scaled(quat(3.f * dq.real.w, 3.f * dq.real.x, 3.f * dq.real.y, 3.f * dq.real.z), quat(3.f * dq.dual.w, 3.f * dq.dual.x, 3.f * dq.dual.y, 3.f * dq.dual.z));
+                scaled.normalize();
+                Assert::IsTrue(scaled.transformPoint(point).isEqual(dq.transformPoint(point), Epsilon));
+            }
+            Assert::IsTrue(dual_quat::getIdentity().transformPoint(vec3(1.f, 2.f, 3.f)).isEqual(vec3(1.f, 2.f, 3.f), Epsilon));
+        }
+
+        TEST_METHOD (Influences)
+        {
+            skin_influences influences(3);
+            influences.set(0, 0, 5, 2.f);
+            influences.set(0, 1, 7, 6.f);
+            influences.set(2, 0, 1, 0.5f);
+            influences.normalizeWeights();
+            Assert::AreEqual(0.25f, influences.getWeights(0)[0]);
+            Assert::AreEqual(0.75f, influences.getWeights(1)[0]);
+            Assert::AreEqual(0.f, influences.getWeights(0)[1]);
+            Assert::AreEqual(1.f, influences.getWeights(0)[2]);
+
+            // kept per slot through resizes, new vertices without bones
+            influences.resize(5);
+            Assert::AreEqual(5u, influences.getSize());
+            Assert::AreEqual(7u, influences.getIndices(1)[0]);
+            Assert::AreEqual(0.75f, influences.getWeights(1)[0]);
+            Assert::AreEqual(1u, influences.getIndices(0)[2]);
+            Assert::AreEqual(0.f, influences.getWeights(0)[4]);
+            influences.resize(1);
+            Assert::AreEqual(5u, influences.getIndices(0)[0]);
+            Assert::AreEqual(0.75f, influences.getWeights(1)[0]);
+        }
+
+        TEST_METHOD (LinearBlend)
+        {
+            std::vector<mat4> palette(NumBones);
+            for (mat4& m : palette)
+            {
+                m = TransformBatch::getMatrix(transform(randomPointInUnitSphere() * 5.f, randomRotation(), vec3(randRange(0.5f, 2.f), randRange(0.5f, 2.f), randRange(0.5f, 2.f))));
+            }
+
+            // weighted sum of each bone's transformed point
+            auto reference = [](const mat4* bones, const uint32_t* boneIndices, const float* weights, const vec3& point) {
+                vec3 sum(0.f);
+                for (int slot = 0; slot != skin_influences::MaxInfluences; ++slot)
+                {
+                    vec3 moved = bones[boneIndices[slot]] * point;
+                    moved *= weights[slot];
+                    sum += moved;
+                }
+                return sum;
+            };
+            auto skin = [](const mat4* bones, const skin_influences& influences, const vec3_soa& points, vec3_soa& outPoints) { Skinning::skinLinear(bones, influences, points, outPoints); };
+
+            // every level the machine supports
+            for (SIMD::Level level : {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512})
+            {
+                SIMD::forceLevel(level);
+                checkSkinning(palette, skin, reference);
+            }
+            SIMD::resetLevel();
+
+            // single bones match TransformBatch
+            const std::vector<vec3> points = randomPoints(50);
+            skin_influences influences(50);
+            for (uint32_t i = 0; i != 50; ++i)
+            {
+                influences.set(i, 0, 3, 1.f);
+            }
+            vec3_soa skinned, transformed;
+            Skinning::skinLinear(palette.data(), influences, vec3_soa(points), skinned);
+            TransformBatch::transformPoints(palette[3], vec3_soa(points), transformed);
+            for (uint32_t i = 0; i != 50; ++i)
+            {
+                Assert::IsTrue(skinned.get(i).isEqual(transformed.get(i), Epsilon));
+            }
+        }
+
+        TEST_METHOD (DualQuaternionBlend)
+        {
+            std::vector<transform> transforms(NumBones);
+            std::vector<dual_quat> palette(NumBones);
+            for (uint32_t bone = 0; bone != NumBones; ++bone)
+            {
+                transforms[bone] = randomRigidTransform();
+                palette[bone] = dual_quat(transforms[bone]);
+                // either sign of a bone is the same transform, blends must not depend on it
+                if (coinFlip())
+                {
+                    palette[bone].real = quat(-palette[bone].real.w, -palette[bone].real.x, -palette[bone].real.y, -palette[bone].real.z);
+                    palette[bone].dual = quat(-palette[bone].dual.w, -palette[bone].dual.x, -palette[bone].dual.y, -palette[bone].dual.z);
+                }
+            }
+
+            auto reference = [](const dual_quat* bones, const uint32_t* boneIndices, const float* weights, const vec3& point) { return Skinning::skinDualQuat(bones, boneIndices, weights, point); };
+            auto skin = [](const dual_quat* bones, const skin_influences& influences, const vec3_soa& points, vec3_soa& outPoints) { Skinning::skinDualQuat(bones, influences, points, outPoints); };
+            for (SIMD::Level level : {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512})
+            {
+                SIMD::forceLevel(level);
+                checkSkinning(palette, skin, reference);
+            }
+            SIMD::resetLevel();
+
+            // single bones are rigid transforms, blends of one bone with itself too
+            for (uint32_t bone = 0; bone != NumBones; ++bone)
+            {
+                const uint32_t boneIndices[skin_influences::MaxInfluences] = {bone, bone, bone, 0};
+                const float single[skin_influences::MaxInfluences] = {1.f, 0.f, 0.f, 0.f};
+                const float split[skin_influences::MaxInfluences] = {0.5f, 0.3f, 0.2f, 0.f};
+                const vec3 point = randomPointInUnitSphere() * 10.f;
+                Assert::IsTrue(Skinning::skinDualQuat(palette.data(), boneIndices, single, point).isEqual(transforms[bone].transformPoint(point), Epsilon));
+                Assert::IsTrue(Skinning::skinDualQuat(palette.data(), boneIndices, split, point).isEqual(transforms[bone].transformPoint(point), Epsilon));
+            }
+
+            // a point half way between two bones' rotations keeps its distance from the joint, linear blending shrinks it
+            const dual_quat twist[2] = {dual_quat::getIdentity(), dual_quat(quat(3.f, 0.f, 0.f), vec3(0.f))};
+            const mat4 twistMatrices[2] = {mat4(), mat4(twist[1].real)};
+            const uint32_t boneIndices[skin_influences::MaxInfluences] = {0, 1, 0, 0};
+            const float weights[skin_influences::MaxInfluences] = {0.5f, 0.5f, 0.f, 0.f};
+            const vec3 point(0.f, 1.f, 0.f);
+            Assert::AreEqual(1.f, Skinning::skinDualQuat(twist, boneIndices, weights, point).getLength(), 1e-5f);
+            Assert::IsTrue(Skinning::skinLinear(twistMatrices, boneIndices, weights, point).getLength() < 0.1f);
+        }
+
+        TEST_METHOD (ZeroWeights)
+        {
+            // vertices without weights have no blended rotation to normalize, dual quaternion skinning leaves them in place
+            std::vector<dual_quat> palette(NumBones);
+            for (dual_quat& bone : palette)
+            {
+                bone = dual_quat(randomRigidTransform());
+            }
+            const uint32_t count = 37;
+            const std::vector<vec3> points = randomPoints(count);
+            const skin_influences influences(count);
+            const vec3_soa soaPoints(points);
+            for (SIMD::Level level : {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512})
+            {
+                SIMD::forceLevel(level);
+                vec3_soa outPoints;
+                Skinning::skinDualQuat(palette.data(), influences, soaPoints, outPoints);
+                for (uint32_t i = 0; i != count; ++i)
+                {
+                    Assert::IsTrue(isSame(outPoints.get(i), points[i]));
+                }
+            }
+            SIMD::resetLevel();
+
+            const uint32_t boneIndices[skin_influences::MaxInfluences] = {0, 1, 2, 3};
+            const float weights[skin_influences::MaxInfluences] = {0.f, 0.f, 0.f, 0.f};
+            Assert::IsTrue(isSame(Skinning::skinDualQuat(palette.data(), boneIndices, weights, points[0]), points[0]));
+        }
+
+        TEST_METHOD (Parallel)
+        {
+            const uint32_t count = getParallelTestCount(Skinning::ParallelBlockSize);
+            const vec3_soa points(randomPoints(count));
+            const skin_influences influences = randomInfluences(count);
+            std::vector<mat4> matrices(NumBones);
+            std::vector<dual_quat> dualQuats(NumBones);
+            for (uint32_t bone = 0; bone != NumBones; ++bone)
+            {
+                const transform t = randomRigidTransform();
+                matrices[bone] = TransformBatch::getMatrix(t);
+                dualQuats[bone] = dual_quat(t);
+            }
+
+            vec3_soa serial, parallel;
+            Skinning::skinLinear(matrices.data(), influences, points, serial);
+            Skinning::skinLinearParallel(matrices.data(), influences, points, parallel, 4);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(parallel.get(i), serial.get(i)));
+            }
+
+            Skinning::skinDualQuat(dualQuats.data(), influences, points, serial);
+            vec3_soa inPlace = points;
+            Skinning::skinDualQuatParallel(dualQuats.data(), influences, inPlace, inPlace);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(inPlace.get(i), serial.get(i)));
+            }
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,205 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "Random.h"
+#include "SpatialHashGrid.h"
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    typedef std::unordered_map<hashgrid3::tPointId, vec3> tReferencePoints;
+
+    // naive squared distances over the reference set, closest first
+    std::vector<float> findSortedDistancesSqr(const tReferencePoints& referencePoints, const vec3& queryPoint)
+    {
+        std::vector<float> distancesSqr;
+        for (const auto& idAndPoint : referencePoints)
+        {
+            distancesSqr.push_back((idAndPoint.second - queryPoint).getLengthSquared());
+        }
+        std::sort(distancesSqr.begin(), distancesSqr.end());
+        return distancesSqr;
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (SpatialHashGridTests)
+    {
+      public:
+        TEST_METHOD (InsertRemoveUpdate)
+        {
+            // start from a point cloud, then churn it
+            constexpr int numPoints = 512;
+            std::vector<vec3> pointCloud;
+            pointCloud.reserve(numPoints);
+            for (int i = 0; i != numPoints; ++i)
+            {
+                pointCloud.push_back(vec3(rand01(), rand01(), rand01()));
+            }
+
+            hashgrid3 grid(0.1f, pointCloud);
+            tReferencePoints referencePoints;
+            for (int i = 0; i != numPoints; ++i)
+            {
+                referencePoints[i] = pointCloud[i];
+            }
+
+            std::vector<hashgrid3::Neighbor> neighbors(8);
+            constexpr int testRounds = 4096;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                // random operation, points may leave the unit cube & the cells seen so far
+                const float operation = rand01();
+                if (operation < 0.4f || referencePoints.empty())
+                {
+                    const vec3 point(rand01(), rand01(), rand01());
+                    referencePoints[grid.insert(point)] = point;
+                }
+                else
+                {
+                    auto it = referencePoints.begin();
+                    std::advance(it, randIndex(referencePoints.size()));
+                    if (operation < 0.7f)
+                    {
+                        Assert::IsTrue(grid.remove(it->first));
+                        Assert::IsFalse(grid.isValid(it->first));
+                        Assert::IsFalse(grid.remove(it->first));
+                        referencePoints.erase(it);
+                    }
+                    else
+                    {
+                        it->second = vec3(randRange(-0.5f, 1.5f), rand01(), rand01());
+                        Assert::IsTrue(grid.updatePosition(it->first, it->second));
+                    }
+                }
+                if (i % 1024 == 0)
+                    grid.rebuild();
+                Assert::AreEqual(uint32_t(referencePoints.size()), grid.getNumPoints());
+
+                // queries stay valid after every operation, inside & outside the points
+                const vec3 queryPoint(randRange(-1.f, 2.f), rand01(), rand01());
+                const std::vector<float> naiveDistancesSqr = findSortedDistancesSqr(referencePoints, queryPoint);
+                const hashgrid3::tPointId nearestId = grid.findNearestNeighbor(queryPoint);
+                Assert::IsTrue(referencePoints.count(nearestId) == 1);
+                Assert::IsTrue(grid.getPosition(nearestId).isEqual(referencePoints[nearestId]));
+
+                std::wstringstream outputStream;
+                outputStream << "\n"
+                             << "Round: " << i << "\n"
+                             << "Query: " << queryPoint;
+                Assert::AreEqual(naiveDistancesSqr[0], (referencePoints[nearestId] - queryPoint).getLengthSquared(), outputStream.str().c_str());
+
+                // k nearest come back sorted, live & at the naive distances
+                const uint32_t numFound = grid.findKNearestNeighbors(queryPoint, 8, neighbors.data());
+                Assert::AreEqual(std::min(uint32_t(8), uint32_t(referencePoints.size())), numFound);
+                for (uint32_t j = 0; j != numFound; ++j)
+                {
+                    Assert::IsTrue(referencePoints.count(neighbors[j].id) == 1);
+                    Assert::AreEqual(naiveDistancesSqr[j], neighbors[j].distanceSqr, outputStream.str().c_str());
+                }
+            }
+        }
+
+        TEST_METHOD (RadiusSearch)
+        {
+            // 2D, with removals leaving free slots behind
+            hashgrid2 grid(0.05f);
+            std::unordered_map<hashgrid2::tPointId, vec2> referencePoints;
+            constexpr int numPoints = 1024;
+            for (int i = 0; i != numPoints; ++i)
+            {
+                const vec2 point(rand01(), rand01());
+                referencePoints[grid.insert(point)] = point;
+            }
+            for (hashgrid2::tPointId id = 0; id < numPoints; id += 2)
+            {
+                grid.remove(id);
+                referencePoints.erase(id);
+            }
+
+            std::vector<hashgrid2::tPointId> bufferResults(numPoints);
+            constexpr int testRounds = 64;
+            for (int i = 0; i != testRounds; ++i)
+            {
+                // radii from well within a cell to wider than the whole grid
+                const vec2 queryPoint(rand01(), rand01());
+                const float radius = (i % 8 == 0) ? randRange(1.f, 2.f) : randRange(0.f, 0.3f);
+
+                std::vector<hashgrid2::tPointId> naiveResults;
+                for (const auto& idAndPoint : referencePoints)
+                {
+                    if ((idAndPoint.second - queryPoint).getLengthSquared() < radius * radius)
+                        naiveResults.push_back(idAndPoint.first);
+                }
+
+                std::vector<hashgrid2::tPointId> gridResults;
+                grid.findPointsInRadius(queryPoint, radius, [](hashgrid2::tPointId id, const vec2& point, void* pUserData) { static_cast<std::vector<hashgrid2::tPointId>*>(pUserData)->push_back(id); }, &gridResults);
+
+                std::sort(naiveResults.begin(), naiveResults.end());
+                std::sort(gridResults.begin(), gridResults.end());
+                Assert::IsTrue(naiveResults == gridResults);
+
+                const uint32_t numFound = grid.findPointsInRadius(queryPoint, radius, bufferResults.data(), numPoints);
+                bufferResults.resize(numFound);
+                std::sort(bufferResults.begin(), bufferResults.end());
+                Assert::IsTrue(naiveResults == bufferResults);
+                bufferResults.resize(numPoints);
+            }
+
+            // radii beyond any cell index find every point
+            for (float radius : {1e30f, std::numeric_limits<float>::infinity()})
+            {
+                Assert::AreEqual(uint32_t(referencePoints.size()), grid.findPointsInRadius(vec2(0.5f, 0.5f), radius, bufferResults.data(), numPoints));
+            }
+        }
+
+        TEST_METHOD (SparseAndEmptyGrids)
+        {
+            // empty grids find nothing
+            hashgrid3 grid(1.f);
+            std::vector<hashgrid3::Neighbor> neighbors;
+            Assert::IsTrue(grid.findNearestNeighbor(vec3(0.f)) == hashgrid3::InvalidId);
+            grid.findKNearestNeighbors(vec3(0.f), 4, neighbors);
+            Assert::IsTrue(neighbors.empty());
+
+            // few points, cells far smaller than their spacing
+            tReferencePoints referencePoints;
+            for (int i = 0; i != 16; ++i)
+            {
+                const vec3 point(randRange(-1000.f, 1000.f), randRange(-1000.f, 1000.f), randRange(-1000.f, 1000.f));
+                referencePoints[grid.insert(point)] = point;
+            }
+            for (int i = 0; i != 64; ++i)
+            {
+                const vec3 queryPoint(randRange(-2000.f, 2000.f), randRange(-2000.f, 2000.f), randRange(-2000.f, 2000.f));
+                const std::vector<float> naiveDistancesSqr = findSortedDistancesSqr(referencePoints, queryPoint);
+                const hashgrid3::tPointId nearestId = grid.findNearestNeighbor(queryPoint);
+                Assert::AreEqual(naiveDistancesSqr[0], (referencePoints[nearestId] - queryPoint).getLengthSquared());
+
+                grid.findKNearestNeighbors(queryPoint, 32, neighbors);
+                Assert::AreEqual(size_t(16), neighbors.size());
+                for (size_t j = 0; j != neighbors.size(); ++j)
+                {
+                    Assert::AreEqual(naiveDistancesSqr[j], neighbors[j].distanceSqr);
+                }
+            }
+
+            // removing every point empties it again
+            for (const auto& idAndPoint : referencePoints)
+            {
+                Assert::IsTrue(grid.remove(idAndPoint.first));
+            }
+            Assert::AreEqual(uint32_t(0), grid.getNumPoints());
+            Assert::IsTrue(grid.findNearestNeighbor(vec3(0.f)) == hashgrid3::InvalidId);
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,102 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BenchmarkHelpers.h"
+#include "Random.h"
+#include "TransformBatch.h"
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // one transform applied to a point cloud: per point calls against the batch versions
+    void runTransformPoints(int numPoints, int numPasses, std::wstringstream& outputStream)
+    {
+        std::vector<vec3> points(numPoints);
+        for (vec3& point : points)
+        {
+            point = randomPointInUnitSphere();
+        }
+        const transform t(randomPointInUnitSphere(), randomRotation(), vec3(2.f));
+        const mat4 m = TransformBatch::getMatrix(t);
+
+        std::vector<vec3> outPoints(numPoints);
+        tClock::time_point start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numPoints; ++i)
+            {
+                outPoints[i] = t.transformPoint(points[i]);
+            }
+        }
+        const double transformMs = getElapsedMs(start);
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numPoints; ++i)
+            {
+                outPoints[i] = m * points[i];
+            }
+        }
+        const double matrixMs = getElapsedMs(start);
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            TransformBatch::transformPoints(t, points.data(), numPoints, outPoints.data());
+        }
+        const double batchMs = getElapsedMs(start);
+
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            TransformBatch::transformPointsParallel(t, points.data(), numPoints, outPoints.data());
+        }
+        const double parallelMs = getElapsedMs(start);
+
+        const vec3_soa soaPoints(points);
+        vec3_soa soaOutPoints;
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            TransformBatch::transformPoints(t, soaPoints, soaOutPoints);
+        }
+        const double soaMs = getElapsedMs(start);
+
+        float maxError = 0.f;
+        for (int i = 0; i < numPoints; i += 64)
+        {
+            maxError = std::max(maxError, (soaOutPoints.get(i) - t.transformPoint(points[i])).getLength());
+        }
+
+        outputStream << "Points: " << numPoints << ", passes: " << numPasses << "\n"
+                     << "transform::transformPoint loop: " << transformMs << " ms\n"
+                     << "mat4 * vec3 loop: " << matrixMs << " ms, " << transformMs / matrixMs << "x\n"
+                     << "Batch AoS: " << batchMs << " ms, " << transformMs / batchMs << "x\n"
+                     << "Batch AoS parallel: " << parallelMs << " ms, " << transformMs / parallelMs << "x\n"
+                     << "Batch SoA: " << soaMs << " ms, " << transformMs / soaMs << "x, max difference " << maxError << "\n";
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (TransformBatchBenchmarks)
+    {
+      public:
+        TEST_METHOD (TransformPointsTime)
+        {
+            std::wstringstream outputStream;
+            outputStream << "\n";
+            for (int numPoints : {1 << 12, 1 << 20})
+            {
+                runTransformPoints(numPoints, (1 << 24) / numPoints, outputStream);
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+    };
+} // namespace CoreMathUnitTest
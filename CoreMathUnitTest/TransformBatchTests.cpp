@@ -0,0 +1,136 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BatchTestHelpers.h"
+#include "Random.h"
+#include "TransformBatch.h"
+#include <cstdint>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // squared distance the batch may be off from per point math, points within 10 & scales within 2
+    constexpr float Epsilon = 1e-8f;
+
+    transform randomTransform()
+    {
+        return transform(randomPointInUnitSphere() * 5.f, randomRotation(), vec3(randRange(0.5f, 2.f), randRange(0.5f, 2.f), randRange(0.5f, 2.f)));
+    }
+
+    // batch results of a source against its per point functions, aos & soa, in & out of place
+    template <class SOURCE, class POINT_FUNC, class VECTOR_FUNC>
+    void checkSource(const SOURCE& source, const POINT_FUNC& transformPoint, const VECTOR_FUNC& transformVector)
+    {
+        for (uint32_t count : BatchTestCounts)
+        {
+            const std::vector<vec3> points = randomPoints(count);
+            std::vector<vec3> outPoints(count), outVectors(count);
+            TransformBatch::transformPoints(source, points.data(), count, outPoints.data());
+            TransformBatch::transformVectors(source, points.data(), count, outVectors.data());
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(outPoints[i].isEqual(transformPoint(points[i]), Epsilon));
+                Assert::IsTrue(outVectors[i].isEqual(transformVector(points[i]), Epsilon));
+            }
+
+            // soa runs the same kernels
+            const vec3_soa soaPoints(points);
+            vec3_soa soaOutPoints, soaOutVectors;
+            TransformBatch::transformPoints(source, soaPoints, soaOutPoints);
+            TransformBatch::transformVectors(source, soaPoints, soaOutVectors);
+            Assert::AreEqual(count, soaOutPoints.getSize());
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(soaOutPoints.get(i), outPoints[i]));
+                Assert::IsTrue(isSame(soaOutVectors.get(i), outVectors[i]));
+            }
+
+            // in place
+            std::vector<vec3> inPlace = points;
+            TransformBatch::transformPoints(source, inPlace.data(), count, inPlace.data());
+            vec3_soa soaInPlace(points);
+            TransformBatch::transformPoints(source, soaInPlace, soaInPlace);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(inPlace[i], outPoints[i]));
+                Assert::IsTrue(isSame(soaInPlace.get(i), outPoints[i]));
+            }
+        }
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (TransformBatchTests)
+    {
+      public:
+        TEST_METHOD (Transforms)
+        {
+            for (int i = 0; i != 16; ++i)
+            {
+                const transform t = randomTransform();
+                checkSource(t, [&](const vec3& p) { return t.transformPoint(p); }, [&](const vec3& v) { return t.transformVector(v); });
+            }
+            const transform& identity = transform::getIdentity();
+            checkSource(identity, [](const vec3& p) { return p; }, [](const vec3& v) { return v; });
+        }
+
+        TEST_METHOD (Poses)
+        {
+            for (int i = 0; i != 16; ++i)
+            {
+                const pose p(randomPointInUnitSphere() * 5.f, randomRotation(), randRange(0.5f, 2.f));
+                checkSource(p, [&](const vec3& point) { return p.transformPoint(point); }, [&](const vec3& v) { return p.transformVector(v); });
+            }
+        }
+
+        TEST_METHOD (Matrices)
+        {
+            for (int i = 0; i != 16; ++i)
+            {
+                // the matrix of a transform, applied as is
+                const mat4 m = TransformBatch::getMatrix(randomTransform());
+                checkSource(m, [&](const vec3& p) { return m * p; }, [&](const vec3& v) { return m * v - m * vec3(0.f); });
+            }
+        }
+
+        TEST_METHOD (Parallel)
+        {
+            const uint32_t count = getParallelTestCount(TransformBatch::ParallelBlockSize);
+            const std::vector<vec3> points = randomPoints(count);
+            const transform t = randomTransform();
+
+            std::vector<vec3> serial(count), parallel(count);
+            TransformBatch::transformPoints(t, points.data(), count, serial.data());
+            TransformBatch::transformPointsParallel(t, points.data(), count, parallel.data(), 4);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(parallel[i], serial[i]));
+            }
+
+            TransformBatch::transformVectors(t, points.data(), count, serial.data());
+            TransformBatch::transformVectorsParallel(t, points.data(), count, parallel.data());
+            const vec3_soa soaPoints(points);
+            vec3_soa soaVectors;
+            TransformBatch::transformVectorsParallel(t, soaPoints, soaVectors, 3);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(parallel[i], serial[i]));
+                Assert::IsTrue(isSame(soaVectors.get(i), serial[i]));
+            }
+
+            vec3_soa soaInPlace(points);
+            TransformBatch::transformPointsParallel(t, soaInPlace, soaInPlace);
+            TransformBatch::transformPoints(t, points.data(), count, serial.data());
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                Assert::IsTrue(isSame(soaInPlace.get(i), serial[i]));
+            }
+        }
+    };
+} // namespace CoreMathUnitTest
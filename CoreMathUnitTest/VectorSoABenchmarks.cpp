@@ -0,0 +1,201 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "BenchmarkHelpers.h"
+#include "Random.h"
+#include "SIMD.h"
+#include "VectorSoA.h"
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    vec3 randomVec3()
+    {
+        return vec3(randRange(-1.f, 1.f), randRange(-1.f, 1.f), randRange(-1.f, 1.f));
+    }
+
+    // a particle step: integrate, then measure & normalize velocities
+    void runParticlePasses(int numParticles, int numPasses, std::wstringstream& outputStream)
+    {
+        constexpr float deltaTime = 1.f / 60.f;
+        std::vector<vec3> positions(numParticles);
+        std::vector<vec3> velocities(numParticles);
+        for (int i = 0; i != numParticles; ++i)
+        {
+            positions[i] = vec3(rand01(), rand01(), rand01());
+            velocities[i] = randomVec3();
+        }
+
+        std::vector<vec3> aosPositions = positions;
+        std::vector<vec3> aosDirections(numParticles);
+        std::vector<float> aosSpeeds(numParticles);
+        tClock::time_point start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numParticles; ++i)
+            {
+                aosPositions[i] += velocities[i] * deltaTime;
+                aosSpeeds[i] = velocities[i].getLength();
+                aosDirections[i] = velocities[i].getUnit();
+            }
+        }
+        const double aosMs = getElapsedMs(start);
+
+        start = tClock::now();
+        vec3_soa soaPositions(positions);
+        const vec3_soa soaVelocities(velocities);
+        const double transposeMs = getElapsedMs(start);
+        vec3_soa soaDirections;
+        vec3_soa step;
+        std::vector<float> soaSpeeds(numParticles);
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            VectorSoA::scale(soaVelocities, deltaTime, step);
+            VectorSoA::add(soaPositions, step, soaPositions);
+            VectorSoA::length(soaVelocities, soaSpeeds.data());
+            VectorSoA::normalize(soaVelocities, soaDirections);
+        }
+        const double soaMs = getElapsedMs(start);
+
+        // same results either way
+        float maxError = 0.f;
+        for (int i = 0; i < numParticles; i += 64)
+        {
+            maxError = std::max(maxError, (soaPositions.get(i) - aosPositions[i]).getLength());
+            maxError = std::max(maxError, (soaDirections.get(i) - aosDirections[i]).getLength());
+            maxError = std::max(maxError, MathT::abs(soaSpeeds[i] - aosSpeeds[i]));
+        }
+
+        outputStream << "Particles: " << numParticles << ", passes: " << numPasses << "\n"
+                     << "AoS loop: " << aosMs << " ms\n"
+                     << "SoA kernels: " << soaMs << " ms, " << aosMs / soaMs << "x, max difference " << maxError << "\n"
+                     << "AoS to SoA transposes: " << transposeMs << " ms\n";
+    }
+
+    void runDotCross(int numVectors, int numPasses, std::wstringstream& outputStream)
+    {
+        std::vector<vec3> aVectors(numVectors);
+        std::vector<vec3> bVectors(numVectors);
+        for (int i = 0; i != numVectors; ++i)
+        {
+            aVectors[i] = randomVec3();
+            bVectors[i] = randomVec3();
+        }
+
+        std::vector<float> aosDots(numVectors);
+        std::vector<vec3> aosCrosses(numVectors);
+        tClock::time_point start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            for (int i = 0; i != numVectors; ++i)
+            {
+                aosDots[i] = aVectors[i].dot(bVectors[i]);
+                aosCrosses[i] = aVectors[i].cross(bVectors[i]);
+            }
+        }
+        const double aosMs = getElapsedMs(start);
+
+        const vec3_soa a(aVectors);
+        const vec3_soa b(bVectors);
+        std::vector<float> soaDots(numVectors);
+        vec3_soa soaCrosses;
+        start = tClock::now();
+        for (int pass = 0; pass != numPasses; ++pass)
+        {
+            VectorSoA::dot(a, b, soaDots.data());
+            VectorSoA::cross(a, b, soaCrosses);
+        }
+        const double soaMs = getElapsedMs(start);
+
+        float maxError = 0.f;
+        for (int i = 0; i < numVectors; i += 64)
+        {
+            maxError = std::max(maxError, MathT::abs(soaDots[i] - aosDots[i]));
+            maxError = std::max(maxError, (soaCrosses.get(i) - aosCrosses[i]).getLength());
+        }
+
+        outputStream << "Vectors: " << numVectors << ", passes: " << numPasses << "\n"
+                     << "AoS dot & cross: " << aosMs << " ms\n"
+                     << "SoA dot & cross: " << soaMs << " ms, " << aosMs / soaMs << "x, max difference " << maxError << "\n";
+    }
+
+    // the particle step's kernels at every dispatch level the machine supports
+    void runParticleLevels(int numParticles, int numPasses, std::wstringstream& outputStream)
+    {
+        std::vector<vec3> velocities(numParticles);
+        for (vec3& velocity : velocities)
+        {
+            velocity = randomVec3();
+        }
+        vec3_soa positions(numParticles);
+        const vec3_soa soaVelocities(velocities);
+        vec3_soa directions;
+        vec3_soa step;
+        std::vector<float> speeds(numParticles);
+
+        outputStream << "Particles: " << numParticles << ", passes: " << numPasses << "\n";
+        double scalarMs = 0.0;
+        for (SIMD::Level level : {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512})
+        {
+            if (level > SIMD::getSupportedLevel())
+                break;
+            SIMD::forceLevel(level);
+            const tClock::time_point start = tClock::now();
+            for (int pass = 0; pass != numPasses; ++pass)
+            {
+                VectorSoA::scale(soaVelocities, 1.f / 60.f, step);
+                VectorSoA::add(positions, step, positions);
+                VectorSoA::length(soaVelocities, speeds.data());
+                VectorSoA::normalize(soaVelocities, directions);
+            }
+            const double levelMs = getElapsedMs(start);
+            scalarMs = level == SIMD::Level::Scalar ? levelMs : scalarMs;
+            outputStream << SIMD::getLevelName(level) << ": " << levelMs << " ms, " << scalarMs / levelMs << "x\n";
+        }
+        SIMD::resetLevel();
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (VectorSoABenchmarks)
+    {
+      public:
+        TEST_METHOD (ParticlePassTime)
+        {
+            // cache resident batches gain the most, streaming ones are bound by memory either way
+            std::wstringstream outputStream;
+            outputStream << "\n";
+            for (int numParticles : {1 << 12, 1 << 20})
+            {
+                runParticlePasses(numParticles, (1 << 24) / numParticles, outputStream);
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (DotCrossTime)
+        {
+            std::wstringstream outputStream;
+            outputStream << "\n";
+            for (int numVectors : {1 << 12, 1 << 20})
+            {
+                runDotCross(numVectors, (1 << 24) / numVectors, outputStream);
+            }
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+
+        TEST_METHOD (DispatchLevelTime)
+        {
+            std::wstringstream outputStream;
+            outputStream << "\n";
+            runParticleLevels(1 << 12, 1 << 12, outputStream);
+            Logger::WriteMessage(outputStream.str().c_str());
+        }
+    };
+} // namespace CoreMathUnitTest
@@ -0,0 +1,259 @@
+// Richard Shemaka - 2020
+// https://github.com/rshemaka/CoreMath
+
+#include "CppUnitTest.h"
+#include "stdafx.h"
+
+#include "Random.h"
+#include "SIMD.h"
+#include "VectorSoA.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    template <class T>
+    t_vec3<T> randomVec3()
+    {
+        return t_vec3<T>(randRange(-10.f, 10.f), randRange(-10.f, 10.f), randRange(-10.f, 10.f));
+    }
+
+    template <class T>
+    t_vec2<T> randomVec2()
+    {
+        return t_vec2<T>(randRange(-10.f, 10.f), randRange(-10.f, 10.f));
+    }
+
+    // kernels & per vector math agree within the SIMD tolerance, exactly unless the compiler fuses multiply-adds
+    template <class T>
+    bool isClose(T a, T b, T magnitude)
+    {
+        return MathHelpers::isWithinULPs(a, b, magnitude, SIMD::MaxULPDifference);
+    }
+
+    template <class T>
+    bool isClose(const t_vec3<T>& a, const t_vec3<T>& b, T magnitude)
+    {
+        return isClose(a.x, b.x, magnitude) && isClose(a.y, b.y, magnitude) && isClose(a.z, b.z, magnitude);
+    }
+
+    // kernel results against the same math per vector
+    // counts around the register widths to cover the vector bodies & scalar remainders
+    template <class T>
+    void checkKernels3()
+    {
+        for (uint32_t count : {0u, 1u, 3u, 4u, 7u, 8u, 13u, 16u, 37u, 100u})
+        {
+            std::vector<t_vec3<T>> aVectors(count);
+            std::vector<t_vec3<T>> bVectors(count);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                aVectors[i] = randomVec3<T>();
+                bVectors[i] = randomVec3<T>();
+            }
+            const t_vec_soa<T, 3> a(aVectors);
+            const t_vec_soa<T, 3> b(bVectors);
+            const T t = 0.3;
+
+            t_vec_soa<T, 3> sum, difference, scaled, blended, crossed, normalized;
+            std::vector<T> dots(count), lengths(count);
+            VectorSoA::add(a, b, sum);
+            VectorSoA::sub(a, b, difference);
+            VectorSoA::scale(a, T(2.5), scaled);
+            VectorSoA::lerp(a, b, t, blended);
+            VectorSoA::cross(a, b, crossed);
+            VectorSoA::normalize(a, normalized);
+            VectorSoA::dot(a, b, dots.data());
+            VectorSoA::length(a, lengths.data());
+
+            Assert::AreEqual(count, sum.getSize());
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                const t_vec3<T>& u = aVectors[i];
+                const t_vec3<T>& v = bVectors[i];
+
+                // inputs are within 10 per component, magnitudes bound the summed terms
+                Assert::IsTrue(sum.get(i).x == (u + v).x && sum.get(i).y == (u + v).y && sum.get(i).z == (u + v).z);
+                Assert::IsTrue(difference.get(i).x == (u - v).x && difference.get(i).z == (u - v).z);
+                Assert::IsTrue(scaled.get(i).y == u.y * T(2.5));
+                Assert::IsTrue(isClose(blended.get(i), t_vec3<T>(u.x + (v.x - u.x) * t, u.y + (v.y - u.y) * t, u.z + (v.z - u.z) * t), T(20)));
+                Assert::IsTrue(isClose(crossed.get(i), u.cross(v), T(200)));
+                Assert::IsTrue(isClose(dots[i], u.dot(v), T(300)));
+                Assert::IsTrue(isClose(lengths[i], u.getLength(), u.getLength()));
+                Assert::IsTrue(isClose(normalized.get(i), u.getUnit(), T(1)));
+            }
+
+            // affine transforms, components & interleaved triples
+            T m[12];
+            for (T& value : m)
+            {
+                value = randRange(-2.f, 2.f);
+            }
+            const T* aComponents[3];
+            VectorSoA::getComponents(a, aComponents);
+            t_vec_soa<T, 3> points(count), vectors(count);
+            T* pointComponents[3];
+            T* vectorComponents[3];
+            VectorSoA::getComponents(points, pointComponents);
+            VectorSoA::getComponents(vectors, vectorComponents);
+            VectorSoA::transformPoints<T>(m, aComponents, count, pointComponents);
+            VectorSoA::transformVectors<T>(m, aComponents, count, vectorComponents);
+            std::vector<t_vec3<T>> interleavedPoints(count), interleavedVectors = aVectors;
+            VectorSoA::transformInterleavedPoints<T>(m, reinterpret_cast<const T*>(aVectors.data()), count, reinterpret_cast<T*>(interleavedPoints.data()));
+            VectorSoA::transformInterleavedVectors<T>(m, reinterpret_cast<const T*>(interleavedVectors.data()), count, reinterpret_cast<T*>(interleavedVectors.data()));
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                const t_vec3<T>& u = aVectors[i];
+                const t_vec3<T> vector(m[0] * u.x + m[1] * u.y + m[2] * u.z, m[4] * u.x + m[5] * u.y + m[6] * u.z, m[8] * u.x + m[9] * u.y + m[10] * u.z);
+                const t_vec3<T> point(vector.x + m[3], vector.y + m[7], vector.z + m[11]);
+                Assert::IsTrue(isClose(points.get(i), point, T(70)) && isClose(interleavedPoints[i], point, T(70)));
+                Assert::IsTrue(isClose(vectors.get(i), vector, T(70)) && isClose(interleavedVectors[i], vector, T(70)));
+            }
+        }
+    }
+
+    template <class T>
+    void checkKernels2()
+    {
+        for (uint32_t count : {1u, 5u, 8u, 19u, 64u})
+        {
+            std::vector<t_vec2<T>> aVectors(count);
+            std::vector<t_vec2<T>> bVectors(count);
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                aVectors[i] = randomVec2<T>();
+                bVectors[i] = randomVec2<T>();
+            }
+            const t_vec_soa<T, 2> a(aVectors);
+            const t_vec_soa<T, 2> b(bVectors);
+
+            t_vec_soa<T, 2> sum, normalized;
+            std::vector<T> dots(count), lengths(count);
+            VectorSoA::add(a, b, sum);
+            VectorSoA::normalize(a, normalized);
+            VectorSoA::dot(a, b, dots.data());
+            VectorSoA::length(a, lengths.data());
+
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                const t_vec2<T>& u = aVectors[i];
+                const t_vec2<T>& v = bVectors[i];
+                Assert::IsTrue(sum.get(i).x == u.x + v.x && sum.get(i).y == u.y + v.y);
+                Assert::IsTrue(isClose(dots[i], u.dot(v), T(200)));
+                Assert::IsTrue(isClose(lengths[i], u.getLength(), u.getLength()));
+                const t_vec2<T> unit = u.getUnit();
+                Assert::IsTrue(isClose(normalized.get(i).x, unit.x, T(1)) && isClose(normalized.get(i).y, unit.y, T(1)));
+            }
+        }
+    }
+} // namespace
+
+namespace CoreMathUnitTest
+{
+    TEST_CLASS (VectorSoATests)
+    {
+      public:
+        TEST_METHOD (StorageAndTransposes)
+        {
+            std::vector<vec3> vectors(21);
+            for (vec3& v : vectors)
+            {
+                v = randomVec3<float>();
+            }
+
+            vec3_soa soa(vectors);
+            Assert::AreEqual(21u, soa.getSize());
+            Assert::AreEqual(0u, soa.getPaddedSize() % vec3_soa::PaddingSize);
+            for (int axis = 0; axis != 3; ++axis)
+            {
+                // aligned starts & zero padding
+                Assert::AreEqual(uintptr_t(0), reinterpret_cast<uintptr_t>(soa.getComponent(axis)) % VectorSoA::Alignment);
+                for (uint32_t i = soa.getSize(); i != soa.getPaddedSize(); ++i)
+                {
+                    Assert::AreEqual(0.f, soa.getComponent(axis)[i]);
+                }
+            }
+
+            std::vector<vec3> roundTrip;
+            soa.toAoS(roundTrip);
+            Assert::AreEqual(vectors.size(), roundTrip.size());
+            for (size_t i = 0; i != vectors.size(); ++i)
+            {
+                Assert::IsTrue(roundTrip[i].x == vectors[i].x && roundTrip[i].y == vectors[i].y && roundTrip[i].z == vectors[i].z);
+            }
+
+            // growing past the padding keeps contents & zeroes the rest
+            soa.resize(100);
+            Assert::IsTrue(soa.get(20).z == vectors[20].z);
+            Assert::IsTrue(soa.get(99).x == 0.f && soa.get(21).y == 0.f);
+            Assert::AreEqual(uintptr_t(0), reinterpret_cast<uintptr_t>(soa.getComponent(2)) % VectorSoA::Alignment);
+
+            // shrinking within the padding zeroes what's cut off
+            soa.set(99, vec3(1.f, 2.f, 3.f));
+            soa.resize(97);
+            Assert::AreEqual(0.f, soa.getComponent(1)[99]);
+
+            // copies are independent & aligned
+            vec3_soa copy = soa;
+            copy.set(0, vec3(0.f));
+            Assert::IsTrue(soa.get(0).x == vectors[0].x);
+            Assert::AreEqual(uintptr_t(0), reinterpret_cast<uintptr_t>(copy.getComponent(1)) % VectorSoA::Alignment);
+
+            vec2_soa soa2(std::vector<vec2>{vec2(1.f, 2.f), vec2(3.f, 4.f)});
+            Assert::IsTrue(soa2.get(1).x == 3.f && soa2.get(1).y == 4.f);
+        }
+
+        TEST_METHOD (Kernels)
+        {
+            checkKernels3<float>();
+            checkKernels3<double>();
+            checkKernels2<float>();
+            checkKernels2<double>();
+        }
+
+        TEST_METHOD (AliasedOutputs)
+        {
+            std::vector<vec3> aVectors(45);
+            std::vector<vec3> bVectors(45);
+            for (size_t i = 0; i != aVectors.size(); ++i)
+            {
+                aVectors[i] = randomVec3<float>();
+                bVectors[i] = randomVec3<float>();
+            }
+            vec3_soa a(aVectors);
+            const vec3_soa b(bVectors);
+
+            VectorSoA::cross(a, b, a);
+            for (size_t i = 0; i != aVectors.size(); ++i)
+            {
+                Assert::IsTrue(isClose(a.get(uint32_t(i)), aVectors[i].cross(bVectors[i]), 200.f));
+            }
+
+            a.fromAoS(aVectors);
+            VectorSoA::normalize(a, a);
+            VectorSoA::add(a, b, a);
+            for (size_t i = 0; i != aVectors.size(); ++i)
+            {
+                Assert::IsTrue(isClose(a.get(uint32_t(i)).x, aVectors[i].getUnit().x + bVectors[i].x, 11.f));
+            }
+        }
+
+        TEST_METHOD (DispatchLevels)
+        {
+            // every level the machine supports gives the same results, remainders included
+            const SIMD::Level supportedLevel = SIMD::getSupportedLevel();
+            Assert::IsTrue(SIMD::getLevel() <= supportedLevel);
+            for (SIMD::Level level : {SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX, SIMD::Level::AVX512})
+            {
+                SIMD::forceLevel(level);
+                Assert::IsTrue(SIMD::getLevel() == std::min(level, supportedLevel));
+                checkKernels3<float>();
+                checkKernels2<float>();
+            }
+            SIMD::resetLevel();
+            Assert::IsTrue(SIMD::getLevel() == supportedLevel);
+        }
+    };
+} // namespace CoreMathUnitTest